@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 10
+#define LTO_API_VERSION 11
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -453,6 +453,30 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern lto_bool_t
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Sets the number of partitions that lto_codegen_compile_to_files() splits
+ * the merged module into. Each partition is compiled on its own thread, so
+ * more than one partition puts LLVM in multithreaded mode, as
+ * LLVMStartMultithreaded() does.
+ *
+ * \since LTO_API_VERSION=11
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned parallelism);
+
+/**
+ * Generates code for all added modules into one native object file per
+ * partition (see lto_codegen_set_parallelism()), compiling the partitions in
+ * parallel. The names of the files are written to names, and their number to
+ * num_names; the names are owned by the lto_code_gen_t object. The files are
+ * in a deterministic order, and must all be linked. Returns true on error.
+ *
+ * \since LTO_API_VERSION=11
+ */
+extern lto_bool_t
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char *const **names,
+                             unsigned *num_names);
+
 
 /**
  * Sets options to help debug codegen bugs.
@@ -21,6 +21,10 @@
 //
 // NOTE: Statistics *must* be declared as global variables.
 //
+// When many threads bump the same statistics, the atomic updates of the shared
+// counters contend. With -stats-thread-local, each thread adds to counters of
+// its own instead, and these are merged when a statistic is read or printed.
+//
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_ADT_STATISTIC_H
@@ -32,42 +36,65 @@
 namespace llvm {
 class raw_ostream;
 
+/// \brief Whether statistics are counted per thread, set by
+/// -stats-thread-local. This may be turned on at any time, but not off once
+/// statistics were bumped per thread, since their counts would be lost.
+extern bool ThreadLocalStatistics;
+
 class Statistic {
 public:
   const char *Name;
   const char *Desc;
   volatile llvm::sys::cas_flag Value;
   bool Initialized;
+  /// ID - The index of the statistic in the per-thread counters, assigned when
+  /// the statistic is registered.
+  unsigned ID;
 
-  llvm::sys::cas_flag getValue() const { return Value; }
+  llvm::sys::cas_flag getValue() const {
+    return ThreadLocalStatistics ? getMergedValue() : Value;
+  }
   const char *getName() const { return Name; }
   const char *getDesc() const { return Desc; }
 
   /// construct - This should only be called for non-global statistics.
   void construct(const char *name, const char *desc) {
     Name = name; Desc = desc;
-    Value = 0; Initialized = 0;
+    Value = 0; Initialized = 0; ID = 0;
   }
 
   // Allow use of this class as the value itself.
-  operator unsigned() const { return Value; }
+  operator unsigned() const { return getValue(); }
 
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
    const Statistic &operator=(unsigned Val) {
+    if (ThreadLocalStatistics) {
+      setMergedValue(Val);
+      return *this;
+    }
     Value = Val;
     return init();
   }
 
+  // With thread-local statistics, the postfix operators return the value this
+  // thread sees: the shared value and the counter of the thread.
+
   const Statistic &operator++() {
     // FIXME: This function and all those that follow carefully use an
     // atomic operation to update the value safely in the presence of
     // concurrent accesses, but not to read the return value, so the
     // return value is not thread safe.
+    if (ThreadLocalStatistics) {
+      addThreadLocal(1);
+      return *this;
+    }
     sys::AtomicIncrement(&Value);
     return init();
   }
 
   unsigned operator++(int) {
+    if (ThreadLocalStatistics)
+      return addThreadLocal(1);
     init();
     unsigned OldValue = Value;
     sys::AtomicIncrement(&Value);
@@ -75,11 +102,17 @@ public:
   }
 
   const Statistic &operator--() {
+    if (ThreadLocalStatistics) {
+      addThreadLocal(-1U);
+      return *this;
+    }
     sys::AtomicDecrement(&Value);
     return init();
   }
 
   unsigned operator--(int) {
+    if (ThreadLocalStatistics)
+      return addThreadLocal(-1U);
     init();
     unsigned OldValue = Value;
     sys::AtomicDecrement(&Value);
@@ -88,22 +121,38 @@ public:
 
   const Statistic &operator+=(const unsigned &V) {
     if (!V) return *this;
+    if (ThreadLocalStatistics) {
+      addThreadLocal(V);
+      return *this;
+    }
     sys::AtomicAdd(&Value, V);
     return init();
   }
 
   const Statistic &operator-=(const unsigned &V) {
     if (!V) return *this;
+    if (ThreadLocalStatistics) {
+      addThreadLocal(-V);
+      return *this;
+    }
     sys::AtomicAdd(&Value, -V);
     return init();
   }
 
   const Statistic &operator*=(const unsigned &V) {
+    if (ThreadLocalStatistics) {
+      setMergedValue(getMergedValue() * V);
+      return *this;
+    }
     sys::AtomicMul(&Value, V);
     return init();
   }
 
   const Statistic &operator/=(const unsigned &V) {
+    if (ThreadLocalStatistics) {
+      setMergedValue(getMergedValue() / V);
+      return *this;
+    }
     sys::AtomicDiv(&Value, V);
     return init();
   }
@@ -157,12 +206,25 @@ protected:
     return *this;
   }
   void RegisterStatistic();
+
+  /// addThreadLocal - Add \p Delta to the counter of this thread, and return
+  /// the value this thread saw before.
+  unsigned addThreadLocal(unsigned Delta);
+
+  /// getMergedValue - Return the shared value plus the counters of all the
+  /// threads.
+  unsigned getMergedValue() const;
+
+  /// setMergedValue - Set the shared value so that, with the counters of all
+  /// the threads, the statistic is \p Val. The counters are left alone, since
+  /// their threads may be bumping them.
+  void setMergedValue(unsigned Val);
 };
 
 // STATISTIC - A macro to make definition of statistics really simple.  This
 // automatically passes the DEBUG_TYPE of the file into the statistic.
 #define STATISTIC(VARNAME, DESC) \
-  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0 }
+  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0, 0 }
 
 /// \brief Enable the collection and printing of statistics.
 void EnableStatistics();
@@ -176,6 +238,13 @@ void PrintStatistics();
 /// \brief Print statistics to the given output stream.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief Print statistics to the given output stream as a JSON object.
+void PrintStatisticsJSON(raw_ostream &OS);
+
+/// \brief Print statistics to the given output stream as CSV, with a header
+/// line.
+void PrintStatisticsCSV(raw_ostream &OS);
+
 } // End llvm namespace
 
 #endif
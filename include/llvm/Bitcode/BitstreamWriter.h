@@ -114,6 +114,20 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// \brief Backpatch a 32-bit field that was emitted at the given bit
+  /// position, which need not be aligned, with the specified value. The field
+  /// must already have been flushed to the output.
+  void BackpatchField(uint64_t BitNo, uint32_t NewValue) {
+    assert(BitNo + 32 <= GetBufferOffset() * 8 && "Field not flushed yet!");
+    for (unsigned i = 0; i != 32; ++i, ++BitNo) {
+      unsigned char Mask = 1 << (BitNo & 7);
+      if ((NewValue >> i) & 1)
+        Out[BitNo / 8] |= Mask;
+      else
+        Out[BitNo / 8] &= ~Mask;
+    }
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
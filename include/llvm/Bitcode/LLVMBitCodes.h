@@ -42,7 +42,9 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    FUNCTION_INDEX_BLOCK_ID
   };
 
 
@@ -71,7 +73,18 @@ namespace bitc {
     // MODULE_CODE_PURGEVALS: [numvals]
     MODULE_CODE_PURGEVALS   = 10,
 
-    MODULE_CODE_GCNAME      = 11   // GCNAME: [strchr x N]
+    MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
+
+    // FNINDEXOFFSET: [offset] (32-bit fixed width, in 32-bit words)
+    MODULE_CODE_FNINDEXOFFSET = 12
+  };
+
+  /// FUNCTION_INDEX blocks record where the FUNCTION_BLOCK of each function
+  /// with a body starts, so that readers can find a body without scanning all
+  /// of the function blocks that precede it. Offsets are in bits from the
+  /// start of the contents of the enclosing MODULE_BLOCK.
+  enum FunctionIndexCodes {
+    FNINDEX_CODE_ENTRY = 1  // ENTRY: [valueid, offset]
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
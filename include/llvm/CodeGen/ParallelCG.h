@@ -0,0 +1,50 @@
+//===-- llvm/CodeGen/ParallelCG.h - Parallel code generation ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header declares functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_PARALLELCG_H
+#define LLVM_CODEGEN_PARALLELCG_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Target/TargetMachine.h"
+#include <string>
+
+namespace llvm {
+
+class Module;
+class TargetOptions;
+class raw_ostream;
+
+/// Split M into OSs.size() partitions, and generate code for each partition
+/// on its own thread, writing the output for partition I to *OSs[I]. The
+/// partitions link together to the equivalent of the code generated for M.
+///
+/// Each partition is compiled in its own LLVMContext with its own
+/// TargetMachine, created from the target triple of M and the given CPU,
+/// features and options. The output does not depend on the number of threads
+/// that are available, only on the number of partitions. M is modified by the
+/// split (see SplitModule) and must not be used for code generation afterwards.
+///
+/// With more than one partition, the client must have called
+/// llvm_start_multithreaded() first.
+///
+/// Returns true and sets ErrMsg if code generation could not be set up.
+bool splitCodeGen(Module &M, ArrayRef<raw_ostream *> OSs, StringRef CPU,
+                  StringRef Features, const TargetOptions &Options,
+                  Reloc::Model RM, CodeModel::Model CM, CodeGenOpt::Level OL,
+                  TargetMachine::CodeGenFileType FT, std::string &ErrMsg);
+
+} // End llvm namespace
+
+#endif
@@ -148,6 +148,14 @@ public:
       uint64_t Size, DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
   virtual DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
+
+  /// Parse all the debug information up front rather than on demand, using
+  /// \p ThreadCount threads (0 means one per core). Unless \p ThreadCount is
+  /// 1, the client must have called llvm_start_multithreaded(). A context
+  /// is not thread-safe, but once preload returns, getLineInfoForAddress,
+  /// getLineInfoForAddressRange and getInliningInfoForAddress only read it,
+  /// and may be called from several threads at once. Nothing else may be.
+  virtual void preload(unsigned ThreadCount) {}
 private:
   const DIContextKind Kind;
 };
@@ -0,0 +1,148 @@
+//===-- BackgroundCompiler.h - Recompile MCJIT code on a thread -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the BackgroundCompiler class, which lets MCJIT start
+// running the code of a module compiled without optimization while optimized
+// code for its functions is generated on another thread.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_BACKGROUNDCOMPILER_H
+#define LLVM_EXECUTIONENGINE_BACKGROUNDCOMPILER_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadPool.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class ExecutionEngine;
+class Function;
+class Module;
+
+/// BackgroundCompiler - Recompile the functions of the modules of an MCJIT
+/// engine at a higher optimization level on a background thread, while the
+/// code first generated for them keeps running.
+///
+/// Each function defined by a module added through the compiler becomes a
+/// stub calling its body through a pointer, the slot of the function, so that
+/// callers always reach the latest code of the function.  The engine compiles
+/// the module as usual, typically at CodeGenOpt::None to start quickly.  When
+/// functions are then queued for optimization, the worker thread reads them
+/// back from a copy of the module taken before the stubs were added, runs the
+/// optimization pipeline over them with the other functions of the module
+/// available for inlining, generates code at the optimization level of the
+/// compiler and stores the addresses of the new bodies into the slots.  Calls
+/// already running the old code finish in it.
+///
+/// Functions taking a variable number of arguments, an inalloca argument, or
+/// with the naked attribute or prefix data cannot be called through a stub,
+/// and keep their first code.  Internal symbols of the modules are renamed
+/// and exported, so that the optimized code can refer to them.
+///
+/// The engine must be an MCJIT engine running code in this process, and must
+/// outlive the compiler.  Recompilations take the lock of the engine while
+/// they generate code, and all the modules of the engine are compiled before
+/// the first of them is queued, so that the worker thread never touches the
+/// LLVMContext of the client.  The modules must not be modified once added.
+/// The client must have called llvm_start_multithreaded() before creating the
+/// compiler.
+class BackgroundCompiler {
+  BackgroundCompiler(const BackgroundCompiler &) LLVM_DELETED_FUNCTION;
+  void operator=(const BackgroundCompiler &) LLVM_DELETED_FUNCTION;
+
+  /// SourceModule - The bitcode of an added module, before its functions were
+  /// replaced by stubs.
+  struct SourceModule {
+    std::string Name;
+    std::string Bitcode;
+  };
+
+  /// StubInfo - A function called through a slot.
+  struct StubInfo {
+    const SourceModule *Source;
+    std::string SlotName;
+    /// Body - The function holding the first code of the function.
+    const Function *Body;
+    /// Queued - Whether the function was queued for optimization.
+    bool Queued;
+  };
+
+  ExecutionEngine &EE;
+  CodeGenOpt::Level OptLevel;
+
+  std::vector<SourceModule *> Sources;
+  DenseMap<const Function *, StubInfo> Stubs;
+
+  /// Lock - Protects Optimized and Cancelled, which the worker thread writes.
+  sys::Mutex Lock;
+  /// Optimized - The functions whose slot points to their optimized code.
+  DenseSet<const Function *> Optimized;
+  bool Cancelled;
+
+  /// Pool - A single thread, so that requests are handled in order.  Declared
+  /// last to be destroyed, and joined, first.
+  ThreadPool Pool;
+
+  /// A batch of functions of a source module to optimize together.
+  struct Request {
+    const SourceModule *Source;
+    /// Names - The names of the functions and of their slots.
+    std::vector<std::pair<std::string, std::string> > Names;
+    std::vector<const Function *> Functions;
+  };
+
+  void queue(Request *R);
+  /// Return whether the compiler is being destroyed, in which case \p R is
+  /// dropped.
+  bool isCancelled(const Request &R);
+  void compile(Request *R);
+
+public:
+  /// Create a compiler generating optimized code for \p EE at \p OptLevel.
+  BackgroundCompiler(ExecutionEngine &EE,
+                     CodeGenOpt::Level OptLevel = CodeGenOpt::Default);
+
+  /// Cancel the recompilations that have not started, and wait for the one
+  /// in progress, if any.
+  ~BackgroundCompiler();
+
+  /// addModule - Replace the functions of \p M by stubs and add \p M to the
+  /// engine.  \p M may be the module the engine was created with, as long as
+  /// no code was generated for it yet.
+  void addModule(Module *M);
+
+  /// optimizeFunction - Queue \p F for optimization.  Returns false if \p F
+  /// is not called through a stub.
+  bool optimizeFunction(const Function *F);
+
+  /// optimizeModule - Queue the functions of \p M called through stubs for
+  /// optimization.  Functions linked by direct calls, whichever way, are
+  /// batched together, so that they are optimized with each other; large
+  /// groups are split into several batches in module order.
+  void optimizeModule(const Module *M);
+
+  /// hasStub - Return whether \p F is called through a stub.
+  bool hasStub(const Function *F) const { return Stubs.count(F); }
+
+  /// isOptimized - Return whether calls to \p F run its optimized code.
+  bool isOptimized(const Function *F);
+
+  /// wait - Wait until the queued functions are optimized.
+  void wait() { Pool.wait(); }
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,79 @@
+//===-- DiskObjectCache.h - On-disk cache of MCJIT objects ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the DiskObjectCache class, an ObjectCache which keeps the
+// objects compiled by MCJIT in a directory, so that later processes compiling
+// the same modules for the same target can load them instead.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_DISKOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_DISKOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// DiskObjectCache - An ObjectCache storing each object in a file of a
+/// directory, named after a hash of the bitcode of its module and of the
+/// configuration of the TargetMachine generating it.  Identical modules
+/// compiled by different engines or processes thus share their object, and
+/// a module never gets the object of an older version of itself.
+///
+/// Objects are written to a temporary file renamed into place, so that
+/// processes sharing the directory never load a partial object, and are
+/// mapped copy-on-write when loaded.  If the cache has a maximum size, the
+/// least recently used objects are deleted once the objects in the directory
+/// take more than that.  Errors accessing the directory are not reported:
+/// the module is just compiled again.
+class DiskObjectCache : public ObjectCache {
+  DiskObjectCache(const DiskObjectCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const DiskObjectCache &) LLVM_DELETED_FUNCTION;
+
+  std::string CacheDir;
+
+  /// TargetKey - The configuration of the TargetMachine, hashed with the
+  /// bitcode of each module.
+  std::string TargetKey;
+
+  uint64_t MaxSize;
+
+  /// PendingPaths - The object files of the modules looked up and not found,
+  /// which are computed before code generation changes the modules.
+  DenseMap<const Module *, std::string> PendingPaths;
+  sys::Mutex Lock;
+
+public:
+  /// Create a cache in \p Dir for the objects that \p TM generates.  The
+  /// least recently used objects are deleted once the cache holds more than
+  /// \p MaxSize bytes, unless \p MaxSize is 0.
+  DiskObjectCache(StringRef Dir, const TargetMachine &TM, uint64_t MaxSize = 0);
+  virtual ~DiskObjectCache();
+
+  void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj) override;
+  MemoryBuffer *getObject(const Module *M) override;
+
+  /// getObjectPath - Return the path of the file caching the object of \p M
+  /// as it is now.
+  std::string getObjectPath(const Module *M) const;
+
+  /// prune - Delete the least recently used objects until the cache holds at
+  /// most MaxSize bytes.
+  void prune();
+};
+
+} // End llvm namespace
+
+#endif
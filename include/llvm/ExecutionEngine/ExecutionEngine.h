@@ -45,6 +45,7 @@ class Module;
 class MutexGuard;
 class ObjectCache;
 class RTDyldMemoryManager;
+class TierListener;
 class Triple;
 class Type;
 
@@ -151,6 +152,9 @@ protected:
     bool GVsWithCode,
     TargetMachine *TM);
   static ExecutionEngine *(*InterpCtor)(Module *M, std::string *ErrorStr);
+  static ExecutionEngine *(*TieredCtor)(Module *M, std::string *ErrorStr,
+                                        ExecutionEngine *JIT,
+                                        unsigned Threshold);
 
   /// LazyFunctionCreator - If an unknown function is needed, this function
   /// pointer is invoked to create it.  If this returns null, the JIT will
@@ -462,6 +466,11 @@ public:
     llvm_unreachable("No support for an object cache");
   }
 
+  /// setTierListener - Set the listener told about the functions a tiered
+  /// engine compiles, or 0 for none.  The ownership of the listener is not
+  /// changed.  Other engines have no tiers and ignore it.
+  virtual void setTierListener(TierListener *) {}
+
   /// setProcessAllSections (MCJIT Only): By default, only sections that are
   /// "required for execution" are passed to the RTDyldMemoryManager, and other
   /// sections are discarded. Passing 'true' to this method will cause
@@ -572,6 +581,7 @@ private:
   std::string MCPU;
   SmallVector<std::string, 4> MAttrs;
   bool UseMCJIT;
+  unsigned TierUpThreshold;
 
   /// InitEngine - Does the common initialization of default options.
   void InitEngine() {
@@ -585,6 +595,7 @@ private:
     RelocModel = Reloc::Default;
     CMModel = CodeModel::JITDefault;
     UseMCJIT = false;
+    TierUpThreshold = 0;
   }
 
 public:
@@ -694,6 +705,17 @@ public:
     return *this;
   }
 
+  /// setTierUpThreshold - Create a tiered engine, which interprets the
+  /// functions of the module until they were called or looped \p Threshold
+  /// times, and then runs them compiled by the MCJIT.  Requires both engines
+  /// to be linked in, setUseMCJIT(true), no memory manager and an engine kind
+  /// allowing both; otherwise, or if \p Threshold is 0, the default, a single
+  /// engine is created as usual.
+  EngineBuilder &setTierUpThreshold(unsigned Threshold) {
+    TierUpThreshold = Threshold;
+    return *this;
+  }
+
   /// setMAttrs - Set cpu-specific attributes.
   template<typename StringSequence>
   EngineBuilder &setMAttrs(const StringSequence &mattrs) {
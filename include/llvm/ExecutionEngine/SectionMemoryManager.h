@@ -17,6 +17,7 @@
 
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/ExecutionEngine/SectionMemoryPool.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Memory.h"
 
@@ -35,12 +36,21 @@ namespace llvm {
 /// in the JITed object.  Permissions can be applied either by calling
 /// MCJIT::finalizeObject or by calling SectionMemoryManager::finalizeMemory
 /// directly.  Clients of MCJIT should call MCJIT::finalizeObject.
+///
+/// By default the memory manager maps memory of its own.  Created with a
+/// SectionMemoryPool, it carves its sections from the slabs of the pool
+/// instead, and gives them back when destroyed, typically with the engine
+/// owning it.
 class SectionMemoryManager : public RTDyldMemoryManager {
   SectionMemoryManager(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
   void operator=(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
 
 public:
-  SectionMemoryManager() { }
+  SectionMemoryManager() : Pool(0) { }
+
+  /// Create a memory manager allocating its sections from \p Pool, which
+  /// must outlive it.
+  explicit SectionMemoryManager(SectionMemoryPool &Pool) : Pool(&Pool) { }
   virtual ~SectionMemoryManager();
 
   /// \brief Allocates a memory block of (at least) the given size suitable for
@@ -93,9 +103,14 @@ private:
   uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
                            unsigned Alignment);
 
+  sys::MemoryBlock allocateBlock(MemoryGroup &MemGroup, uintptr_t Size,
+                                 error_code &ec);
+  void releaseMemoryGroup(MemoryGroup &MemGroup);
+
   error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                          unsigned Permissions);
 
+  SectionMemoryPool *Pool;
   MemoryGroup CodeMem;
   MemoryGroup RWDataMem;
   MemoryGroup RODataMem;
@@ -0,0 +1,95 @@
+//===-- SectionMemoryPool.h - Memory shared by memory managers --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the SectionMemoryPool class, from which the
+// SectionMemoryManagers of many engines carve their sections.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_SECTIONMEMORYPOOL_H
+#define LLVM_EXECUTIONENGINE_SECTIONMEMORYPOOL_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/system_error.h"
+#include <map>
+
+namespace llvm {
+
+/// SectionMemoryPool - Memory mapped in large slabs, handed out in whole
+/// pages to the SectionMemoryManagers created with it, and reused once they
+/// give it back.  A client compiling and discarding many modules, each with
+/// an engine of its own, thus keeps mapping the same memory instead of new
+/// regions.
+///
+/// Code and data come from separate slabs, so that the code of all the live
+/// modules stays together, in as few pages as possible, and the code slabs can
+/// be backed by huge pages.  Blocks are carved first-fit from the lowest
+/// addresses, and blocks given back merge with their free neighbours.
+///
+/// A huge page is split back into small pages as soon as part of it changes
+/// protection, so huge-page code slabs are mapped read-write-execute once and
+/// never reprotected: the code of finalized modules stays writable.  Clients
+/// which need code to be write-protected should not use huge pages.
+///
+/// The pool may be shared by engines on several threads.  It unmaps its
+/// slabs when destroyed, so it must outlive the memory managers using it.
+class SectionMemoryPool {
+  SectionMemoryPool(const SectionMemoryPool &) LLVM_DELETED_FUNCTION;
+  void operator=(const SectionMemoryPool &) LLVM_DELETED_FUNCTION;
+
+public:
+  enum MemoryKind { Code, Data };
+
+  /// Create a pool mapping memory in slabs of at least \p SlabSize bytes,
+  /// with the code slabs backed by huge pages if \p UseHugePages and the
+  /// system supports them.
+  explicit SectionMemoryPool(size_t SlabSize = 2 * 1024 * 1024,
+                             bool UseHugePages = false);
+  ~SectionMemoryPool();
+
+  /// allocate - Return a read-write block of whole pages holding at least
+  /// \p Size bytes, or a null block with \p EC describing the error.  Code
+  /// blocks are also executable if keepsCodeWritable().
+  sys::MemoryBlock allocate(MemoryKind Kind, size_t Size, error_code &EC);
+
+  /// release - Give back \p Block, returned by allocate for \p Kind, whatever
+  /// its permissions are now.  It gets the permissions of its slab back.
+  void release(MemoryKind Kind, const sys::MemoryBlock &Block);
+
+  /// keepsCodeWritable - Return true if the code blocks must keep the
+  /// read-write-execute permissions they are allocated with, so that the
+  /// huge pages backing them are not split.
+  bool keepsCodeWritable() const { return UseHugePages; }
+
+  /// getMappedSize - Return the number of bytes of the slabs of \p Kind.
+  size_t getMappedSize(MemoryKind Kind) const;
+
+  /// getFreeSize - Return the number of bytes of the slabs of \p Kind which
+  /// are not allocated.
+  size_t getFreeSize(MemoryKind Kind) const;
+
+private:
+  struct Slabs {
+    SmallVector<sys::MemoryBlock, 4> Mapped;
+    /// Free - The free blocks by address, mapped to their sizes.
+    std::map<uintptr_t, size_t> Free;
+  };
+
+  size_t SlabSize;
+  bool UseHugePages;
+  Slabs Pools[2];
+  mutable sys::Mutex Lock;
+};
+
+} // End llvm namespace
+
+#endif
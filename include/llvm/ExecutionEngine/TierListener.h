@@ -0,0 +1,48 @@
+//===-- TierListener.h - Tier transitions of an ExecutionEngine -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the TierListener interface, through which a tiered
+// ExecutionEngine reports the functions it moves from the interpreter to
+// compiled code.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_TIERLISTENER_H
+#define LLVM_EXECUTIONENGINE_TIERLISTENER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+
+class Function;
+
+/// TierListener - Told by a tiered ExecutionEngine, one created with
+/// EngineBuilder::setTierUpThreshold, when the functions it interprets get hot.
+class TierListener {
+  virtual void anchor();
+public:
+  TierListener() { }
+
+  virtual ~TierListener() { }
+
+  /// notifyFunctionPromoted - Called when calls to \p F start running compiled
+  /// code, after \p F was called \p Calls times and took \p BackEdges loop back
+  /// edges in the interpreter.
+  virtual void notifyFunctionPromoted(const Function &F, uint64_t Calls,
+                                      uint64_t BackEdges) { }
+
+  /// notifyPromotionFailed - Called when \p F got hot but cannot be compiled,
+  /// and is interpreted from then on.
+  virtual void notifyPromotionFailed(const Function &F, StringRef Reason) { }
+};
+
+}
+
+#endif
@@ -125,6 +125,26 @@ public:
   void emitError(const Instruction *I, const Twine &ErrorStr);
   void emitError(const Twine &ErrorStr);
 
+  /// enableConcurrentUniquing - Let several threads create constants, types,
+  /// metadata and attributes of this context at once, by guarding the tables
+  /// uniquing them with locks.  The other tables of the context which function
+  /// passes share are guarded too: instruction metadata, metadata kinds,
+  /// debug location scopes and discriminators, value handles, the intrinsic
+  /// IDs and prefix data of functions, and the use lists of the values
+  /// functions share: constants, globals, metadata and inline asm.  This must
+  /// be called before other threads use the context, and cannot be undone.
+  ///
+  /// Only adding and removing uses is guarded.  Walking the use list of a
+  /// shared value, or replacing all its uses, races with the threads adding
+  /// uses to it, so function passes must not do so.  Once a context is in
+  /// this mode, the uses of every context pay for a check on whether the
+  /// value is shared.
+  void enableConcurrentUniquing();
+
+  /// hasConcurrentUniquing - Return whether enableConcurrentUniquing was
+  /// called on this context.
+  bool hasConcurrentUniquing() const;
+
 private:
   LLVMContext(LLVMContext&) LLVM_DELETED_FUNCTION;
   void operator=(LLVMContext&) LLVM_DELETED_FUNCTION;
@@ -42,7 +42,11 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/type_traits.h"
 #include <list>
 #include <memory>
@@ -730,6 +734,12 @@ private:
 
 /// \brief A function analysis manager to coordinate and cache analyses run over
 /// a module.
+///
+/// The result cache may be queried and invalidated concurrently for different
+/// functions, which is what allows a \c ParallelModuleToFunctionPassAdaptor to
+/// share one manager between its threads. Registering passes is not
+/// thread-safe, and neither is using the results of one function from the
+/// thread working on another.
 class FunctionAnalysisManager
     : public detail::AnalysisManagerBase<FunctionAnalysisManager, Function *> {
   friend class detail::AnalysisManagerBase<FunctionAnalysisManager, Function *>;
@@ -744,6 +754,7 @@ public:
   // We have to explicitly define all the special member functions because MSVC
   // refuses to generate them.
   FunctionAnalysisManager() {}
+  // The lock is not moved: a manager must not be moved while it is in use.
   FunctionAnalysisManager(FunctionAnalysisManager &&Arg)
       : BaseT(std::move(static_cast<BaseT &>(Arg))),
         FunctionAnalysisResults(std::move(Arg.FunctionAnalysisResults)) {}
@@ -810,6 +821,12 @@ private:
   /// \brief Map from an analysis ID and function to a particular cached
   /// analysis result.
   FunctionAnalysisResultMapT FunctionAnalysisResults;
+
+  /// \brief Guards the two maps above.
+  ///
+  /// It is not held while an analysis runs, so that analyses of different
+  /// functions can run at the same time and an analysis can query others.
+  mutable sys::Mutex ResultsLock;
 };
 
 /// \brief A module analysis which acts as a proxy for a function analysis
@@ -1029,6 +1046,115 @@ createModuleToFunctionPassAdaptor(FunctionPassT Pass) {
   return std::move(ModuleToFunctionPassAdaptor<FunctionPassT>(std::move(Pass)));
 }
 
+/// \brief Adaptor that maps from a module to its functions, running the
+/// function pass over several functions at once.
+///
+/// This is a drop-in replacement for \c ModuleToFunctionPassAdaptor for
+/// function pipelines that are safe to run concurrently on different functions
+/// of the same module. The same pass object is run on every thread, so its
+/// \c run method must not modify the pass itself, and the pipeline must not
+/// touch state shared between functions: it may not create or delete globals,
+/// nor walk the uses of constants or globals, as other threads may be adding
+/// uses to them. Adding and removing uses and the tables of the
+/// \c LLVMContext are synchronized once
+/// \c LLVMContext::enableConcurrentUniquing has been called. Analyses are
+/// cached in the shared \c FunctionAnalysisManager as usual.
+///
+/// Running the adaptor requires the context of the module to have concurrent
+/// uniquing enabled, and the client to have called
+/// \c llvm_start_multithreaded(), unless LLVM is built without threads, in
+/// which case the functions are run one after the other.
+///
+/// The preserved analyses of the module are the same as those computed by the
+/// sequential adaptor, independent of the order in which functions finish.
+template <typename FunctionPassT> class ParallelModuleToFunctionPassAdaptor {
+public:
+  explicit ParallelModuleToFunctionPassAdaptor(FunctionPassT Pass,
+                                               unsigned ThreadCount = 0)
+      : Pass(std::move(Pass)), ThreadCount(ThreadCount) {}
+  // We have to explicitly define all the special member functions because MSVC
+  // refuses to generate them.
+  ParallelModuleToFunctionPassAdaptor(
+      const ParallelModuleToFunctionPassAdaptor &Arg)
+      : Pass(Arg.Pass), ThreadCount(Arg.ThreadCount) {}
+  ParallelModuleToFunctionPassAdaptor(ParallelModuleToFunctionPassAdaptor &&Arg)
+      : Pass(std::move(Arg.Pass)), ThreadCount(Arg.ThreadCount) {}
+  friend void swap(ParallelModuleToFunctionPassAdaptor &LHS,
+                   ParallelModuleToFunctionPassAdaptor &RHS) {
+    using std::swap;
+    swap(LHS.Pass, RHS.Pass);
+    swap(LHS.ThreadCount, RHS.ThreadCount);
+  }
+  ParallelModuleToFunctionPassAdaptor &
+  operator=(ParallelModuleToFunctionPassAdaptor RHS) {
+    swap(*this, RHS);
+    return *this;
+  }
+
+  /// \brief Runs the function pass across every function in the module.
+  PreservedAnalyses run(Module *M, ModuleAnalysisManager *AM) {
+#if LLVM_ENABLE_THREADS
+    assert(M->getContext().hasConcurrentUniquing() &&
+           "The functions of a module share its context");
+    assert(llvm_is_multithreaded() &&
+           "LLVM must be in multithreaded mode to run passes on threads");
+#endif
+    FunctionAnalysisManager *FAM = 0;
+    if (AM)
+      // Setup the function analysis manager from its proxy.
+      FAM = &AM->getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+
+    std::vector<Function *> Functions;
+    for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+      Functions.push_back(I);
+    std::vector<PreservedAnalyses> FunctionPAs(Functions.size());
+
+    {
+      ThreadPool Pool(ThreadCount);
+      for (unsigned Idx = 0, Size = Functions.size(); Idx != Size; ++Idx) {
+        Function *F = Functions[Idx];
+        PreservedAnalyses *FunctionPA = &FunctionPAs[Idx];
+        FunctionPassT *P = &Pass;
+        Pool.async([=] {
+          *FunctionPA = P->run(F, FAM);
+          // As in the sequential adaptor, the pass can only have invalidated
+          // the analyses of this function.
+          if (FAM)
+            FAM->invalidate(F, *FunctionPA);
+        });
+      }
+      Pool.wait();
+    }
+
+    // Intersect in module order so that the result does not depend on the
+    // scheduling of the functions.
+    PreservedAnalyses PA = PreservedAnalyses::all();
+    for (unsigned Idx = 0, Size = FunctionPAs.size(); Idx != Size; ++Idx)
+      PA.intersect(std::move(FunctionPAs[Idx]));
+
+    // By definition we preserve the proxy, see ModuleToFunctionPassAdaptor.
+    PA.preserve<FunctionAnalysisManagerModuleProxy>();
+    return PA;
+  }
+
+  static StringRef name() { return "ParallelModuleToFunctionPassAdaptor"; }
+
+private:
+  FunctionPassT Pass;
+  unsigned ThreadCount;
+};
+
+/// \brief A function to deduce a function pass type and wrap it in the
+/// templated parallel adaptor. A \p ThreadCount of zero uses one thread per
+/// hardware thread.
+template <typename FunctionPassT>
+ParallelModuleToFunctionPassAdaptor<FunctionPassT>
+createParallelModuleToFunctionPassAdaptor(FunctionPassT Pass,
+                                          unsigned ThreadCount = 0) {
+  return std::move(ParallelModuleToFunctionPassAdaptor<FunctionPassT>(
+      std::move(Pass), ThreadCount));
+}
+
 }
 
 #endif
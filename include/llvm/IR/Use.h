@@ -145,13 +145,25 @@ private:
     *List = this;
   }
   void removeFromList() {
+    if (LLVM_UNLIKELY(GuardSharedUseLists))
+      return removeFromGuardedList();
+    unlinkFromList();
+  }
+  void unlinkFromList() {
     Use **StrippedPrev = Prev.getPointer();
     *StrippedPrev = Next;
     if (Next)
       Next->setPrev(StrippedPrev);
   }
+  void removeFromGuardedList();
+
+  /// GuardSharedUseLists - Set once a context enters concurrent uniquing
+  /// mode, after which the use lists of the values the functions of such a
+  /// context share are changed under a lock.
+  static bool GuardSharedUseLists;
 
   friend class Value;
+  friend class LLVMContext;
 };
 
 /// \brief Allow clients to treat uses just like values when using
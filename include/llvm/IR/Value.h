@@ -181,6 +181,8 @@ private:
   void operator=(const Value &) LLVM_DELETED_FUNCTION;
   Value(const Value &) LLVM_DELETED_FUNCTION;
 
+  void addGuardedUse(Use &U);
+
 protected:
   /// printCustom - Value subclasses can override this to implement custom
   /// printing behavior.
@@ -300,7 +302,11 @@ public:
 
   /// addUse - This method should only be used by the Use class.
   ///
-  void addUse(Use &U) { U.addToList(&UseList); }
+  void addUse(Use &U) {
+    if (LLVM_UNLIKELY(Use::GuardSharedUseLists))
+      return addGuardedUse(U);
+    U.addToList(&UseList);
+  }
 
   /// An enumeration for keeping track of the concrete subclass of Value that
   /// is actually instantiated. Values of this enumeration are kept in the 
@@ -75,6 +75,10 @@ struct LTOCodeGenerator {
 
   void setCpu(const char *mCpu) { MCpu = mCpu; }
 
+  // Set the number of partitions that compile_to_files() splits the merged
+  // module into. Each partition is compiled on its own thread.
+  void setParallelism(unsigned N) { Parallelism = N ? N : 1; }
+
   void addMustPreserveSymbol(const char *sym) { MustPreserveSymbols[sym] = 1; }
 
   // To pass options to the driver and optimization passes. These options are
@@ -105,6 +109,22 @@ struct LTOCodeGenerator {
                        bool disableGVNLoadPRE,
                        std::string &errMsg);
 
+  // As with compile_to_file(), but splits the merged module into as many
+  // partitions as set with setParallelism(), compiles them in parallel and
+  // writes each to its own object file. The paths to the "count" object files
+  // are returned via argument "names", in a deterministic order; together they
+  // are equivalent to the single object file compile_to_file() produces.
+  // Return true on success.
+  //
+  // As with compile_to_file(), the linker is responsible for removing the
+  // object files.
+  bool compile_to_files(const char *const **names,
+                        unsigned *count,
+                        bool disableOpt,
+                        bool disableInline,
+                        bool disableGVNLoadPRE,
+                        std::string &errMsg);
+
   // As with compile_to_file(), this function compiles the merged module into
   // single object file. Instead of returning the object-file-path to the caller
   // (linker), it brings the object to a buffer, and return the buffer to the
@@ -129,11 +149,11 @@ struct LTOCodeGenerator {
 private:
   void initializeLTOPasses();
 
-  bool generateObjectFile(llvm::raw_ostream &out,
-                          bool disableOpt,
-                          bool disableInline,
-                          bool disableGVNLoadPRE,
-                          std::string &errMsg);
+  bool generateObjectFiles(llvm::ArrayRef<llvm::raw_ostream *> outs,
+                           bool disableOpt,
+                           bool disableInline,
+                           bool disableGVNLoadPRE,
+                           std::string &errMsg);
   void applyScopeRestrictions();
   void applyRestriction(llvm::GlobalValue &GV,
                         const llvm::ArrayRef<llvm::StringRef> &Libcalls,
@@ -161,6 +181,9 @@ private:
   std::vector<char *> CodegenOptions;
   std::string MCpu;
   std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
+  std::vector<const char *> NativeObjectNames;
+  unsigned Parallelism;
   llvm::TargetOptions Options;
   lto_diagnostic_handler_t DiagHandler;
   void *DiagContext;
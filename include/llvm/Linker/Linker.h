@@ -10,7 +10,10 @@
 #ifndef LLVM_LINKER_LINKER_H
 #define LLVM_LINKER_LINKER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/TinyPtrVector.h"
 #include <string>
 
 namespace llvm {
@@ -49,11 +52,30 @@ class Linker {
     static bool LinkModules(Module *Dest, Module *Src, unsigned Mode,
                             std::string *ErrorMsg);
 
+    /// \brief Only link in the globals of source modules that are needed:
+    /// appending variables, globals named like a global of the composite or
+    /// by addRequiredSymbol, and the globals these refer to, transitively.
+    /// The bodies of the other functions of lazily loaded modules are never
+    /// materialized.
+    void setLinkOnlyNeeded(bool OnlyNeeded) { LinkOnlyNeeded = OnlyNeeded; }
+
+    /// \brief Link in the global named \p Name from the source modules even
+    /// if nothing refers to it, when only linking needed globals.
+    void addRequiredSymbol(StringRef Name) { RequiredSymbols.insert(Name); }
+
   private:
     Module *Composite;
     SmallPtrSet<StructType*, 32> IdentifiedStructTypes;
 
+    /// The non-opaque identified struct types of the composite by a hash of
+    /// their name without a numeric suffix and of their structure, so that
+    /// source types are matched with an isomorphic type by lookup. Opaque
+    /// types are added when a link gives them a body.
+    DenseMap<unsigned, TinyPtrVector<StructType*> > StructTypeIndex;
+
     bool SuppressWarnings;
+    bool LinkOnlyNeeded;
+    StringSet<> RequiredSymbols;
 };
 
 } // End llvm namespace
@@ -14,12 +14,15 @@
 #ifndef LLVM_OBJECT_ARCHIVE_H
 #define LLVM_OBJECT_ARCHIVE_H
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include <atomic>
 
 namespace llvm {
 namespace object {
@@ -83,10 +86,13 @@ public:
       return getHeader()->getAccessMode();
     }
     /// \return the size of the archive member without the header or padding.
-    uint64_t getSize() const { return Data.size() - StartOfFile; }
+    uint64_t getSize() const;
 
+    /// \return the contents of the member stored in the archive. This is
+    /// empty for the members of a thin archive, which only refer to files;
+    /// use getMemoryBuffer to read those.
     StringRef getBuffer() const {
-      return StringRef(Data.data() + StartOfFile, getSize());
+      return StringRef(Data.data() + StartOfFile, Data.size() - StartOfFile);
     }
 
     error_code getMemoryBuffer(OwningPtr<MemoryBuffer> &Result,
@@ -181,6 +187,10 @@ public:
     return Format;
   }
 
+  /// A thin archive only holds the symbol table and the names of its
+  /// members, which are paths to the member files relative to the archive.
+  bool isThin() const { return IsThin; }
+
   child_iterator child_begin(bool SkipInternal = true) const;
   child_iterator child_end() const;
 
@@ -192,16 +202,33 @@ public:
     return v->isArchive();
   }
 
-  // check if a symbol is in the archive
+  /// Find the member defining a symbol, according to the symbol table of
+  /// the archive. Returns child_end() if the symbol is not in the table.
+  ///
+  /// The first call indexes the symbol table by name, so that lookups take
+  /// constant time. This may be called from several threads.
   child_iterator findSym(StringRef name) const;
 
   bool hasSymbolTable() const;
 
 private:
+  /// Maps symbol names to their index in the symbol table.
+  typedef StringMap<uint32_t> SymbolIndexTy;
+
+  const SymbolIndexTy &getSymbolIndex() const;
+
   child_iterator SymbolTable;
   child_iterator StringTable;
   child_iterator FirstRegular;
   Kind Format;
+  bool IsThin;
+
+  /// SymbolIndex owns the index, which is built once under SymbolIndexLock.
+  /// PublishedSymbolIndex points to it once it is complete, after which
+  /// lookups read it without taking the lock.
+  mutable std::unique_ptr<SymbolIndexTy> SymbolIndex;
+  mutable std::atomic<const SymbolIndexTy *> PublishedSymbolIndex;
+  mutable sys::Mutex SymbolIndexLock;
 };
 
 }
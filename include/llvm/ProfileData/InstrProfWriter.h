@@ -40,8 +40,17 @@ public:
   /// summed.
   error_code addFunctionCounts(StringRef FunctionName, uint64_t FunctionHash,
                                ArrayRef<uint64_t> Counters);
-  /// Ensure that all data is written to disk.
-  void write(raw_ostream &OS);
+
+  typedef StringMap<CounterData>::const_iterator const_iterator;
+  /// Iterate over the merged counts, so that the contents of one writer can
+  /// be folded into another with addFunctionCounts.
+  const_iterator begin() const { return FunctionData.begin(); }
+  const_iterator end() const { return FunctionData.end(); }
+  /// Write the profile in the indexed format, which can be looked up by
+  /// function name without reading the whole file. The stream must be
+  /// seekable, since the location of the index is patched into the header
+  /// after the data is written.
+  void write(raw_fd_ostream &OS);
 };
 
 } // end namespace llvm
@@ -0,0 +1,157 @@
+//===- llvm/Support/Parallel.h - Parallel algorithms ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares TaskGroup and the parallel_for_each and parallel_sort
+// algorithms, which run on a ThreadPool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PARALLEL_H
+#define LLVM_SUPPORT_PARALLEL_H
+
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace llvm {
+
+/// A set of tasks running on a ThreadPool that can be waited for as a unit,
+/// independently of the other tasks of the pool.
+///
+/// Unlike ThreadPool::wait, TaskGroup::wait may be called from a task running
+/// in the same pool: while its tasks are not done, the waiting thread runs
+/// other queued tasks of the pool instead of blocking a worker. This makes it
+/// possible to nest parallel algorithms.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &Pool);
+
+  /// Waits for the tasks of the group.
+  ~TaskGroup();
+
+  /// Submit a task to the pool as part of this group.
+  template <typename Function> void spawn(Function &&F) {
+    spawnImpl(ThreadPool::TaskTy(std::forward<Function>(F)));
+  }
+
+  /// Blocking wait for all the tasks spawned in this group so far.
+  void wait();
+
+  ThreadPool &getPool() const { return Pool; }
+
+private:
+  void spawnImpl(ThreadPool::TaskTy Task);
+
+  ThreadPool &Pool;
+
+#if LLVM_ENABLE_THREADS
+  /// Protects Pending.
+  std::mutex Lock;
+
+  /// Signaled when the last pending task of the group has completed.
+  std::condition_variable Done;
+
+  /// The number of tasks spawned but not yet completed.
+  unsigned Pending;
+#endif
+
+  TaskGroup(const TaskGroup &) LLVM_DELETED_FUNCTION;
+  void operator=(const TaskGroup &) LLVM_DELETED_FUNCTION;
+};
+
+/// Call \p Fn on every element of [Begin, End), in parallel on \p Pool.
+///
+/// The range is cut into a few chunks per thread so that uneven elements
+/// balance out. With a single-thread pool every element is processed on the
+/// calling thread, in order.
+template <typename IterTy, typename FuncTy>
+void parallel_for_each(ThreadPool &Pool, IterTy Begin, IterTy End,
+                       FuncTy Fn) {
+  typedef typename std::iterator_traits<IterTy>::difference_type DiffTy;
+  DiffTy N = std::distance(Begin, End);
+  if (N <= 1 || Pool.getThreadCount() == 1) {
+    std::for_each(Begin, End, Fn);
+    return;
+  }
+
+  DiffTy Chunks = std::min<DiffTy>(N, Pool.getThreadCount() * 4);
+  TaskGroup Group(Pool);
+  for (DiffTy C = 0; C != Chunks; ++C) {
+    IterTy ChunkEnd = Begin;
+    std::advance(ChunkEnd, N / Chunks + (C < N % Chunks ? 1 : 0));
+    Group.spawn([=] { std::for_each(Begin, ChunkEnd, Fn); });
+    Begin = ChunkEnd;
+  }
+  Group.wait();
+}
+
+namespace detail {
+/// Ranges smaller than this are not worth sorting in parallel.
+const ptrdiff_t MinParallelSortSize = 1024;
+}
+
+/// Sort [Start, End) with \p Comp, in parallel on \p Pool.
+///
+/// The range is cut into one chunk per thread, the chunks are sorted
+/// concurrently and then merged pairwise. Like std::sort the sort is not
+/// stable; for a given thread count the result is deterministic.
+template <typename RandomAccessIterator, typename Comparator>
+void parallel_sort(ThreadPool &Pool, RandomAccessIterator Start,
+                   RandomAccessIterator End, Comparator Comp) {
+  ptrdiff_t N = End - Start;
+  ptrdiff_t Chunks = std::min<ptrdiff_t>(Pool.getThreadCount(),
+                                         N / detail::MinParallelSortSize);
+  if (Chunks <= 1) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+
+  std::vector<RandomAccessIterator> Bounds;
+  for (ptrdiff_t C = 0; C != Chunks; ++C)
+    Bounds.push_back(Start + N / Chunks * C);
+  Bounds.push_back(End);
+
+  {
+    TaskGroup Group(Pool);
+    for (ptrdiff_t C = 0; C != Chunks; ++C) {
+      RandomAccessIterator B = Bounds[C], E = Bounds[C + 1];
+      Group.spawn([=] { std::sort(B, E, Comp); });
+    }
+  }
+
+  // Merge neighbouring runs, doubling their width every round.
+  for (ptrdiff_t Width = 1; Width < Chunks; Width *= 2) {
+    TaskGroup Group(Pool);
+    for (ptrdiff_t C = 0; C + Width < Chunks; C += 2 * Width) {
+      RandomAccessIterator B = Bounds[C], M = Bounds[C + Width],
+                           E = Bounds[std::min(C + 2 * Width, Chunks)];
+      Group.spawn([=] { std::inplace_merge(B, M, E, Comp); });
+    }
+  }
+}
+
+/// Sort [Start, End) with operator<, in parallel on \p Pool.
+template <typename RandomAccessIterator>
+void parallel_sort(ThreadPool &Pool, RandomAccessIterator Start,
+                   RandomAccessIterator End) {
+  parallel_sort(
+      Pool, Start, End,
+      std::less<typename std::iterator_traits<RandomAccessIterator>::value_type>());
+}
+
+} // End llvm namespace
+
+#endif
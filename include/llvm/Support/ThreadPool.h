@@ -0,0 +1,149 @@
+//===-- llvm/Support/ThreadPool.h - A ThreadPool implementation -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a crude C++11 based thread pool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace llvm {
+
+class TaskGroup;
+
+/// A ThreadPool for asynchronous parallel execution on a defined number of
+/// threads.
+///
+/// Each worker thread owns a queue of tasks. A task submitted from a worker
+/// is pushed onto that worker's queue and is run by it in last-in first-out
+/// order, which keeps the data of nested tasks warm in its cache; tasks
+/// submitted from any other thread are spread over the queues in turn. A
+/// worker whose queue is empty steals the oldest task of another worker.
+///
+/// A pool does not put LLVM in multithreaded mode: tasks which use LLVM, as
+/// opposed to plain code, require the client to have called
+/// llvm_start_multithreaded() before creating the pool.
+///
+/// When LLVM is built without thread support every task runs synchronously,
+/// in order, inside async(), so results are deterministic either way as long
+/// as the tasks themselves are independent.
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+  typedef std::packaged_task<void()> PackagedTaskTy;
+
+  /// Construct a pool with one thread per hardware thread.
+  ThreadPool();
+
+  /// Construct a pool of \p ThreadCount threads. A count of zero means one
+  /// thread per hardware thread.
+  explicit ThreadPool(unsigned ThreadCount);
+
+  /// Blocking destructor: the pool will wait for all the threads to complete.
+  ~ThreadPool();
+
+  /// Asynchronous submission of a task to the pool. The returned future can be
+  /// used to wait for the task to finish, and is ready once it has.
+  template <typename Function>
+  std::shared_future<void> async(Function &&F) {
+    return asyncImpl(TaskTy(std::forward<Function>(F)));
+  }
+
+  /// Blocking wait for all the tasks submitted so far to complete. This must
+  /// not be called from a task running in the pool.
+  void wait();
+
+  /// Returns the number of worker threads in the pool.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+private:
+  friend class TaskGroup;
+
+  /// Asynchronous submission of a task to the pool.
+  std::shared_future<void> asyncImpl(TaskTy F);
+
+  /// Run one of the queued tasks on the calling thread, if there is any.
+  /// Returns false if there was nothing to run.
+  bool runPendingTask();
+
+  unsigned ThreadCount;
+
+#if LLVM_ENABLE_THREADS
+  /// The queue of one worker thread.
+  struct WorkerQueue {
+    std::mutex Lock;
+    std::deque<PackagedTaskTy> Tasks;
+  };
+
+  /// Create the queues and start the worker threads.
+  void startThreads();
+
+  /// The main loop of worker \p Index.
+  void work(unsigned Index);
+
+  /// Pop and run a task that has already been claimed, starting the search
+  /// at the queue of worker \p Index.
+  void runClaimedTask(unsigned Index);
+
+  /// Pop a task for worker \p Index, from its own queue or else by stealing
+  /// from another one. Returns false if there is no task to run.
+  bool popTask(unsigned Index, PackagedTaskTy &Task);
+
+  /// Returns the index of the worker running on this thread, or ThreadCount
+  /// if this thread is not one of the workers.
+  unsigned getCurrentWorker() const;
+
+  /// The worker threads and their queues, with the same indices.
+  std::vector<std::thread> Threads;
+  std::vector<std::unique_ptr<WorkerQueue>> Queues;
+
+  /// Protects the counters and the condition variables below.
+  std::mutex StateLock;
+
+  /// Signaled when a task has been queued, or the pool is shutting down.
+  std::condition_variable WorkAvailable;
+
+  /// Signaled when the last outstanding task has completed.
+  std::condition_variable AllDone;
+
+  /// The number of tasks sitting in the queues.
+  unsigned QueuedTasks;
+
+  /// The number of tasks submitted but not yet completed.
+  unsigned OutstandingTasks;
+
+  /// The queue that the next task submitted from outside the pool goes to.
+  unsigned NextQueue;
+
+  /// Set when the pool is being destroyed.
+  bool ShuttingDown;
+#endif
+
+  ThreadPool(const ThreadPool &) LLVM_DELETED_FUNCTION;
+  void operator=(const ThreadPool &) LLVM_DELETED_FUNCTION;
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,83 @@
+//===- llvm/Support/TimeProfiler.h - Compile time trace ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a tracer of where compile time goes. While it is enabled,
+// TimeTraceScope objects record the time each region of code takes, which is
+// written as a trace in the Chrome trace event format, viewable in
+// chrome://tracing. When it is disabled, a TimeTraceScope costs a load and a
+// compare.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIMEPROFILER_H
+#define LLVM_SUPPORT_TIMEPROFILER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include <string>
+
+namespace llvm {
+
+class raw_ostream;
+class TimeTraceProfiler;
+
+/// The profiler recording events, or null if tracing is disabled.
+extern TimeTraceProfiler *TimeTraceProfilerInstance;
+
+/// \brief Start recording events. Events shorter than \p Granularity
+/// microseconds are dropped, to keep the trace of a large compilation small.
+void timeTraceProfilerInitialize(unsigned Granularity = 500);
+
+/// \brief Stop recording events and free the recorded ones.
+void timeTraceProfilerCleanup();
+
+/// \brief Return whether events are recorded.
+inline bool timeTraceProfilerEnabled() {
+  return TimeTraceProfilerInstance != 0;
+}
+
+/// \brief Write the events recorded so far as a Chrome trace JSON object.
+/// Threads appear as separate tracks of the process \p ProcessName.
+void timeTraceProfilerWrite(raw_ostream &OS, StringRef ProcessName);
+
+/// \brief Write the events recorded so far to the file \p Path, as above.
+/// Returns false, with \p ErrorInfo describing the error, if the file could
+/// not be opened.
+bool timeTraceProfilerWrite(StringRef Path, StringRef ProcessName,
+                            std::string &ErrorInfo);
+
+/// \brief Begin an event named \p Name, with \p Detail telling apart events
+/// of the same name, like the function a pass runs on. Events of a thread
+/// must be properly nested.
+void timeTraceProfilerBegin(StringRef Name, StringRef Detail);
+
+/// \brief End the innermost event of this thread.
+void timeTraceProfilerEnd();
+
+/// TimeTraceScope - Record an event for the lifetime of this object, if
+/// tracing is enabled.
+class TimeTraceScope {
+  bool Active;
+  TimeTraceScope(const TimeTraceScope &) LLVM_DELETED_FUNCTION;
+  void operator=(const TimeTraceScope &) LLVM_DELETED_FUNCTION;
+public:
+  explicit TimeTraceScope(StringRef Name, StringRef Detail = StringRef())
+    : Active(timeTraceProfilerEnabled()) {
+    if (Active)
+      timeTraceProfilerBegin(Name, Detail);
+  }
+  ~TimeTraceScope() {
+    if (Active)
+      timeTraceProfilerEnd();
+  }
+};
+
+} // End llvm namespace
+
+#endif
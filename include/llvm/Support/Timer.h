@@ -13,6 +13,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <cassert>
 #include <string>
 #include <utility>
@@ -81,6 +82,7 @@ class Timer {
   TimeRecord Time;
   std::string Name;      // The name of this time variable.
   bool Started;          // Has this time variable ever been started?
+  bool Running;          // Is the timer currently running?
   TimerGroup *TG;        // The TimerGroup this Timer is in.
   
   Timer **Prev, *Next;   // Doubly linked list of timers in the group.
@@ -144,8 +146,11 @@ public:
 /// Timer.  It allows you to declare a new timer, AND specify the region to
 /// time, all in one statement.  All timers with the same name are merged.  This
 /// is primarily used for debugging and for hunting performance problems.
+/// The region is recorded by the time trace profiler too, when it is enabled.
 ///
 struct NamedRegionTimer : public TimeRegion {
+  TimeTraceScope Trace;
+
   explicit NamedRegionTimer(StringRef Name,
                             bool Enabled = true);
   explicit NamedRegionTimer(StringRef Name, StringRef GroupName,
@@ -180,9 +185,15 @@ public:
   
 private:
   friend class Timer;
+  friend struct TimerJSONReport;
   void addTimer(Timer &T);
   void removeTimer(Timer &T);
+  bool queueStartedTimers();
+  void addJSONGroup(std::string &Groups);
+  static void addStartedJSONGroups(std::string &Groups);
   void PrintQueuedTimers(raw_ostream &OS);
+  void PrintQueuedTimersJSON(raw_ostream &OS);
+  void PrintQueuedTimersCSV(raw_ostream &OS);
 };
 
 } // End llvm namespace
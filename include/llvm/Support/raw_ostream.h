@@ -199,6 +199,14 @@ public:
   /// anything that doesn't satisfy std::isprint into an escape sequence.
   raw_ostream &write_escaped(StringRef Str, bool UseHexEscapes = false);
 
+  /// write_json_string - Output \p Str as a quoted JSON string, escaping
+  /// '"', '\\' and the control characters.
+  raw_ostream &write_json_string(StringRef Str);
+
+  /// write_csv_field - Output \p Str as a CSV field, quoted if it holds a
+  /// comma, a quote or a line break.
+  raw_ostream &write_csv_field(StringRef Str);
+
   raw_ostream &write(unsigned char C);
   raw_ostream &write(const char *Ptr, size_t Size);
 
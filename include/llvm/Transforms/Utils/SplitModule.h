@@ -0,0 +1,45 @@
+//===- SplitModule.h - Split a module into partitions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include <memory>
+#include <vector>
+
+namespace llvm {
+
+class Module;
+
+/// Splits the module M into N linkable partitions, which are appended to
+/// Partitions in order. Linking the partitions together is intended to be
+/// equivalent to linking M itself.
+///
+/// Functions that are part of the same call graph SCC are kept together, as
+/// are aliases and the globals they alias. The remaining groups are assigned
+/// greedily to the least loaded partition, largest first, so the result only
+/// depends on M. Module level inline asm and globals with appending linkage
+/// are always placed in the first partition.
+///
+/// Each partition holds a declaration of every global that is defined in
+/// another partition. Local symbols that are referenced from another partition
+/// are renamed, and given external linkage and hidden visibility; this is done
+/// to M itself before it is cloned.
+void SplitModule(Module &M, unsigned N,
+                 std::vector<std::unique_ptr<Module>> &Partitions);
+
+} // End llvm namespace
+
+#endif
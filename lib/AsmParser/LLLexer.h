@@ -17,6 +17,7 @@
 #include "LLToken.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/SourceMgr.h"
 #include <string>
 
@@ -36,7 +37,11 @@ namespace llvm {
     // Information about the current token.
     const char *TokStart;
     lltok::Kind CurKind;
-    std::string StrVal;
+    /// StrVal - The name or string of the current token, pointing into the
+    /// buffer unless the token had escapes, in which case it points to the
+    /// unescaped copy in UnescapedStr.
+    StringRef StrVal;
+    std::string UnescapedStr;
     unsigned UIntVal;
     Type *TyVal;
     APFloat APFloatVal;
@@ -54,7 +59,9 @@ namespace llvm {
     typedef SMLoc LocTy;
     LocTy getLoc() const { return SMLoc::getFromPointer(TokStart); }
     lltok::Kind getKind() const { return CurKind; }
-    const std::string &getStrVal() const { return StrVal; }
+    /// getStrVal - Return the string value of the current token, which is
+    /// only valid until the next token is lexed.
+    StringRef getStrVal() const { return StrVal; }
     Type *getTyVal() const { return TyVal; }
     unsigned getUIntVal() const { return UIntVal; }
     const APSInt &getAPSIntVal() const { return APSIntVal; }
@@ -71,6 +78,7 @@ namespace llvm {
     int getNextChar();
     void SkipLineComment();
     lltok::Kind ReadString(lltok::Kind kind);
+    void setStrVal(const char *Start, const char *End);
     bool ReadVarName();
 
     lltok::Kind LexIdentifier();
@@ -2005,7 +2005,7 @@ LLParser::PerFunctionState::PerFunctionState(LLParser &p, Function &f,
 
 LLParser::PerFunctionState::~PerFunctionState() {
   // If there were any forward referenced non-basicblock values, delete them.
-  for (std::map<std::string, std::pair<Value*, LocTy> >::iterator
+  for (StringMap<std::pair<Value*, LocTy> >::iterator
        I = ForwardRefVals.begin(), E = ForwardRefVals.end(); I != E; ++I)
     if (!isa<BasicBlock>(I->second.first)) {
       I->second.first->replaceAllUsesWith(
@@ -2014,7 +2014,7 @@ LLParser::PerFunctionState::~PerFunctionState() {
       I->second.first = 0;
     }
 
-  for (std::map<unsigned, std::pair<Value*, LocTy> >::iterator
+  for (DenseMap<unsigned, std::pair<Value*, LocTy> >::iterator
        I = ForwardRefValIDs.begin(), E = ForwardRefValIDs.end(); I != E; ++I)
     if (!isa<BasicBlock>(I->second.first)) {
       I->second.first->replaceAllUsesWith(
@@ -2047,14 +2047,26 @@ bool LLParser::PerFunctionState::FinishFunction() {
     }
   }
 
-  if (!ForwardRefVals.empty())
-    return P.Error(ForwardRefVals.begin()->second.second,
-                   "use of undefined value '%" + ForwardRefVals.begin()->first +
-                   "'");
-  if (!ForwardRefValIDs.empty())
-    return P.Error(ForwardRefValIDs.begin()->second.second,
-                   "use of undefined value '%" +
-                   Twine(ForwardRefValIDs.begin()->first) + "'");
+  if (!ForwardRefVals.empty()) {
+    StringMap<std::pair<Value*, LocTy> >::iterator
+      First = ForwardRefVals.begin();
+    for (StringMap<std::pair<Value*, LocTy> >::iterator
+         I = ForwardRefVals.begin(), E = ForwardRefVals.end(); I != E; ++I)
+      if (I->getKey() < First->getKey())
+        First = I;
+    return P.Error(First->second.second,
+                   "use of undefined value '%" + First->getKey() + "'");
+  }
+  if (!ForwardRefValIDs.empty()) {
+    DenseMap<unsigned, std::pair<Value*, LocTy> >::iterator
+      First = ForwardRefValIDs.begin();
+    for (DenseMap<unsigned, std::pair<Value*, LocTy> >::iterator
+         I = ForwardRefValIDs.begin(), E = ForwardRefValIDs.end(); I != E; ++I)
+      if (I->first < First->first)
+        First = I;
+    return P.Error(First->second.second,
+                   "use of undefined value '%" + Twine(First->first) + "'");
+  }
   return false;
 }
 
@@ -2070,7 +2082,7 @@ Value *LLParser::PerFunctionState::GetVal(const std::string &Name,
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
   if (Val == 0) {
-    std::map<std::string, std::pair<Value*, LocTy> >::iterator
+    StringMap<std::pair<Value*, LocTy> >::iterator
       I = ForwardRefVals.find(Name);
     if (I != ForwardRefVals.end())
       Val = I->second.first;
@@ -2112,7 +2124,12 @@ Value *LLParser::PerFunctionState::GetVal(unsigned ID, Type *Ty,
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
   if (Val == 0) {
-    std::map<unsigned, std::pair<Value*, LocTy> >::iterator
+    // The two largest numbers are reserved by the forward reference table.
+    if (ID >= DenseMapInfo<unsigned>::getTombstoneKey()) {
+      P.Error(Loc, "invalid value number (too large)!");
+      return 0;
+    }
+    DenseMap<unsigned, std::pair<Value*, LocTy> >::iterator
       I = ForwardRefValIDs.find(ID);
     if (I != ForwardRefValIDs.end())
       Val = I->second.first;
@@ -2168,7 +2185,7 @@ bool LLParser::PerFunctionState::SetInstName(int NameID,
       return P.Error(NameLoc, "instruction expected to be numbered '%" +
                      Twine(NumberedVals.size()) + "'");
 
-    std::map<unsigned, std::pair<Value*, LocTy> >::iterator FI =
+    DenseMap<unsigned, std::pair<Value*, LocTy> >::iterator FI =
       ForwardRefValIDs.find(NameID);
     if (FI != ForwardRefValIDs.end()) {
       if (FI->second.first->getType() != Inst->getType())
@@ -2184,7 +2201,7 @@ bool LLParser::PerFunctionState::SetInstName(int NameID,
   }
 
   // Otherwise, the instruction had a name.  Resolve forward refs and set it.
-  std::map<std::string, std::pair<Value*, LocTy> >::iterator
+  StringMap<std::pair<Value*, LocTy> >::iterator
     FI = ForwardRefVals.find(NameStr);
   if (FI != ForwardRefVals.end()) {
     if (FI->second.first->getType() != Inst->getType())
@@ -270,8 +270,12 @@ namespace llvm {
     class PerFunctionState {
       LLParser &P;
       Function &F;
-      std::map<std::string, std::pair<Value*, LocTy> > ForwardRefVals;
-      std::map<unsigned, std::pair<Value*, LocTy> > ForwardRefValIDs;
+      /// ForwardRefVals, ForwardRefValIDs - The placeholders for the local
+      /// values used before their definition, by name and by number.  These
+      /// are hash tables since a large function refers to many values ahead;
+      /// errors report the smallest key to stay deterministic.
+      StringMap<std::pair<Value*, LocTy> > ForwardRefVals;
+      DenseMap<unsigned, std::pair<Value*, LocTy> > ForwardRefValIDs;
       std::vector<Value*> NumberedVals;
 
       /// FunctionNumber - If this is an unnamed function, this is the slot
@@ -9,6 +9,7 @@
 
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "BitcodeReader.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
@@ -1632,6 +1633,71 @@ error_code BitcodeReader::RememberAndSkipFunctionBody() {
   return error_code::success();
 }
 
+/// ParseFunctionIndex - Read the FUNCTION_INDEX block and remember where each
+/// function body is, without visiting the function blocks themselves.  This
+/// is called from the module block when the first function block is seen, and
+/// leaves the stream just past the index, which follows the last function.
+error_code BitcodeReader::ParseFunctionIndex() {
+  // The recorded offsets are the start of each function block in the module
+  // block.  Lazy materialization resumes after the abbrev ID and block ID,
+  // which is where RememberAndSkipFunctionBody would have left the stream.
+  uint64_t BodyDelta = Stream.getAbbrevIDWidth() + bitc::BlockIDWidth;
+
+  Stream.JumpToBit(FunctionIndexBit);
+  BitstreamEntry Entry = Stream.advance();
+  if (Entry.Kind != BitstreamEntry::SubBlock ||
+      Entry.ID != bitc::FUNCTION_INDEX_BLOCK_ID)
+    return Error(MalformedBlock);
+  if (Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return Error(InvalidRecord);
+
+  SmallPtrSet<Function*, 32> Pending;
+  Pending.insert(FunctionsWithBodies.begin(), FunctionsWithBodies.end());
+
+  SmallVector<uint64_t, 4> Record;
+
+  // Read all the records for this index.
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error(MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      // Every function with a body must have been indexed.
+      if (!Pending.empty())
+        return Error(InsufficientFunctionProtos);
+      FunctionsWithBodies.clear();
+      return error_code::success();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    // Read a record.
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default:  // Default behavior: unknown type.
+      break;
+    case bitc::FNINDEX_CODE_ENTRY: { // ENTRY: [valueid, offset]
+      if (Record.size() < 2)
+        return Error(InvalidRecord);
+      if (Record[0] >= ValueList.size())
+        return Error(InvalidID);
+      Function *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      if (!F || !Pending.erase(F))
+        return Error(InvalidID);
+      // The function blocks all precede the index.
+      if (Record[1] >= FunctionIndexBit - ModuleContentsBit)
+        return Error(InvalidRecord);
+      DeferredFunctionInfo[F] = ModuleContentsBit + Record[1] + BodyDelta;
+      break;
+    }
+    }
+  }
+}
+
 error_code BitcodeReader::GlobalCleanup() {
   // Patch the initializers for globals and aliases up.
   ResolveGlobalAndAliasInits();
@@ -1663,6 +1729,8 @@ error_code BitcodeReader::ParseModule(bool Resume) {
     Stream.JumpToBit(NextUnreadBit);
   else if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
     return Error(InvalidRecord);
+  else
+    ModuleContentsBit = Stream.GetCurrentBitNo();
 
   SmallVector<uint64_t, 64> Record;
   std::vector<std::string> SectionTable;
@@ -1723,6 +1791,15 @@ error_code BitcodeReader::ParseModule(bool Resume) {
           if (error_code EC = GlobalCleanup())
             return EC;
           SeenFirstFunctionBody = true;
+
+          // If the module indexes its function bodies, read that instead of
+          // skipping over every function block.  This isn't possible when
+          // streaming, since the index follows the bodies.
+          if (FunctionIndexBit && !LazyStreamer) {
+            if (error_code EC = ParseFunctionIndex())
+              return EC;
+            continue;
+          }
         }
 
         if (error_code EC = RememberAndSkipFunctionBody())
@@ -1963,6 +2040,17 @@ error_code BitcodeReader::ParseModule(bool Resume) {
         return Error(InvalidRecord);
       ValueList.shrinkTo(Record[0]);
       break;
+    /// MODULE_CODE_FNINDEXOFFSET: [offset]
+    case bitc::MODULE_CODE_FNINDEXOFFSET: {
+      // The offset of the index is in 32-bit words. It is zero if the writer
+      // never patched it.
+      if (Record.size() < 1)
+        return Error(InvalidRecord);
+      uint64_t Offset = Record[0];
+      if (Offset)
+        FunctionIndexBit = ModuleContentsBit + 32 * Offset;
+      break;
+    }
     }
     Record.clear();
   }
@@ -179,6 +179,15 @@ class BitcodeReader : public GVMaterializer {
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// ModuleContentsBit - The position of the first entry in the MODULE_BLOCK,
+  /// which the offsets in the function index are relative to.
+  uint64_t ModuleContentsBit;
+
+  /// FunctionIndexBit - If the module has a FUNCTION_INDEX block, this is
+  /// where it starts. Otherwise it is zero, and the function blocks have to be
+  /// scanned to find each body.
+  uint64_t FunctionIndexBit;
+
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
   typedef std::pair<unsigned, GlobalVariable*> BlockAddrRefTy;
@@ -227,13 +236,15 @@ public:
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       LazyStreamer(0), NextUnreadBit(0), SeenValueSymbolTable(false),
       ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), ModuleContentsBit(0),
+      FunctionIndexBit(0), UseRelativeIDs(false) {
   }
   explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(0), BufferOwned(false),
       LazyStreamer(streamer), NextUnreadBit(0), SeenValueSymbolTable(false),
       ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), ModuleContentsBit(0),
+      FunctionIndexBit(0), UseRelativeIDs(false) {
   }
   ~BitcodeReader() {
     FreeState();
@@ -356,6 +367,7 @@ private:
   error_code ParseValueSymbolTable();
   error_code ParseConstants();
   error_code RememberAndSkipFunctionBody();
+  error_code ParseFunctionIndex();
   error_code ParseFunctionBody(Function *F);
   error_code GlobalCleanup();
   error_code ResolveGlobalAndAliasInits();
@@ -1884,15 +1884,75 @@ static void WriteModuleUseLists(const Module *M, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+/// WriteFunctionIndexOffset - Emit a placeholder for the location of the
+/// FUNCTION_INDEX block, returning the bit position of the field that
+/// WriteFunctionIndex patches once the function blocks have been written.
+static uint64_t WriteFunctionIndexOffset(BitstreamWriter &Stream) {
+  // The offset is emitted as a fixed width field, so that it can be patched
+  // in place.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEXOFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned FnIndexOffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(0);
+  Stream.EmitRecord(bitc::MODULE_CODE_FNINDEXOFFSET, Vals, FnIndexOffsetAbbrev);
+  return Stream.GetCurrentBitNo() - 32;
+}
+
+/// WriteFunctionIndex - Emit the FUNCTION_INDEX block, which records the
+/// start of each function block relative to ModuleContentsBit, and patch the
+/// placeholder at FnIndexOffsetPos to point at it.
+static void WriteFunctionIndex(
+    const std::vector<std::pair<unsigned, uint64_t> > &FunctionOffsets,
+    uint64_t ModuleContentsBit, uint64_t FnIndexOffsetPos,
+    BitstreamWriter &Stream) {
+  // The index follows the last function block, which ends word aligned.
+  uint64_t IndexBit = Stream.GetCurrentBitNo();
+  assert((IndexBit & 31) == 0 && "Function index not word aligned!");
+  Stream.BackpatchField(FnIndexOffsetPos, (IndexBit - ModuleContentsBit) / 32);
+
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FNINDEX_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 2> Vals;
+  for (unsigned i = 0, e = FunctionOffsets.size(); i != e; ++i) {
+    Vals.push_back(FunctionOffsets[i].first);
+    Vals.push_back(FunctionOffsets[i].second);
+    Stream.EmitRecord(bitc::FNINDEX_CODE_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
 static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+  uint64_t ModuleContentsBit = Stream.GetCurrentBitNo();
 
   SmallVector<unsigned, 1> Vals;
   unsigned CurVersion = 1;
   Vals.push_back(CurVersion);
   Stream.EmitRecord(bitc::MODULE_CODE_VERSION, Vals);
 
+  // If there are function bodies, leave room to say where their index is.
+  bool HasFunctionBodies = false;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration()) {
+      HasFunctionBodies = true;
+      break;
+    }
+  uint64_t FnIndexOffsetPos = 0;
+  if (HasFunctionBodies)
+    FnIndexOffsetPos = WriteFunctionIndexOffset(Stream);
+
   // Analyze the module, enumerating globals, functions, etc.
   ValueEnumerator VE(M);
 
@@ -1928,10 +1988,20 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   if (EnablePreserveUseListOrdering)
     WriteModuleUseLists(M, VE, Stream);
 
-  // Emit function bodies.
+  // Emit function bodies, remembering where each one starts.
+  std::vector<std::pair<unsigned, uint64_t> > FunctionOffsets;
   for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
+    if (!F->isDeclaration()) {
+      FunctionOffsets.push_back(std::make_pair(
+          VE.getValueID(F), Stream.GetCurrentBitNo() - ModuleContentsBit));
       WriteFunction(*F, VE, Stream);
+    }
+
+  // Emit the index of the function bodies, so that readers can find any one
+  // of them without scanning the others.
+  if (HasFunctionBodies)
+    WriteFunctionIndex(FunctionOffsets, ModuleContentsBit, FnIndexOffsetPos,
+                       Stream);
 
   Stream.ExitBlock();
 }
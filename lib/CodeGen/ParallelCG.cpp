@@ -0,0 +1,142 @@
+//===-- ParallelCG.cpp ----------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetLibraryInfo.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+
+using namespace llvm;
+
+namespace {
+/// The state needed to generate code for one partition.
+struct PartitionJob {
+  const Target *TheTarget;
+  std::string TripleStr;
+  std::string CPU;
+  std::string Features;
+  TargetOptions Options;
+  Reloc::Model RM;
+  CodeModel::Model CM;
+  CodeGenOpt::Level OL;
+  TargetMachine::CodeGenFileType FT;
+  SmallString<0> Bitcode;
+  raw_ostream *OS;
+};
+}
+
+/// Generate code for one partition, in a context of its own.
+static void codegenPartition(PartitionJob &Job) {
+  LLVMContext Context;
+  std::unique_ptr<MemoryBuffer> Buffer(MemoryBuffer::getMemBuffer(
+      StringRef(Job.Bitcode.data(), Job.Bitcode.size()), "<split-module>",
+      false));
+  ErrorOr<Module *> MOrErr = parseBitcodeFile(Buffer.get(), Context);
+  if (error_code EC = MOrErr.getError())
+    report_fatal_error("Could not read split module: " + EC.message());
+  std::unique_ptr<Module> M(MOrErr.get());
+
+  std::unique_ptr<TargetMachine> TM(Job.TheTarget->createTargetMachine(
+      Job.TripleStr, Job.CPU, Job.Features, Job.Options, Job.RM, Job.CM,
+      Job.OL));
+
+  PassManager PM;
+  PM.add(new TargetLibraryInfo(Triple(Job.TripleStr)));
+  if (const DataLayout *DL = TM->getDataLayout())
+    M->setDataLayout(DL);
+  PM.add(new DataLayoutPass(M.get()));
+
+  {
+    formatted_raw_ostream FOS(*Job.OS);
+    // The file type was checked by splitCodeGen before any thread started.
+    bool Unsupported = TM->addPassesToEmitFile(PM, FOS, Job.FT);
+    assert(!Unsupported && "File type not supported by the target");
+    (void)Unsupported;
+    PM.run(*M);
+  }
+
+  // The bitcode is no longer needed once the module has been compiled.
+  Job.Bitcode.clear();
+}
+
+bool llvm::splitCodeGen(Module &M, ArrayRef<raw_ostream *> OSs, StringRef CPU,
+                        StringRef Features, const TargetOptions &Options,
+                        Reloc::Model RM, CodeModel::Model CM,
+                        CodeGenOpt::Level OL,
+                        TargetMachine::CodeGenFileType FT,
+                        std::string &ErrMsg) {
+  assert(!OSs.empty() && "No output streams");
+
+  std::string TripleStr = M.getTargetTriple();
+  const Target *TheTarget = TargetRegistry::lookupTarget(TripleStr, ErrMsg);
+  if (!TheTarget)
+    return true;
+
+  // Make sure the target can emit this file type before any work is done.
+  {
+    std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+        TripleStr, CPU, Features, Options, RM, CM, OL));
+    PassManager PM;
+    formatted_raw_ostream FOS(nulls());
+    if (TM->addPassesToEmitFile(PM, FOS, FT)) {
+      ErrMsg = "target does not support generation of this file type";
+      return true;
+    }
+  }
+
+  std::vector<std::unique_ptr<Module>> Partitions;
+  SplitModule(M, OSs.size(), Partitions);
+
+  // Each partition travels to its thread as bitcode, since a module cannot be
+  // moved from one context to another.
+  std::vector<PartitionJob> Jobs(Partitions.size());
+  for (unsigned I = 0, E = Partitions.size(); I != E; ++I) {
+    PartitionJob &Job = Jobs[I];
+    Job.TheTarget = TheTarget;
+    Job.TripleStr = TripleStr;
+    Job.CPU = CPU;
+    Job.Features = Features;
+    Job.Options = Options;
+    Job.RM = RM;
+    Job.CM = CM;
+    Job.OL = OL;
+    Job.FT = FT;
+    Job.OS = OSs[I];
+    raw_svector_ostream BCOS(Job.Bitcode);
+    WriteBitcodeToFile(Partitions[I].get(), BCOS);
+    BCOS.flush();
+    Partitions[I].reset();
+  }
+
+  if (Jobs.size() == 1) {
+    codegenPartition(Jobs[0]);
+    return false;
+  }
+
+  // The partitions are compiled independently of each other, so give each
+  // one a thread of its own.
+  ThreadPool Pool(Jobs.size());
+  parallel_for_each(Pool, Jobs.begin(), Jobs.end(), codegenPartition);
+  return false;
+}
@@ -0,0 +1,111 @@
+//===-- DWARFAddressIndex.cpp ---------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DWARFAddressIndex.h"
+#include "DWARFContext.h"
+#include <algorithm>
+using namespace llvm;
+
+namespace {
+/// A line table sequence of one compile unit.
+struct SequenceRef {
+  uint32_t CUIndex;
+  const DWARFDebugLine::LineTable *LineTable;
+  const DWARFDebugLine::Sequence *Seq;
+  bool Overlaps;
+
+  bool operator<(const SequenceRef &Other) const {
+    return Seq->LowPC < Other.Seq->LowPC;
+  }
+};
+}
+
+void DWARFAddressIndex::generate(DWARFContext *CTX) {
+  Entries.clear();
+
+  std::vector<SequenceRef> Sequences;
+  for (uint32_t I = 0, E = CTX->getNumCompileUnits(); I != E; ++I) {
+    const DWARFDebugLine::LineTable *LineTable =
+        CTX->getLineTableForCompileUnit(CTX->getCompileUnitAtIndex(I));
+    if (!LineTable)
+      continue;
+    for (const auto &Seq : LineTable->Sequences) {
+      if (!Seq.isValid())
+        continue;
+      SequenceRef Ref = { I, LineTable, &Seq, false };
+      Sequences.push_back(Ref);
+    }
+  }
+  std::stable_sort(Sequences.begin(), Sequences.end());
+
+  // Mark every sequence that shares an address with another one.
+  uint64_t MaxHighPC = 0;
+  size_t MaxIndex = 0;
+  for (size_t I = 0, E = Sequences.size(); I != E; ++I) {
+    const DWARFDebugLine::Sequence &Seq = *Sequences[I].Seq;
+    if (I != 0 && Seq.LowPC < MaxHighPC) {
+      Sequences[I].Overlaps = true;
+      Sequences[MaxIndex].Overlaps = true;
+    }
+    if (I == 0 || Seq.HighPC > MaxHighPC) {
+      MaxHighPC = Seq.HighPC;
+      MaxIndex = I;
+    }
+  }
+
+  for (const auto &Ref : Sequences) {
+    if (Ref.Overlaps)
+      continue;
+    const DWARFDebugLine::Sequence &Seq = *Ref.Seq;
+    // The last row of a sequence only marks its end. Of several rows at the
+    // same address, the line table lookup returns the first one for that very
+    // address, and the last one for the addresses that follow.
+    const DWARFDebugLine::LineTable::RowVector &Rows = Ref.LineTable->Rows;
+    uint32_t Row = Seq.FirstRowIndex;
+    while (Row + 1 < Seq.LastRowIndex && Rows[Row].Address < Seq.HighPC) {
+      uint64_t Address = Rows[Row].Address;
+      uint32_t Last = Row;
+      while (Last + 2 < Seq.LastRowIndex && Rows[Last + 1].Address == Address)
+        ++Last;
+      Entries.push_back(Entry(Address, Ref.CUIndex, Row));
+      if (Last != Row && Address + 1 < Rows[Last + 1].Address)
+        Entries.push_back(Entry(Address + 1, Ref.CUIndex, Last));
+      Row = Last + 1;
+    }
+    Entries.push_back(Entry(Seq.HighPC, Ref.CUIndex, -1U));
+  }
+
+  // The remaining sequences are disjoint, so the entries are sorted. The end
+  // marker of a sequence and the start of the next one may share an address;
+  // drop the marker then.
+  std::vector<Entry> Minimal;
+  Minimal.reserve(Entries.size());
+  for (size_t I = 0, E = Entries.size(); I != E; ++I) {
+    if (Entries[I].isEnd() && I + 1 != E &&
+        Entries[I + 1].Address == Entries[I].Address)
+      continue;
+    Minimal.push_back(Entries[I]);
+  }
+  Entries.swap(Minimal);
+}
+
+bool DWARFAddressIndex::findAddress(uint64_t Address, uint32_t &CUIndex,
+                                    uint32_t &RowIndex) const {
+  std::vector<Entry>::const_iterator I = std::upper_bound(
+      Entries.begin(), Entries.end(), Address,
+      [](uint64_t Address, const Entry &E) { return Address < E.Address; });
+  if (I == Entries.begin())
+    return false;
+  --I;
+  if (I->isEnd())
+    return false;
+  CUIndex = I->CUIndex;
+  RowIndex = I->RowIndex;
+  return true;
+}
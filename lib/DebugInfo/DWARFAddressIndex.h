@@ -0,0 +1,59 @@
+//===-- DWARFAddressIndex.h -------------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_DEBUGINFO_DWARFADDRESSINDEX_H
+#define LLVM_DEBUGINFO_DWARFADDRESSINDEX_H
+
+#include "llvm/Support/DataTypes.h"
+#include <vector>
+
+namespace llvm {
+
+class DWARFContext;
+
+/// A flat index from instruction addresses to the line table rows describing
+/// them, over all the compile units of a context.
+///
+/// Each entry gives the start address of a row, and the row applies up to the
+/// address of the next entry. Addresses covered by more than one line table
+/// sequence are left out, so that a lookup never has to pick between
+/// sequences; callers fall back to searching the line table of the compile
+/// unit for these.
+class DWARFAddressIndex {
+public:
+  void generate(DWARFContext *CTX);
+
+  /// Find the row describing \p Address. Returns false if the address is not
+  /// in the index, otherwise sets \p CUIndex to the index of the compile unit
+  /// in the context and \p RowIndex to the row in its line table.
+  bool findAddress(uint64_t Address, uint32_t &CUIndex,
+                   uint32_t &RowIndex) const;
+
+  size_t size() const { return Entries.size(); }
+
+private:
+  struct Entry {
+    uint64_t Address;
+    uint32_t CUIndex;
+    // The row in the line table of the compile unit, or -1U for the end of a
+    // sequence.
+    uint32_t RowIndex;
+
+    Entry(uint64_t Address, uint32_t CUIndex, uint32_t RowIndex)
+        : Address(Address), CUIndex(CUIndex), RowIndex(RowIndex) {}
+
+    bool isEnd() const { return RowIndex == -1U; }
+  };
+
+  std::vector<Entry> Entries;
+};
+
+}
+
+#endif
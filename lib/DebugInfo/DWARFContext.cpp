@@ -7,12 +7,15 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "dwarf-context"
 #include "DWARFContext.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -20,6 +23,8 @@ using namespace llvm;
 using namespace dwarf;
 using namespace object;
 
+STATISTIC(PeakDIEMemoryUsage, "Peak bytes held by parsed DIEs while dumping");
+
 typedef DWARFDebugLine::LineTable DWARFLineTable;
 
 static void dumpPubSection(raw_ostream &OS, StringRef Name, StringRef Data,
@@ -53,6 +58,22 @@ static void dumpPubSection(raw_ostream &OS, StringRef Name, StringRef Data,
   }
 }
 
+/// Dump a unit, and clear its DIEs again if they were parsed just for that,
+/// so that dumping keeps a single unit in memory at a time.
+template <typename UnitType>
+static void dumpUnit(raw_ostream &OS, const DWARFContext &Ctx, UnitType *U) {
+  bool WasExtracted = U->hasExtractedDIEs();
+  U->dump(OS);
+  // Summing the usage of every unit is linear, so only do it when asked to.
+  if (AreStatisticsEnabled()) {
+    size_t Usage = Ctx.getDIEMemoryUsage();
+    if (Usage > PeakDIEMemoryUsage)
+      PeakDIEMemoryUsage = Usage;
+  }
+  if (!WasExtracted)
+    U->clearDIEs(true);
+}
+
 void DWARFContext::dump(raw_ostream &OS, DIDumpType DumpType) {
   if (DumpType == DIDT_All || DumpType == DIDT_Abbrev) {
     OS << ".debug_abbrev contents:\n";
@@ -68,27 +89,27 @@ void DWARFContext::dump(raw_ostream &OS, DIDumpType DumpType) {
   if (DumpType == DIDT_All || DumpType == DIDT_Info) {
     OS << "\n.debug_info contents:\n";
     for (const auto &CU : compile_units())
-      CU->dump(OS);
+      dumpUnit(OS, *this, CU.get());
   }
 
   if ((DumpType == DIDT_All || DumpType == DIDT_InfoDwo) &&
       getNumDWOCompileUnits()) {
     OS << "\n.debug_info.dwo contents:\n";
     for (const auto &DWOCU : dwo_compile_units())
-      DWOCU->dump(OS);
+      dumpUnit(OS, *this, DWOCU.get());
   }
 
   if ((DumpType == DIDT_All || DumpType == DIDT_Types) && getNumTypeUnits()) {
     OS << "\n.debug_types contents:\n";
     for (const auto &TU : type_units())
-      TU->dump(OS);
+      dumpUnit(OS, *this, TU.get());
   }
 
   if ((DumpType == DIDT_All || DumpType == DIDT_TypesDwo) &&
       getNumDWOTypeUnits()) {
     OS << "\n.debug_types.dwo contents:\n";
     for (const auto &DWOTU : dwo_type_units())
-      DWOTU->dump(OS);
+      dumpUnit(OS, *this, DWOTU.get());
   }
 
   if (DumpType == DIDT_All || DumpType == DIDT_Loc) {
@@ -261,6 +282,15 @@ const DWARFDebugAranges *DWARFContext::getDebugAranges() {
   return Aranges.get();
 }
 
+const DWARFAddressIndex *DWARFContext::getAddressIndex() {
+  if (AddressIndex)
+    return AddressIndex.get();
+
+  AddressIndex.reset(new DWARFAddressIndex());
+  AddressIndex->generate(this);
+  return AddressIndex.get();
+}
+
 const DWARFDebugFrame *DWARFContext::getDebugFrame() {
   if (DebugFrame)
     return DebugFrame.get();
@@ -283,8 +313,11 @@ const DWARFDebugFrame *DWARFContext::getDebugFrame() {
 
 const DWARFLineTable *
 DWARFContext::getLineTableForCompileUnit(DWARFCompileUnit *cu) {
-  if (!Line)
-    Line.reset(new DWARFDebugLine(&getLineSection().Relocs));
+  {
+    sys::ScopedLock Guard(LineLock);
+    if (!Line)
+      Line.reset(new DWARFDebugLine(&getLineSection().Relocs));
+  }
 
   unsigned stmtOffset =
       cu->getCompileUnitDIE()->getAttributeValueAsSectionOffset(
@@ -302,6 +335,56 @@ DWARFContext::getLineTableForCompileUnit(DWARFCompileUnit *cu) {
   return Line->getOrParseLineTable(lineData, stmtOffset);
 }
 
+void DWARFContext::clearDIEs() {
+  for (const auto &CU : CUs)
+    CU->clearDIEs(true);
+  for (const auto &TU : TUs)
+    TU->clearDIEs(true);
+  for (const auto &DWOCU : DWOCUs)
+    DWOCU->clearDIEs(true);
+  for (const auto &DWOTU : DWOTUs)
+    DWOTU->clearDIEs(true);
+}
+
+size_t DWARFContext::getDIEMemoryUsage() const {
+  size_t Size = 0;
+  for (const auto &CU : CUs)
+    Size += CU->getDIEMemoryUsage();
+  for (const auto &TU : TUs)
+    Size += TU->getDIEMemoryUsage();
+  for (const auto &DWOCU : DWOCUs)
+    Size += DWOCU->getDIEMemoryUsage();
+  for (const auto &DWOTU : DWOTUs)
+    Size += DWOTU->getDIEMemoryUsage();
+  return Size;
+}
+
+void DWARFContext::preload(unsigned ThreadCount) {
+  parseCompileUnits();
+  parseTypeUnits();
+
+  auto PreloadCU = [this](const std::unique_ptr<DWARFCompileUnit> &CU) {
+    CU->extractAllDIEs();
+    getLineTableForCompileUnit(CU.get());
+  };
+  auto PreloadTU = [](const std::unique_ptr<DWARFTypeUnit> &TU) {
+    TU->getCompileUnitDIE(false);
+  };
+  if (ThreadCount == 1) {
+    std::for_each(CUs.begin(), CUs.end(), PreloadCU);
+    std::for_each(TUs.begin(), TUs.end(), PreloadTU);
+  } else {
+    ThreadPool Pool(ThreadCount);
+    parallel_for_each(Pool, CUs.begin(), CUs.end(), PreloadCU);
+    parallel_for_each(Pool, TUs.begin(), TUs.end(), PreloadTU);
+  }
+
+  // With every DIE extracted, building the ranges keeps them all, and the
+  // row lookups go through the index from the start.
+  getDebugAranges();
+  getAddressIndex();
+}
+
 void DWARFContext::parseCompileUnits() {
   if (!CUs.empty())
     return;
@@ -440,17 +523,32 @@ static bool getFileNameForCompileUnit(DWARFCompileUnit *CU,
   return true;
 }
 
+/// The number of row lookups after which they go through the address index.
+/// Building the index parses every line table, which does not pay off for a
+/// handful of lookups.
+static const unsigned AddressIndexThreshold = 16;
+
+uint32_t DWARFContext::lookupRowForAddress(DWARFCompileUnit *CU,
+                                           const DWARFLineTable *LineTable,
+                                           uint64_t Address) {
+  if (AddressIndex || ++NumRowLookups >= AddressIndexThreshold) {
+    // The index covers all compile units, so check that it agrees with the
+    // compile unit found through the address ranges.
+    uint32_t CUIndex, RowIndex;
+    if (getAddressIndex()->findAddress(Address, CUIndex, RowIndex) &&
+        getCompileUnitAtIndex(CUIndex) == CU)
+      return RowIndex;
+  }
+  return LineTable->lookupAddress(Address);
+}
+
 static bool getFileLineInfoForCompileUnit(DWARFCompileUnit *CU,
                                           const DWARFLineTable *LineTable,
-                                          uint64_t Address,
+                                          uint32_t RowIndex,
                                           bool NeedsAbsoluteFilePath,
                                           std::string &FileName,
                                           uint32_t &Line, uint32_t &Column) {
-  if (CU == 0 || LineTable == 0)
-    return false;
-  // Get the index of row we're looking for in the line table.
-  uint32_t RowIndex = LineTable->lookupAddress(Address);
-  if (RowIndex == -1U)
+  if (CU == 0 || LineTable == 0 || RowIndex == -1U)
     return false;
   // Take file number and line/column from the row.
   const DWARFDebugLine::Row &Row = LineTable->Rows[RowIndex];
@@ -487,7 +585,9 @@ DILineInfo DWARFContext::getLineInfoForAddress(uint64_t Address,
     const DWARFLineTable *LineTable = getLineTableForCompileUnit(CU);
     const bool NeedsAbsoluteFilePath =
         Specifier.needs(DILineInfoSpecifier::AbsoluteFilePath);
-    getFileLineInfoForCompileUnit(CU, LineTable, Address,
+    uint32_t RowIndex =
+        LineTable ? lookupRowForAddress(CU, LineTable, Address) : -1U;
+    getFileLineInfoForCompileUnit(CU, LineTable, RowIndex,
                                   NeedsAbsoluteFilePath,
                                   FileName, Line, Column);
   }
@@ -580,7 +680,9 @@ DIInliningInfo DWARFContext::getInliningInfoForAddress(uint64_t Address,
         // compile unit and fetch file/line info from it.
         LineTable = getLineTableForCompileUnit(CU);
         // For the topmost routine, get file/line info from line table.
-        getFileLineInfoForCompileUnit(CU, LineTable, Address,
+        uint32_t RowIndex =
+            LineTable ? lookupRowForAddress(CU, LineTable, Address) : -1U;
+        getFileLineInfoForCompileUnit(CU, LineTable, RowIndex,
                                       NeedsAbsoluteFilePath,
                                       FileName, Line, Column);
       } else {
@@ -10,6 +10,7 @@
 #ifndef LLVM_DEBUGINFO_DWARFCONTEXT_H
 #define LLVM_DEBUGINFO_DWARFCONTEXT_H
 
+#include "DWARFAddressIndex.h"
 #include "DWARFCompileUnit.h"
 #include "DWARFDebugAranges.h"
 #include "DWARFDebugFrame.h"
@@ -20,6 +21,7 @@
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/DebugInfo/DIContext.h"
+#include "llvm/Support/Mutex.h"
 
 namespace llvm {
 
@@ -38,6 +40,10 @@ class DWARFContext : public DIContext {
   std::unique_ptr<DWARFDebugAranges> Aranges;
   std::unique_ptr<DWARFDebugLine> Line;
   std::unique_ptr<DWARFDebugFrame> DebugFrame;
+  std::unique_ptr<DWARFAddressIndex> AddressIndex;
+  unsigned NumRowLookups;
+  // Guards the creation of Line, which preload does on several threads.
+  sys::Mutex LineLock;
 
   CUVector DWOCUs;
   TUVector DWOTUs;
@@ -69,7 +75,7 @@ public:
     RelocAddrMap Relocs;
   };
 
-  DWARFContext() : DIContext(CK_DWARF) {}
+  DWARFContext() : DIContext(CK_DWARF), NumRowLookups(0) {}
 
   static bool classof(const DIContext *DICtx) {
     return DICtx->getKind() == CK_DWARF;
@@ -162,6 +168,17 @@ public:
   const DWARFDebugLine::LineTable *
   getLineTableForCompileUnit(DWARFCompileUnit *cu);
 
+  /// Get a pointer to the index of line table rows by address, building it
+  /// if necessary. This parses the line tables of all the compile units.
+  const DWARFAddressIndex *getAddressIndex();
+
+  /// Clear the parsed DIEs of all the units but the unit DIEs, which are
+  /// parsed again when needed. This invalidates pointers to the cleared DIEs.
+  void clearDIEs();
+
+  /// Get the number of bytes allocated for the parsed DIEs of all the units.
+  size_t getDIEMemoryUsage() const;
+
   DILineInfo getLineInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) override;
   DILineInfoTable getLineInfoForAddressRange(uint64_t Address, uint64_t Size,
@@ -169,6 +186,15 @@ public:
   DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) override;
 
+  /// Extract the DIEs and line tables of all compile units, with those of
+  /// their .dwo units, and the DIEs of all type units, in parallel. The unit
+  /// headers and abbreviations are read first, as they have to be read in
+  /// order. Each unit is then extracted by a single task, so only the line
+  /// table cache is shared between threads. The address ranges and the
+  /// address index are built last, so that the address lookups made
+  /// afterwards only read the context.
+  void preload(unsigned ThreadCount) override;
+
   virtual bool isLittleEndian() const = 0;
   virtual uint8_t getAddressSize() const = 0;
   virtual const Section &getInfoSection() = 0;
@@ -208,6 +234,12 @@ private:
   /// Return the compile unit which contains instruction with provided
   /// address.
   DWARFCompileUnit *getCompileUnitForAddress(uint64_t Address);
+
+  /// Return the index of the row of \p LineTable, the line table of \p CU,
+  /// with file/line info for \p Address, or -1U if there is no such row.
+  uint32_t lookupRowForAddress(DWARFCompileUnit *CU,
+                               const DWARFDebugLine::LineTable *LineTable,
+                               uint64_t Address);
 };
 
 /// DWARFContextInMemory is the simplest possible implementation of a
@@ -24,21 +24,22 @@ class DWARFFormValue;
 struct DWARFDebugInfoEntryInlinedChain;
 
 /// DWARFDebugInfoEntryMinimal - A DIE with only the minimum required data.
+///
+/// Units hold one of these per DIE, so it is kept to 16 bytes on 64-bit
+/// hosts: the abbreviation declaration is shared with the abbreviation set of
+/// the unit, and the parent of a DIE is found with DWARFUnit::getParent,
+/// which keeps a 32-bit index per DIE instead of padding every entry.
 class DWARFDebugInfoEntryMinimal {
   /// Offset within the .debug_info of the start of this entry.
   uint32_t Offset;
 
-  /// How many to subtract from "this" to get the parent.
-  /// If zero this die has no parent.
-  uint32_t ParentIdx;
-
   /// How many to add to "this" to get the sibling.
   uint32_t SiblingIdx;
 
   const DWARFAbbreviationDeclaration *AbbrevDecl;
 public:
   DWARFDebugInfoEntryMinimal()
-    : Offset(0), ParentIdx(0), SiblingIdx(0), AbbrevDecl(0) {}
+    : Offset(0), SiblingIdx(0), AbbrevDecl(0) {}
 
   void dump(raw_ostream &OS, const DWARFUnit *u, unsigned recurseDepth,
             unsigned indent = 0) const;
@@ -62,14 +63,6 @@ public:
   uint32_t getOffset() const { return Offset; }
   bool hasChildren() const { return !isNULL() && AbbrevDecl->hasChildren(); }
 
-  // We know we are kept in a vector of contiguous entries, so we know
-  // our parent will be some index behind "this".
-  DWARFDebugInfoEntryMinimal *getParent() {
-    return ParentIdx > 0 ? this - ParentIdx : 0;
-  }
-  const DWARFDebugInfoEntryMinimal *getParent() const {
-    return ParentIdx > 0 ? this - ParentIdx : 0;
-  }
   // We know we are kept in a vector of contiguous entries, so we know
   // our sibling will be some index after "this".
   DWARFDebugInfoEntryMinimal *getSibling() {
@@ -88,20 +81,11 @@ public:
     return hasChildren() ? this + 1 : 0;
   }
 
-  void setParent(DWARFDebugInfoEntryMinimal *parent) {
-    if (parent) {
-      // We know we are kept in a vector of contiguous entries, so we know
-      // our parent will be some index behind "this".
-      ParentIdx = this - parent;
-    } else
-      ParentIdx = 0;
-  }
   void setSibling(DWARFDebugInfoEntryMinimal *sibling) {
     if (sibling) {
       // We know we are kept in a vector of contiguous entries, so we know
       // our sibling will be some index after "this".
       SiblingIdx = sibling - this;
-      sibling->setParent(getParent());
     } else
       SiblingIdx = 0;
   }
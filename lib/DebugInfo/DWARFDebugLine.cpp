@@ -144,6 +144,7 @@ void DWARFDebugLine::DumpingState::finalize() {
 
 const DWARFDebugLine::LineTable *
 DWARFDebugLine::getLineTable(uint32_t offset) const {
+  sys::ScopedLock Guard(LineTableMapLock);
   LineTableConstIter pos = LineTableMap.find(offset);
   if (pos != LineTableMap.end())
     return &pos->second;
@@ -153,12 +154,21 @@ DWARFDebugLine::getLineTable(uint32_t offset) const {
 const DWARFDebugLine::LineTable *
 DWARFDebugLine::getOrParseLineTable(DataExtractor debug_line_data,
                                     uint32_t offset) {
+  if (const LineTable *lt = getLineTable(offset))
+    return lt;
+
+  // Parse the line table at this offset without holding the lock, so that
+  // different tables can be parsed concurrently, then cache it. If another
+  // thread got there first, its table is kept.
+  State state;
+  uint32_t parse_offset = offset;
+  bool parsed =
+      parseStatementTable(debug_line_data, RelocMap, &parse_offset, state);
+  sys::ScopedLock Guard(LineTableMapLock);
   std::pair<LineTableIter, bool> pos =
     LineTableMap.insert(LineTableMapTy::value_type(offset, LineTable()));
   if (pos.second) {
-    // Parse and cache the line table for at this offset.
-    State state;
-    if (!parseStatementTable(debug_line_data, RelocMap, &offset, state))
+    if (!parsed)
       return 0;
     pos.first->second = state;
   }
@@ -12,6 +12,7 @@
 
 #include "DWARFRelocMap.h"
 #include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/Mutex.h"
 #include <map>
 #include <string>
 #include <vector>
@@ -243,6 +244,9 @@ public:
                                   const RelocAddrMap *RMap,
                                   uint32_t *offset_ptr, State &state);
 
+  // The line table cache may be filled from several threads at once by
+  // DWARFContext::preload. Tables are never removed, so the returned pointers
+  // stay valid.
   const LineTable *getLineTable(uint32_t offset) const;
   const LineTable *getOrParseLineTable(DataExtractor debug_line_data,
                                        uint32_t offset);
@@ -254,6 +258,7 @@ private:
 
   const RelocAddrMap *RelocMap;
   LineTableMapTy LineTableMap;
+  mutable sys::Mutex LineTableMapLock;
 };
 
 }
@@ -7,8 +7,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "dwarf-unit"
 #include "DWARFUnit.h"
 #include "DWARFContext.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/DebugInfo/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
@@ -17,6 +20,9 @@
 using namespace llvm;
 using namespace dwarf;
 
+STATISTIC(NumDIEsExtracted, "Number of DIEs extracted");
+STATISTIC(NumDIEsCleared, "Number of extracted DIEs cleared");
+
 DWARFUnit::DWARFUnit(const DWARFDebugAbbrev *DA, StringRef IS, StringRef AS,
                      StringRef RS, StringRef SS, StringRef SOS, StringRef AOS,
                      const RelocAddrMap *M, bool LE)
@@ -129,12 +135,17 @@ void DWARFUnit::setDIERelations() {
   DWARFDebugInfoEntryMinimal *die_array_begin = &DieArray.front();
   DWARFDebugInfoEntryMinimal *die_array_end = &DieArray.back();
   DWARFDebugInfoEntryMinimal *curr_die;
+  // The DIEs whose children are being walked, innermost last.
+  SmallVector<DWARFDebugInfoEntryMinimal *, 16> parents;
+  DieParents.clear();
+  DieParents.reserve(DieArray.size());
   // We purposely are skipping the last element in the array in the loop below
   // so that we can always have a valid next item
   for (curr_die = die_array_begin; curr_die < die_array_end; ++curr_die) {
     // Since our loop doesn't include the last element, we can always
     // safely access the next die in the array.
     DWARFDebugInfoEntryMinimal *next_die = curr_die + 1;
+    DieParents.push_back(parents.empty() ? 0 : curr_die - parents.back());
 
     const DWARFAbbreviationDeclaration *curr_die_abbrev =
       curr_die->getAbbreviationDeclarationPtr();
@@ -142,20 +153,16 @@ void DWARFUnit::setDIERelations() {
     if (curr_die_abbrev) {
       // Normal DIE
       if (curr_die_abbrev->hasChildren())
-        next_die->setParent(curr_die);
+        parents.push_back(curr_die);
       else
         curr_die->setSibling(next_die);
-    } else {
+    } else if (!parents.empty()) {
       // NULL DIE that terminates a sibling chain
-      DWARFDebugInfoEntryMinimal *parent = curr_die->getParent();
-      if (parent)
-        parent->setSibling(next_die);
+      parents.back()->setSibling(next_die);
+      parents.pop_back();
     }
   }
-
-  // Since we skipped the last element, we need to fix it up!
-  if (die_array_begin < die_array_end)
-    curr_die->setParent(die_array_begin);
+  DieParents.push_back(parents.empty() ? 0 : die_array_end - parents.back());
 }
 
 void DWARFUnit::extractDIEsToVector(
@@ -235,9 +242,27 @@ size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
   }
 
   setDIERelations();
+
+  NumDIEsExtracted += DieArray.size() - HasCUDie;
   return DieArray.size();
 }
 
+const DWARFDebugInfoEntryMinimal *
+DWARFUnit::getParent(const DWARFDebugInfoEntryMinimal *Die) const {
+  assert(!DieArray.empty() && Die >= &DieArray.front() &&
+         Die <= &DieArray.back() && "DIE is not in this unit");
+  uint32_t ParentIdx = DieParents[Die - &DieArray.front()];
+  return ParentIdx > 0 ? Die - ParentIdx : 0;
+}
+
+size_t DWARFUnit::getDIEMemoryUsage() const {
+  size_t Size = DieArray.capacity() * sizeof(DWARFDebugInfoEntryMinimal) +
+                DieParents.capacity() * sizeof(uint32_t);
+  if (DWO.get() && DWO->getUnit())
+    Size += DWO->getUnit()->getDIEMemoryUsage();
+  return Size;
+}
+
 DWARFUnit::DWOHolder::DWOHolder(object::ObjectFile *DWOFile)
     : DWOFile(DWOFile),
       DWOContext(cast<DWARFContext>(DIContext::getDWARFContext(DWOFile))),
@@ -281,8 +306,16 @@ bool DWARFUnit::parseDWO() {
   return true;
 }
 
+void DWARFUnit::extractAllDIEs() {
+  extractDIEsIfNeeded(false);
+  parseDWO();
+  if (DWO.get())
+    DWO->getUnit()->extractDIEsIfNeeded(false);
+}
+
 void DWARFUnit::clearDIEs(bool KeepCUDie) {
   if (DieArray.size() > (unsigned)KeepCUDie) {
+    NumDIEsCleared += DieArray.size() - KeepCUDie;
     // std::vectors never get any smaller when resized to a smaller size,
     // or when clear() or erase() are called, the size will report that it
     // is smaller, but the memory allocated remains intact (call capacity()
@@ -292,9 +325,12 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
     // contents.
     std::vector<DWARFDebugInfoEntryMinimal> TmpArray;
     DieArray.swap(TmpArray);
+    std::vector<uint32_t>().swap(DieParents);
     // Save at least the compile unit DIE
-    if (KeepCUDie)
+    if (KeepCUDie) {
       DieArray.push_back(TmpArray.front());
+      DieParents.push_back(0);
+    }
   }
 }
 
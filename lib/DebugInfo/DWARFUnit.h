@@ -47,6 +47,10 @@ class DWARFUnit {
   uint64_t BaseAddr;
   // The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntryMinimal> DieArray;
+  // How many to subtract from the index of a DIE to get its parent, or zero
+  // for the unit DIE. Kept apart from DieArray, which it is parallel to, so
+  // that DIEs stay small for users that never look at parents.
+  std::vector<uint32_t> DieParents;
 
   class DWOHolder {
     std::unique_ptr<object::ObjectFile> DWOFile;
@@ -120,6 +124,9 @@ public:
     BaseAddr = base_addr;
   }
 
+  /// getCompileUnitDIE - Returns the unit DIE, extracting it, or all the DIEs
+  /// if \p extract_cu_die_only is false, if needed. The pointer is invalidated
+  /// when the other DIEs are extracted after the unit DIE alone, or cleared.
   const DWARFDebugInfoEntryMinimal *
   getCompileUnitDIE(bool extract_cu_die_only = true) {
     extractDIEsIfNeeded(extract_cu_die_only);
@@ -133,6 +140,28 @@ public:
                               bool clear_dies_if_already_not_parsed,
                               uint32_t CUOffsetInAranges);
 
+  /// extractAllDIEs - Extract all the DIEs of this unit, and of its .dwo unit
+  /// if it has one, so that looking up addresses in the unit afterwards does
+  /// not change it.
+  void extractAllDIEs();
+
+  /// hasExtractedDIEs - Returns true if the DIEs below the unit DIE have been
+  /// extracted.
+  bool hasExtractedDIEs() const { return DieArray.size() > 1; }
+
+  /// clearDIEs - Clear parsed DIEs to keep memory usage low. They are parsed
+  /// again when needed, and pointers to the cleared DIEs become dangling.
+  void clearDIEs(bool KeepCUDie);
+
+  /// getParent - Returns the parent of \p Die, which must be one of the DIEs
+  /// of this unit, or null for the unit DIE.
+  const DWARFDebugInfoEntryMinimal *
+  getParent(const DWARFDebugInfoEntryMinimal *Die) const;
+
+  /// getDIEMemoryUsage - Returns the number of bytes allocated for the parsed
+  /// DIEs of this unit and of its .dwo unit, if any.
+  size_t getDIEMemoryUsage() const;
+
   /// getInlinedChainForAddress - fetches inlined chain for a given address.
   /// Returns empty chain if there is no subprogram containing address. The
   /// chain is valid as long as parsed compile unit DIEs are not cleared.
@@ -141,16 +170,17 @@ public:
 private:
   /// extractDIEsIfNeeded - Parses a compile unit and indexes its DIEs if it
   /// hasn't already been done. Returns the number of DIEs parsed at this call.
+  /// Extending an array that only holds the compile unit DIE moves it, so
+  /// pointers to DIEs are only stable once all of them have been extracted.
   size_t extractDIEsIfNeeded(bool CUDieOnly);
   /// extractDIEsToVector - Appends all parsed DIEs to a vector.
   void extractDIEsToVector(bool AppendCUDie, bool AppendNonCUDIEs,
                            std::vector<DWARFDebugInfoEntryMinimal> &DIEs) const;
   /// setDIERelations - We read in all of the DIE entries into our flat list
   /// of DIE entries and now we need to go back through all of them and set the
-  /// parent, sibling and child pointers for quick DIE navigation.
+  /// sibling and child pointers, and the parent index, for quick DIE
+  /// navigation.
   void setDIERelations();
-  /// clearDIEs - Clear parsed DIEs to keep memory usage low.
-  void clearDIEs(bool KeepCUDie);
 
   /// parseDWO - Parses .dwo file for current compile unit. Returns true if
   /// it was actually constructed.
@@ -19,6 +19,7 @@
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/TierListener.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -44,6 +45,7 @@ STATISTIC(NumGlobals  , "Number of global vars initialized");
 void ObjectCache::anchor() {}
 void ObjectBuffer::anchor() {}
 void ObjectBufferStream::anchor() {}
+void TierListener::anchor() {}
 
 ExecutionEngine *(*ExecutionEngine::JITCtor)(
   Module *M,
@@ -59,6 +61,10 @@ ExecutionEngine *(*ExecutionEngine::MCJITCtor)(
   TargetMachine *TM) = 0;
 ExecutionEngine *(*ExecutionEngine::InterpCtor)(Module *M,
                                                 std::string *ErrorStr) = 0;
+ExecutionEngine *(*ExecutionEngine::TieredCtor)(Module *M,
+                                                std::string *ErrorStr,
+                                                ExecutionEngine *JIT,
+                                                unsigned Threshold) = 0;
 
 ExecutionEngine::ExecutionEngine(Module *M)
   : EEState(*this),
@@ -473,6 +479,27 @@ ExecutionEngine *EngineBuilder::create(TargetMachine *TM) {
     return 0;
   }
 
+  // A tiered engine interprets the module and compiles its hot functions with
+  // an MCJIT of its own, created over an empty module.
+  if (TierUpThreshold && UseMCJIT && !MCJMM && !JMM && TheTM &&
+      (WhichEngine & EngineKind::JIT) &&
+      (WhichEngine & EngineKind::Interpreter) &&
+      ExecutionEngine::MCJITCtor && ExecutionEngine::TieredCtor) {
+    Module *JITModule = new Module(M->getModuleIdentifier() + ".tier-up",
+                                   M->getContext());
+    JITModule->setTargetTriple(M->getTargetTriple());
+    ExecutionEngine *JIT =
+      ExecutionEngine::MCJITCtor(JITModule, ErrorStr, 0, AllocateGVsWithCode,
+                                 TheTM.release());
+    if (!JIT)
+      return 0;
+    ExecutionEngine *EE =
+      ExecutionEngine::TieredCtor(M, ErrorStr, JIT, TierUpThreshold);
+    if (!EE)
+      delete JIT;
+    return EE;
+  }
+
   // Unless the interpreter was explicitly selected or the JIT is not linked,
   // try making a JIT.
   if ((WhichEngine & EngineKind::JIT) && TheTM) {
@@ -38,7 +38,7 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //===----------------------------------------------------------------------===//
 
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  SF.Values[SF.Code->getSlot(V)] = Val;
 }
 
 //===----------------------------------------------------------------------===//
@@ -916,41 +916,40 @@ void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
 
 
 // SwitchToNewBasicBlock - This method is used to jump to a new basic block.
-// This function handles the actual updating of block and instruction iterators
+// This function handles the actual updating of block and instruction pointers
 // as well as execution of all of the PHI nodes in the destination block.
 //
-// This method does this because all of the PHI nodes must be executed
-// atomically, reading their inputs before any of the results are updated.  Not
-// doing this can cause problems if the PHI nodes depend on other PHI nodes for
-// their inputs.  If the input PHI node is updated before it is read, incorrect
-// results can happen.  Thus we use a two phase approach.
-//
 void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
-  BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
-  SF.CurBB   = Dest;                  // Update CurBB to branch destination
-  SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
-
-  if (!isa<PHINode>(SF.CurInst)) return;  // Nothing fancy to do
-
-  // Loop over all of the PHI nodes in the current block, reading their inputs.
-  std::vector<GenericValue> ResultValues;
-
-  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst); ++SF.CurInst) {
-    // Search for the value corresponding to this previous bb...
-    int i = PN->getBasicBlockIndex(PrevBB);
-    assert(i != -1 && "PHINode doesn't contain entry for predecessor??");
-    Value *IncomingValue = PN->getIncomingValue(i);
+  takeEdge(SF.Code->getEdge(SF.CurBB, Dest), SF);
+}
 
-    // Save the incoming value for this PHI node...
-    ResultValues.push_back(getOperandValue(IncomingValue, SF));
-  }
+// takeEdge - Move SF along E, the decoded edge from its current block.
+//
+// All of the PHI nodes must be executed atomically, reading their inputs
+// before any of the results are updated.  Not doing this can cause problems if
+// the PHI nodes depend on other PHI nodes for their inputs.  If the input PHI
+// node is updated before it is read, incorrect results can happen.  Thus we use
+// a two phase approach.
+//
+void Interpreter::takeEdge(const DecodedEdge &E, ExecutionContext &SF) {
+  if (E.IsBackEdge)
+    onBackEdge(SF);
+  const FunctionCode &Code = *SF.Code;
+  SF.CurBB = E.Dest;
+  SF.CurInst = &Code.Insts[E.Target];
+  if (E.NumMoves == 0)
+    return;
 
-  // Now loop over all of the PHI nodes setting their values...
-  SF.CurInst = SF.CurBB->begin();
-  for (unsigned i = 0; isa<PHINode>(SF.CurInst); ++SF.CurInst, ++i) {
-    PHINode *PN = cast<PHINode>(SF.CurInst);
-    SetValue(PN, ResultValues[i], SF);
+  const std::pair<unsigned, unsigned> *Moves = &Code.Moves[E.FirstMove];
+  if (E.NumMoves == 1) {
+    SF.Values[Moves[0].first] = SF.Values[Moves[0].second];
+    return;
   }
+  SmallVector<GenericValue, 4> ResultValues;
+  for (unsigned i = 0; i != E.NumMoves; ++i)
+    ResultValues.push_back(SF.Values[Moves[i].second]);
+  for (unsigned i = 0; i != E.NumMoves; ++i)
+    SF.Values[Moves[i].first] = ResultValues[i];
 }
 
 //===----------------------------------------------------------------------===//
@@ -1084,21 +1083,7 @@ void Interpreter::visitCallSite(CallSite CS) {
       // If it is an unknown intrinsic function, use the intrinsic lowering
       // class to transform it into hopefully tasty LLVM code.
       //
-      BasicBlock::iterator me(CS.getInstruction());
-      BasicBlock *Parent = CS.getInstruction()->getParent();
-      bool atBegin(Parent->begin() == me);
-      if (!atBegin)
-        --me;
-      IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
-
-      // Restore the CurInst pointer to the first instruction newly inserted, if
-      // any.
-      if (atBegin) {
-        SF.CurInst = Parent->begin();
-      } else {
-        SF.CurInst = me;
-        ++SF.CurInst;
-      }
+      lowerIntrinsicCall(cast<CallInst>(CS.getInstruction()), SF);
       return;
     }
 
@@ -2060,7 +2045,7 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
   } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
     return PTOGV(getPointerToGlobal(GV));
   } else {
-    return SF.Values[V];
+    return SF.Values[SF.Code->getSlot(V)];
   }
 }
 
@@ -2090,8 +2075,11 @@ void Interpreter::callFunction(Function *F,
   }
 
   // Get pointers to first LLVM BB & Instruction in function.
+  const FunctionCode *Code = getCode(F);
+  StackFrame.Code      = Code;
   StackFrame.CurBB     = F->begin();
-  StackFrame.CurInst   = StackFrame.CurBB->begin();
+  StackFrame.CurInst   = &Code->Insts[0];
+  StackFrame.Values    = Code->InitialValues;
 
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
@@ -2109,38 +2097,127 @@ void Interpreter::callFunction(Function *F,
 }
 
 
+// Under GCC and Clang, the instructions are dispatched with computed gotos,
+// each instruction jumping straight to the code of the next one.  Other
+// compilers loop over a switch.  The extension would make -pedantic warn
+// about every label and jump.
+#if defined(__GNUC__)
+#define INTERPRETER_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
 void Interpreter::run() {
-  while (!ECStack.empty()) {
+  ExecutionContext *SF;
+  const DecodedInst *I;
+  if (ECStack.empty())
+    return;
+  SF = &ECStack.back();
+
+#ifdef INTERPRETER_THREADED_DISPATCH
+  // In the order of DecodedInst::KindTy.
+  static void *const Targets[DecodedInst::NumKinds] = {
+    &&Generic, &&LowerIntrinsic,
+    &&Br, &&CondBr,
+    &&Add, &&Sub, &&Mul, &&And, &&Or, &&Xor, &&Shl, &&LShr, &&AShr,
+    &&ICmpEQ, &&ICmpNE, &&ICmpUGT, &&ICmpUGE, &&ICmpULT, &&ICmpULE,
+    &&ICmpSGT, &&ICmpSGE, &&ICmpSLT, &&ICmpSLE,
+    &&Load, &&Store
+  };
+#define CASE(KIND) case DecodedInst::KIND: KIND:
+#define NEXT()                                                          \
+  do {                                                                  \
+    I = SF->CurInst++;                                                  \
+    ++NumDynamicInsts;                                                  \
+    DEBUG(dbgs() << "About to interpret: " << *I->Inst);                \
+    goto *Targets[I->Kind];                                             \
+  } while (0)
+#else
+#define CASE(KIND) case DecodedInst::KIND:
+#define NEXT() goto Dispatch
+#endif
+
+#define VAL(N) SF->Values[I->Src[N]]
+#define BINARY(KIND, EXPR)                                              \
+  CASE(KIND)                                                            \
+    SF->Values[I->Dest].IntVal = EXPR;                                  \
+    NEXT();
+
+  for (;;) {
+#ifndef INTERPRETER_THREADED_DISPATCH
+  Dispatch:
+#endif
     // Interpret a single instruction & increment the "PC".
-    ExecutionContext &SF = ECStack.back();  // Current stack frame
-    Instruction &I = *SF.CurInst++;         // Increment before execute
+    I = SF->CurInst++;
 
     // Track the number of dynamic instructions executed.
     ++NumDynamicInsts;
 
-    DEBUG(dbgs() << "About to interpret: " << I);
-    visit(I);   // Dispatch to one of the visit* methods...
-#if 0
-    // This is not safe, as visiting the instruction could lower it and free I.
-DEBUG(
-    if (!isa<CallInst>(I) && !isa<InvokeInst>(I) && 
-        I.getType() != Type::VoidTy) {
-      dbgs() << "  --> ";
-      const GenericValue &Val = SF.Values[&I];
-      switch (I.getType()->getTypeID()) {
-      default: llvm_unreachable("Invalid GenericValue Type");
-      case Type::VoidTyID:    dbgs() << "void"; break;
-      case Type::FloatTyID:   dbgs() << "float " << Val.FloatVal; break;
-      case Type::DoubleTyID:  dbgs() << "double " << Val.DoubleVal; break;
-      case Type::PointerTyID: dbgs() << "void* " << intptr_t(Val.PointerVal);
-        break;
-      case Type::IntegerTyID: 
-        dbgs() << "i" << Val.IntVal.getBitWidth() << " "
-               << Val.IntVal.toStringUnsigned(10)
-               << " (0x" << Val.IntVal.toStringUnsigned(16) << ")\n";
-        break;
-      }
-    });
+    DEBUG(dbgs() << "About to interpret: " << *I->Inst);
+#ifdef INTERPRETER_THREADED_DISPATCH
+    goto *Targets[I->Kind];
 #endif
+    switch (I->Kind) {
+    CASE(Generic)
+      visit(*I->Inst);   // Dispatch to one of the visit* methods...
+      // Which may have pushed or popped frames.
+      if (ECStack.empty())
+        return;
+      SF = &ECStack.back();
+      NEXT();
+    CASE(LowerIntrinsic)
+      lowerIntrinsicCall(cast<CallInst>(I->Inst), *SF);
+      NEXT();
+    CASE(Br)
+      takeEdge(SF->Code->Edges[I->Succ[0]], *SF);
+      NEXT();
+    CASE(CondBr)
+      takeEdge(SF->Code->Edges[I->Succ[VAL(0).IntVal == 0]], *SF);
+      NEXT();
+    BINARY(Add, VAL(0).IntVal + VAL(1).IntVal)
+    BINARY(Sub, VAL(0).IntVal - VAL(1).IntVal)
+    BINARY(Mul, VAL(0).IntVal * VAL(1).IntVal)
+    BINARY(And, VAL(0).IntVal & VAL(1).IntVal)
+    BINARY(Or, VAL(0).IntVal | VAL(1).IntVal)
+    BINARY(Xor, VAL(0).IntVal ^ VAL(1).IntVal)
+    BINARY(Shl, VAL(0).IntVal.shl(getShiftAmount(VAL(1).IntVal.getZExtValue(),
+                                                 VAL(0).IntVal)))
+    BINARY(LShr, VAL(0).IntVal.lshr(getShiftAmount(VAL(1).IntVal.getZExtValue(),
+                                                   VAL(0).IntVal)))
+    BINARY(AShr, VAL(0).IntVal.ashr(getShiftAmount(VAL(1).IntVal.getZExtValue(),
+                                                   VAL(0).IntVal)))
+    BINARY(ICmpEQ, APInt(1, VAL(0).IntVal.eq(VAL(1).IntVal)))
+    BINARY(ICmpNE, APInt(1, VAL(0).IntVal.ne(VAL(1).IntVal)))
+    BINARY(ICmpUGT, APInt(1, VAL(0).IntVal.ugt(VAL(1).IntVal)))
+    BINARY(ICmpUGE, APInt(1, VAL(0).IntVal.uge(VAL(1).IntVal)))
+    BINARY(ICmpULT, APInt(1, VAL(0).IntVal.ult(VAL(1).IntVal)))
+    BINARY(ICmpULE, APInt(1, VAL(0).IntVal.ule(VAL(1).IntVal)))
+    BINARY(ICmpSGT, APInt(1, VAL(0).IntVal.sgt(VAL(1).IntVal)))
+    BINARY(ICmpSGE, APInt(1, VAL(0).IntVal.sge(VAL(1).IntVal)))
+    BINARY(ICmpSLT, APInt(1, VAL(0).IntVal.slt(VAL(1).IntVal)))
+    BINARY(ICmpSLE, APInt(1, VAL(0).IntVal.sle(VAL(1).IntVal)))
+    CASE(Load) {
+      GenericValue Result;
+      LoadValueFromMemory(Result, (GenericValue *)GVTOP(VAL(0)),
+                          I->Inst->getType());
+      SF->Values[I->Dest] = Result;
+      NEXT();
+    }
+    CASE(Store)
+      StoreValueToMemory(VAL(0), (GenericValue *)GVTOP(VAL(1)),
+                         I->Inst->getOperand(0)->getType());
+      NEXT();
+    default:
+      llvm_unreachable("Unknown decoded instruction kind!");
+    }
   }
+
+#undef BINARY
+#undef VAL
+#undef NEXT
+#undef CASE
 }
+
+#ifdef INTERPRETER_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
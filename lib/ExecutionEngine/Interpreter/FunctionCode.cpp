@@ -0,0 +1,286 @@
+//===-- FunctionCode.cpp - Decode functions for the interpreter -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file decodes the functions the interpreter runs into a flat array of
+//  instructions whose operands are slot numbers, with the PHI nodes resolved
+//  into copies along the control flow edges.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "interpreter"
+#include "Interpreter.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/CFG.h"
+#include "llvm/CodeGen/IntrinsicLowering.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include <algorithm>
+#include <iterator>
+using namespace llvm;
+
+STATISTIC(NumDecodedFunctions, "Number of functions decoded");
+
+static cl::opt<bool> FastPaths("interpreter-fast-paths", cl::Hidden,
+          cl::init(true),
+          cl::desc("Run branches, integer arithmetic, loads and stores without "
+                   "the instruction visitor"));
+
+/// addSlot - Return the slot of V in Code, numbering it if it has none.
+static unsigned addSlot(FunctionCode &Code, const Value *V) {
+  std::pair<DenseMap<const Value *, unsigned>::iterator, bool> R =
+    Code.Slots.insert(std::make_pair(V, unsigned(Code.InitialValues.size())));
+  if (R.second)
+    Code.InitialValues.push_back(GenericValue());
+  return R.first->second;
+}
+
+/// getEdgeNumber - Return the number of the edge From -> To in Code.
+static unsigned getEdgeNumber(const FunctionCode &Code, const BasicBlock *From,
+                              const BasicBlock *To) {
+  return &Code.getEdge(From, To) - &Code.Edges[0];
+}
+
+/// getKind - Return how the interpreter runs I.
+static unsigned getKind(const Instruction &I) {
+  if (const CallInst *CI = dyn_cast<CallInst>(&I))
+    if (const Function *F = CI->getCalledFunction())
+      if (F->isDeclaration())
+        switch (F->getIntrinsicID()) {
+        case Intrinsic::not_intrinsic:
+        case Intrinsic::vastart:
+        case Intrinsic::vaend:
+        case Intrinsic::vacopy:
+          break;
+        default:
+          return DecodedInst::LowerIntrinsic;
+        }
+
+  if (!FastPaths)
+    return DecodedInst::Generic;
+
+  switch (I.getOpcode()) {
+  case Instruction::Br:
+    return cast<BranchInst>(I).isConditional() ? DecodedInst::CondBr
+                                               : DecodedInst::Br;
+  case Instruction::Add:
+  case Instruction::Sub:
+  case Instruction::Mul:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+    if (!I.getType()->isIntegerTy())
+      break;
+    switch (I.getOpcode()) {
+    default: llvm_unreachable("Not a decoded binary operator!");
+    case Instruction::Add:  return DecodedInst::Add;
+    case Instruction::Sub:  return DecodedInst::Sub;
+    case Instruction::Mul:  return DecodedInst::Mul;
+    case Instruction::And:  return DecodedInst::And;
+    case Instruction::Or:   return DecodedInst::Or;
+    case Instruction::Xor:  return DecodedInst::Xor;
+    case Instruction::Shl:  return DecodedInst::Shl;
+    case Instruction::LShr: return DecodedInst::LShr;
+    case Instruction::AShr: return DecodedInst::AShr;
+    }
+  case Instruction::ICmp:
+    if (!I.getOperand(0)->getType()->isIntegerTy())
+      break;
+    return DecodedInst::ICmpEQ + cast<ICmpInst>(I).getPredicate() -
+           CmpInst::FIRST_ICMP_PREDICATE;
+  case Instruction::Load:
+    if (cast<LoadInst>(I).isVolatile())
+      break;
+    return DecodedInst::Load;
+  case Instruction::Store:
+    if (cast<StoreInst>(I).isVolatile())
+      break;
+    return DecodedInst::Store;
+  }
+  return DecodedInst::Generic;
+}
+
+/// decode - Decode F.  When F was decoded before, as Old, the values keep
+/// their slots, so that the running frames of Old can move to the new code.
+///
+FunctionCode *Interpreter::decode(Function *F, const FunctionCode *Old) {
+  ++NumDecodedFunctions;
+  FunctionCode *Code = new FunctionCode();
+  if (Old) {
+    Code->Slots = Old->Slots;
+    Code->InitialValues = Old->InitialValues;
+  } else {
+    for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end();
+         AI != E; ++AI)
+      addSlot(*Code, AI);
+  }
+  unsigned FirstNewSlot = Code->InitialValues.size();
+
+  // Number the instructions, and find where each block starts.
+  DenseMap<const BasicBlock *, unsigned> Targets;
+  unsigned NumInsts = 0;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    Targets[BB] = NumInsts;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      if (!I->getType()->isVoidTy())
+        addSlot(*Code, I);
+      if (!isa<PHINode>(I))
+        ++NumInsts;
+    }
+  }
+
+  SmallVector<std::pair<const BasicBlock *, const BasicBlock *>, 8> BackEdges;
+  FindFunctionBackedges(*F, BackEdges);
+
+  // Decode the edges with the values their PHI nodes take.
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    TerminatorInst *TI = BB->getTerminator();
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+      BasicBlock *Succ = TI->getSuccessor(i);
+      std::pair<DenseMap<std::pair<const BasicBlock *, const BasicBlock *>,
+                         unsigned>::iterator, bool> R =
+        Code->EdgeNumbers.insert(std::make_pair(
+            std::make_pair((const BasicBlock *)BB, (const BasicBlock *)Succ),
+            unsigned(Code->Edges.size())));
+      if (!R.second)
+        continue;
+
+      DecodedEdge Edge;
+      Edge.Dest = Succ;
+      Edge.Target = Targets[Succ];
+      Edge.FirstMove = Code->Moves.size();
+      for (BasicBlock::iterator I = Succ->begin(); isa<PHINode>(I); ++I) {
+        PHINode *PN = cast<PHINode>(I);
+        Code->Moves.push_back(std::make_pair(
+            Code->getSlot(PN),
+            addSlot(*Code, PN->getIncomingValueForBlock(BB))));
+      }
+      Edge.NumMoves = Code->Moves.size() - Edge.FirstMove;
+      Edge.IsBackEdge = std::find(BackEdges.begin(), BackEdges.end(),
+                                  std::make_pair((const BasicBlock *)BB,
+                                                 (const BasicBlock *)Succ)) !=
+                        BackEdges.end();
+      Code->Edges.push_back(Edge);
+    }
+  }
+
+  // Decode the instructions.
+  Code->Insts.reserve(NumInsts);
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    for (BasicBlock::iterator I = BB->getFirstNonPHI(), IE = BB->end();
+         I != IE; ++I) {
+      DecodedInst D;
+      D.Kind = getKind(*I);
+      D.Dest = D.Src[0] = D.Src[1] = D.Succ[0] = D.Succ[1] = 0;
+      D.Inst = I;
+      switch (D.Kind) {
+      case DecodedInst::Generic:
+      case DecodedInst::LowerIntrinsic:
+        break;
+      case DecodedInst::Br:
+        D.Succ[0] =
+          getEdgeNumber(*Code, BB, cast<BranchInst>(I)->getSuccessor(0));
+        break;
+      case DecodedInst::CondBr: {
+        BranchInst *BI = cast<BranchInst>(I);
+        D.Src[0] = addSlot(*Code, BI->getCondition());
+        D.Succ[0] = getEdgeNumber(*Code, BB, BI->getSuccessor(0));
+        D.Succ[1] = getEdgeNumber(*Code, BB, BI->getSuccessor(1));
+        break;
+      }
+      case DecodedInst::Load:
+        D.Dest = Code->getSlot(I);
+        D.Src[0] = addSlot(*Code, I->getOperand(0));
+        break;
+      case DecodedInst::Store:
+        D.Src[0] = addSlot(*Code, I->getOperand(0));
+        D.Src[1] = addSlot(*Code, I->getOperand(1));
+        break;
+      default:
+        // The binary operators and the integer comparisons.
+        D.Dest = Code->getSlot(I);
+        D.Src[0] = addSlot(*Code, I->getOperand(0));
+        D.Src[1] = addSlot(*Code, I->getOperand(1));
+        break;
+      }
+      Code->Insts.push_back(D);
+    }
+
+  // The constants have the same value in all frames.
+  ExecutionContext NoFrame;
+  for (DenseMap<const Value *, unsigned>::iterator I = Code->Slots.begin(),
+       E = Code->Slots.end(); I != E; ++I)
+    if (I->second >= FirstNewSlot && isa<Constant>(I->first))
+      Code->InitialValues[I->second] =
+        getOperandValue(const_cast<Value *>(I->first), NoFrame);
+  return Code;
+}
+
+const FunctionCode *Interpreter::getCode(Function *F) {
+  FunctionCode *&Code = Codes[F];
+  if (!Code)
+    Code = decode(F, 0);
+  return Code;
+}
+
+void Interpreter::freeMachineCodeForFunction(Function *F) {
+  DenseMap<const Function *, FunctionCode *>::iterator I = Codes.find(F);
+  if (I == Codes.end())
+    return;
+  delete I->second;
+  Codes.erase(I);
+}
+
+/// findInst - Return the decoded instruction of I in Code.
+static const DecodedInst *findInst(const FunctionCode &Code,
+                                   const Instruction *I) {
+  for (unsigned i = 0, e = Code.Insts.size(); i != e; ++i)
+    if (Code.Insts[i].Inst == I)
+      return &Code.Insts[i];
+  llvm_unreachable("Instruction is not in the decoded function!");
+}
+
+/// lowerIntrinsicCall - Use the intrinsic lowering class to transform CI, the
+/// instruction SF is running, into hopefully tasty LLVM code.  The function is
+/// decoded again, and all its frames move to the new code, with SF resuming
+/// at the first instruction newly inserted, if any.
+///
+void Interpreter::lowerIntrinsicCall(CallInst *CI, ExecutionContext &SF) {
+  --SF.CurInst;
+  assert(SF.CurInst->Inst == CI && "Lowering a call which is not running!");
+
+  BasicBlock::iterator me(CI);
+  BasicBlock *Parent = CI->getParent();
+  bool atBegin(Parent->begin() == me);
+  if (!atBegin)
+    --me;
+  IL->LowerIntrinsicCall(CI);
+  Instruction *Resume = atBegin ? Parent->begin() : std::next(me);
+
+  FunctionCode *&Code = Codes[SF.CurFunction];
+  FunctionCode *Old = Code;
+  Old->Slots.erase(CI);
+  Code = decode(SF.CurFunction, Old);
+
+  for (unsigned i = 0, e = ECStack.size(); i != e; ++i) {
+    ExecutionContext &Frame = ECStack[i];
+    if (Frame.Code != Old)
+      continue;
+    const Instruction *Next = Frame.CurInst->Inst;
+    Frame.Code = Code;
+    Frame.CurInst = findInst(*Code, Next == CI ? Resume : Next);
+    Frame.Values.insert(Frame.Values.end(),
+                        Code->InitialValues.begin() + Frame.Values.size(),
+                        Code->InitialValues.end());
+  }
+  delete Old;
+}
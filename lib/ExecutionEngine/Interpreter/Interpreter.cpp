@@ -14,6 +14,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "Interpreter.h"
+#include "TieredInterpreter.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Module.h"
@@ -23,7 +25,10 @@ using namespace llvm;
 namespace {
 
 static struct RegisterInterp {
-  RegisterInterp() { Interpreter::Register(); }
+  RegisterInterp() {
+    Interpreter::Register();
+    TieredInterpreter::Register();
+  }
 } InterpRegistrator;
 
 }
@@ -61,6 +66,7 @@ Interpreter::Interpreter(Module *M)
 }
 
 Interpreter::~Interpreter() {
+  DeleteContainerSeconds(Codes);
   delete IL;
 }
 
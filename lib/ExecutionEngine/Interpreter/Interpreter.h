@@ -14,6 +14,7 @@
 #ifndef LLI_INTERPRETER_H
 #define LLI_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -64,31 +65,107 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// DecodedInst - One instruction of a decoded function.  The instructions of
+// the common kinds are run directly on the slots of the stack frame; the
+// others, of kind Generic, are run by visiting Inst.  PHI nodes are not
+// decoded: the edges leading to their block copy their values.
+//
+struct DecodedInst {
+  enum KindTy {
+    Generic, LowerIntrinsic,
+    Br, CondBr,
+    Add, Sub, Mul, And, Or, Xor, Shl, LShr, AShr,
+    // In the order of the integer predicates of CmpInst.
+    ICmpEQ, ICmpNE, ICmpUGT, ICmpUGE, ICmpULT, ICmpULE,
+    ICmpSGT, ICmpSGE, ICmpSLT, ICmpSLE,
+    Load, Store,
+    NumKinds
+  };
+
+  unsigned Kind;
+  unsigned Dest;            // The slot of the result
+  unsigned Src[2];          // The slots of the operands
+  unsigned Succ[2];         // For branches, the edges to the successors
+  Instruction *Inst;
+};
+
+// DecodedEdge - A control flow edge of a decoded function, and the values the
+// PHI nodes of its destination take along it.
+//
+struct DecodedEdge {
+  BasicBlock *Dest;
+  unsigned Target;          // The first instruction of Dest after the PHIs
+  unsigned FirstMove;       // The PHI copies, in FunctionCode::Moves
+  unsigned NumMoves;
+  bool IsBackEdge;          // Whether the edge closes a loop
+};
+
+// FunctionCode - A function decoded for the interpreter.  The arguments and
+// instructions of the function, and the constants its decoded instructions
+// use, are numbered into slots, the values of its stack frames.
+//
+struct FunctionCode {
+  std::vector<DecodedInst> Insts;
+  std::vector<DecodedEdge> Edges;
+  // Moves - The (PHI node, incoming value) slot pairs of the edges.
+  std::vector<std::pair<unsigned, unsigned> > Moves;
+  DenseMap<const Value *, unsigned> Slots;
+  DenseMap<std::pair<const BasicBlock *, const BasicBlock *>, unsigned>
+    EdgeNumbers;
+  // InitialValues - The values of the slots in a new stack frame, which are
+  // the values of the constants.
+  ValuePlaneTy InitialValues;
+
+  unsigned getSlot(const Value *V) const {
+    DenseMap<const Value *, unsigned>::const_iterator I = Slots.find(V);
+    assert(I != Slots.end() && "Value is not in the decoded function!");
+    return I->second;
+  }
+
+  const DecodedEdge &getEdge(const BasicBlock *From,
+                             const BasicBlock *To) const {
+    DenseMap<std::pair<const BasicBlock *, const BasicBlock *>,
+             unsigned>::const_iterator I =
+      EdgeNumbers.find(std::make_pair(From, To));
+    assert(I != EdgeNumbers.end() && "Not an edge of the decoded function!");
+    return Edges[I->second];
+  }
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
 struct ExecutionContext {
   Function             *CurFunction;// The currently executing function
   BasicBlock           *CurBB;      // The currently executing BB
-  BasicBlock::iterator  CurInst;    // The next instruction to execute
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  const FunctionCode   *Code;       // The decoded CurFunction
+  const DecodedInst    *CurInst;    // The next instruction to execute
+  ValuePlaneTy          Values;     // The slots of Code in this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
   AllocaHolderHandle    Allocas;    // Track memory allocated by alloca
+
+  ExecutionContext() : CurFunction(0), CurBB(0), Code(0), CurInst(0) {}
 };
 
 // Interpreter - This class represents the entirety of the interpreter.
 //
 class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   GenericValue ExitValue;          // The return value of the called function
-  DataLayout TD;
   IntrinsicLowering *IL;
 
+  // Codes - The functions decoded so far.
+  DenseMap<const Function *, FunctionCode *> Codes;
+
+protected:
+  DataLayout TD;
+
   // The runtime stack of executing code.  The top of the stack is the current
   // function record.
   std::vector<ExecutionContext> ECStack;
 
+private:
   // AtExitHandlers - List of functions to call when the program exits,
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
@@ -121,20 +198,24 @@ public:
     return 0;
   }
 
-  /// recompileAndRelinkFunction - For the interpreter, functions are always
-  /// up-to-date.
+  /// recompileAndRelinkFunction - Decode the body of F again at its next
+  /// call.
   ///
   void *recompileAndRelinkFunction(Function *F) override {
+    freeMachineCodeForFunction(F);
     return getPointerToFunction(F);
   }
 
-  /// freeMachineCodeForFunction - The interpreter does not generate any code.
+  /// freeMachineCodeForFunction - Drop the decoded body of F, which must not
+  /// be running.
   ///
-  void freeMachineCodeForFunction(Function *F) override { }
+  void freeMachineCodeForFunction(Function *F) override;
 
   // Methods used to execute code:
-  // Place a call on the stack
-  void callFunction(Function *F, const std::vector<GenericValue> &ArgVals);
+  // Place a call on the stack, or run it to completion if it is not
+  // interpreted.
+  virtual void callFunction(Function *F,
+                            const std::vector<GenericValue> &ArgVals);
   void run();                // Execute instructions until nothing left to do
 
   // Opcode Implementations
@@ -202,9 +283,10 @@ public:
     return &(ECStack.back ().VarArgs[0]);
   }
 
-private:  // Helper functions
-  GenericValue executeGEPOperation(Value *Ptr, gep_type_iterator I,
-                                   gep_type_iterator E, ExecutionContext &SF);
+protected:
+  // onBackEdge - Called when SF takes a loop back edge.
+  //
+  virtual void onBackEdge(ExecutionContext &SF) { }
 
   // SwitchToNewBasicBlock - Start execution in a new basic block and run any
   // PHI nodes in the top of the block.  This is used for intraprocedural
@@ -212,6 +294,18 @@ private:  // Helper functions
   //
   void SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF);
 
+  void popStackAndReturnValueToCaller(Type *RetTy, GenericValue Result);
+
+private:  // Helper functions
+  // getCode - Return the decoded body of F, decoding it on its first call.
+  const FunctionCode *getCode(Function *F);
+  FunctionCode *decode(Function *F, const FunctionCode *Old);
+  void lowerIntrinsicCall(CallInst *CI, ExecutionContext &SF);
+  void takeEdge(const DecodedEdge &E, ExecutionContext &SF);
+
+  GenericValue executeGEPOperation(Value *Ptr, gep_type_iterator I,
+                                   gep_type_iterator E, ExecutionContext &SF);
+
   void *getPointerToFunction(Function *F) override { return (void*)F; }
   void *getPointerToBasicBlock(BasicBlock *BB) override { return (void*)BB; }
 
@@ -245,7 +339,6 @@ private:  // Helper functions
                                   ExecutionContext &SF);
   GenericValue executeCastOperation(Instruction::CastOps opcode, Value *SrcVal, 
                                     Type *Ty, ExecutionContext &SF);
-  void popStackAndReturnValueToCaller(Type *RetTy, GenericValue Result);
 
 };
 
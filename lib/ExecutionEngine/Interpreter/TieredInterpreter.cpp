@@ -0,0 +1,397 @@
+//===- TieredInterpreter.cpp - Interpreter promoting hot functions --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the tiered interpreter, which starts running every
+// function in the interpreter and compiles the hot ones with an MCJIT engine.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "tiered-interpreter"
+#include "TieredInterpreter.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ExecutionEngine/TierListener.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <cstdio>
+using namespace llvm;
+
+STATISTIC(NumPromoted, "Number of functions promoted to compiled code");
+STATISTIC(NumUncompilable, "Number of hot functions kept interpreted");
+STATISTIC(NumCompiledCalls, "Number of calls from the interpreter to "
+                            "compiled code");
+
+/// getCompiledName - The name of the compiled code of F, which does not clash
+/// with the symbols of the process.
+static std::string getCompiledName(const Function *F) {
+  return (F->getName() + ".compiled").str();
+}
+
+/// refersToCode - Return whether C is, or is computed from, the address of a
+/// function or of a basic block, which means different things to the
+/// interpreter and to compiled code.
+static bool refersToCode(const Constant *C) {
+  SmallVector<const Constant *, 8> Worklist(1, C);
+  SmallPtrSet<const Constant *, 8> Visited;
+  while (!Worklist.empty()) {
+    C = Worklist.pop_back_val();
+    if (!Visited.insert(C))
+      continue;
+    if (isa<Function>(C) || isa<BlockAddress>(C))
+      return true;
+    if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(C)) {
+      Worklist.push_back(GA->getAliasee());
+      continue;
+    }
+    if (isa<GlobalValue>(C))
+      continue;
+    for (User::const_op_iterator I = C->op_begin(), E = C->op_end(); I != E;
+         ++I)
+      Worklist.push_back(cast<Constant>(*I));
+  }
+  return false;
+}
+
+/// checkBody - Return why the body of F cannot be compiled, or an empty
+/// string if it can.  The defined functions F calls are added to Callees.
+static std::string checkBody(Function &F,
+                             SmallVectorImpl<Function *> &Callees) {
+  if (!F.hasName())
+    return "has no name";
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+      CallSite CS(I);
+      for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+           ++OI) {
+        if (CS && CS.isCallee(OI))
+          continue;
+        if (Constant *C = dyn_cast<Constant>(*OI))
+          if (refersToCode(C))
+            return "takes the address of a function or block";
+      }
+      if (!CS)
+        continue;
+
+      Value *CalleeV = CS.getCalledValue()->stripPointerCasts();
+      if (isa<InlineAsm>(CalleeV))
+        continue;
+      Function *Callee = dyn_cast<Function>(CalleeV);
+      if (!Callee)
+        return "makes an indirect call";
+      if (Callee->isIntrinsic())
+        continue;
+      if (!Callee->isDeclaration()) {
+        Callees.push_back(Callee);
+        continue;
+      }
+      // The interpreter keeps the state of these itself.
+      StringRef Name = Callee->getName();
+      if (Name == "exit" || Name == "atexit")
+        return ("calls " + Name + ", which the interpreter implements").str();
+      if (!sys::DynamicLibrary::SearchForAddressOfSymbol(Name))
+        return ("calls " + Name + ", which is not in the process").str();
+    }
+  return std::string();
+}
+
+/// canPassThroughMemory - Return whether the interpreter can store and load
+/// values of type Ty to and from memory.
+static bool canPassThroughMemory(Type *Ty) {
+  if (VectorType *VTy = dyn_cast<VectorType>(Ty))
+    Ty = VTy->getElementType();
+  return Ty->isIntegerTy() || Ty->isFloatTy() || Ty->isDoubleTy() ||
+         Ty->isX86_FP80Ty() || Ty->isPointerTy();
+}
+
+/// canCallCompiled - Return whether the interpreter can call the compiled code
+/// of functions of type FTy, passing their arguments and result in memory.
+static bool canCallCompiled(FunctionType *FTy) {
+  if (FTy->isVarArg())
+    return false;
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    if (!canPassThroughMemory(FTy->getParamType(i)))
+      return false;
+  Type *RetTy = FTy->getReturnType();
+  return RetTy->isVoidTy() || canPassThroughMemory(RetTy);
+}
+
+/// createEntry - Create in M the wrapper the interpreter calls Compiled, the
+/// compiled code of a function, through: it loads the arguments from a struct
+/// of type ArgsTy and stores the result.
+static Function *createEntry(Module &M, Function *Compiled,
+                             StructType *&ArgsTy) {
+  LLVMContext &Ctx = M.getContext();
+  FunctionType *FTy = Compiled->getFunctionType();
+  Type *RetTy = FTy->getReturnType();
+  ArgsTy = StructType::get(
+      Ctx, makeArrayRef(FTy->param_begin(), FTy->param_end()));
+  Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  Type *EntryParams[] = { Int8PtrTy, Int8PtrTy };
+  Function *Entry = Function::Create(
+      FunctionType::get(Type::getVoidTy(Ctx), EntryParams, false),
+      GlobalValue::ExternalLinkage, Compiled->getName() + ".entry", &M);
+  Function::arg_iterator AI = Entry->arg_begin();
+  Value *ArgBuf = AI++;
+  Value *RetBuf = AI;
+
+  // The interpreter does not align the buffers for the types they hold.
+  IRBuilder<> Builder(BasicBlock::Create(Ctx, "", Entry));
+  Value *Args = Builder.CreateBitCast(ArgBuf, ArgsTy->getPointerTo());
+  SmallVector<Value *, 8> CallArgs;
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    CallArgs.push_back(
+        Builder.CreateAlignedLoad(Builder.CreateStructGEP(Args, i), 1));
+  CallInst *Call = Builder.CreateCall(Compiled, CallArgs);
+  Call->setCallingConv(Compiled->getCallingConv());
+  if (!RetTy->isVoidTy())
+    Builder.CreateAlignedStore(
+        Call, Builder.CreateBitCast(RetBuf, RetTy->getPointerTo()), 1);
+  Builder.CreateRetVoid();
+  return Entry;
+}
+
+namespace {
+/// ClosureMaterializer - Map the values the functions being compiled refer to
+/// into their module.  Global variables become the addresses the interpreter
+/// allocated them at, and functions outside of the module become declarations
+/// of their compiled code or of the external symbol.
+class ClosureMaterializer : public ValueMaterializer {
+  ExecutionEngine &EE;
+  Module &M;
+  ValueToValueMapTy &VMap;
+  Type *IntPtrTy;
+
+public:
+  ClosureMaterializer(ExecutionEngine &EE, Module &M, ValueToValueMapTy &VMap)
+    : EE(EE), M(M), VMap(VMap),
+      IntPtrTy(EE.getDataLayout()->getIntPtrType(M.getContext())) {}
+
+  Value *materializeValueFor(Value *V) override {
+    if (Function *F = dyn_cast<Function>(V)) {
+      std::string Name =
+          F->isDeclaration() ? F->getName().str() : getCompiledName(F);
+      return M.getOrInsertFunction(Name, F->getFunctionType(),
+                                   F->getAttributes());
+    }
+    if (GlobalVariable *GV = dyn_cast<GlobalVariable>(V)) {
+      uintptr_t Addr = (uintptr_t)EE.getPointerToGlobal(GV);
+      return ConstantExpr::getIntToPtr(ConstantInt::get(IntPtrTy, Addr),
+                                       GV->getType());
+    }
+    if (GlobalAlias *GA = dyn_cast<GlobalAlias>(V))
+      return MapValue(GA->getAliasee(), VMap, RF_None, 0, this);
+    return 0;
+  }
+};
+
+}
+
+/// create - Create a new tiered interpreter object.
+///
+ExecutionEngine *TieredInterpreter::create(Module *M, std::string *ErrStr,
+                                           ExecutionEngine *JIT,
+                                           unsigned Threshold) {
+  if (error_code EC = M->materializeAllPermanently()) {
+    if (ErrStr)
+      *ErrStr = EC.message();
+    return 0;
+  }
+
+  // Lay out memory the way compiled code expects it to be.
+  M->setDataLayout(JIT->getDataLayout());
+  return new TieredInterpreter(M, JIT, Threshold);
+}
+
+TieredInterpreter::TieredInterpreter(Module *M, ExecutionEngine *JIT,
+                                     unsigned Threshold)
+  : Interpreter(M), JIT(JIT), Threshold(Threshold), Listener(0),
+    NumModules(0) {
+}
+
+TieredInterpreter::~TieredInterpreter() {
+  DeleteContainerSeconds(States);
+  delete JIT;
+}
+
+TieredInterpreter::FunctionState &TieredInterpreter::getState(Function *F) {
+  FunctionState *&S = States[F];
+  if (!S)
+    S = new FunctionState();
+  return *S;
+}
+
+void TieredInterpreter::keepInterpreted(Function *F, FunctionState &S,
+                                        const std::string &Why) {
+  DEBUG(dbgs() << "Keeping " << F->getName() << " interpreted: " << Why
+               << "\n");
+  S.Tier = FunctionState::Uncompilable;
+  ++NumUncompilable;
+  if (Listener)
+    Listener->notifyPromotionFailed(*F, Why);
+}
+
+/// promote - Compile F, and the functions it calls which are still
+/// interpreted, unless one of them cannot be, in which case F stays
+/// interpreted.
+///
+void TieredInterpreter::promote(Function *F, FunctionState &S) {
+  if (!canCallCompiled(F->getFunctionType())) {
+    keepInterpreted(F, S, "has arguments or a result the interpreter cannot "
+                          "pass to compiled code");
+    return;
+  }
+
+  SmallVector<Function *, 8> Closure;
+  SmallVector<Function *, 8> Worklist(1, F);
+  SmallPtrSet<Function *, 8> Visited;
+  while (!Worklist.empty()) {
+    Function *G = Worklist.pop_back_val();
+    if (!Visited.insert(G) ||
+        getState(G).Tier == FunctionState::Compiled)
+      continue;
+    std::string Why = checkBody(*G, Worklist);
+    if (!Why.empty()) {
+      if (G != F)
+        Why = "calls " + G->getName().str() + ", which " + Why;
+      keepInterpreted(F, S, Why);
+      return;
+    }
+    Closure.push_back(G);
+  }
+
+  LLVMContext &Ctx = F->getContext();
+  Module *TierModule = new Module(F->getParent()->getModuleIdentifier() +
+                                  ".tier" + utostr(++NumModules), Ctx);
+  TierModule->setTargetTriple(F->getParent()->getTargetTriple());
+  TierModule->setDataLayout(&TD);
+
+  ValueToValueMapTy VMap;
+  for (unsigned i = 0, e = Closure.size(); i != e; ++i) {
+    Function *G = Closure[i];
+    Function *NewG = Function::Create(G->getFunctionType(),
+                                      GlobalValue::ExternalLinkage,
+                                      getCompiledName(G), TierModule);
+    VMap[G] = NewG;
+    Function::arg_iterator NewArg = NewG->arg_begin();
+    for (Function::arg_iterator Arg = G->arg_begin(), E = G->arg_end();
+         Arg != E; ++Arg, ++NewArg) {
+      NewArg->setName(Arg->getName());
+      VMap[Arg] = NewArg;
+    }
+  }
+
+  ClosureMaterializer Materializer(*this, *TierModule, VMap);
+  SmallVector<std::pair<Function *, Function *>, 8> Entries;
+  SmallVector<StructType *, 8> ArgsTys;
+  for (unsigned i = 0, e = Closure.size(); i != e; ++i) {
+    Function *G = Closure[i];
+    Function *NewG = cast<Function>(VMap[G]);
+    SmallVector<ReturnInst *, 8> Returns;
+    CloneFunctionInto(NewG, G, VMap, /*ModuleLevelChanges=*/true, Returns, "",
+                      0, 0, &Materializer);
+    NewG->setVisibility(GlobalValue::DefaultVisibility);
+
+    // Functions only called by compiled code need no entry.
+    if (canCallCompiled(G->getFunctionType())) {
+      StructType *ArgsTy = 0;
+      Entries.push_back(
+          std::make_pair(G, createEntry(*TierModule, NewG, ArgsTy)));
+      ArgsTys.push_back(ArgsTy);
+    }
+  }
+  assert(!verifyModule(*TierModule, &dbgs()) && "Tier module is broken!");
+
+  DEBUG(dbgs() << "Compiling " << Closure.size() << " function(s) for "
+               << F->getName() << " in " << TierModule->getModuleIdentifier()
+               << "\n");
+  JIT->addModule(TierModule);
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i) {
+    FunctionState &GS = getState(Entries[i].first);
+    GS.Entry = (void (*)(void *, void *))
+        JIT->getFunctionAddress(Entries[i].second->getName());
+    GS.ArgsTy = ArgsTys[i];
+  }
+
+  for (unsigned i = 0, e = Closure.size(); i != e; ++i) {
+    Function *G = Closure[i];
+    FunctionState &GS = getState(G);
+    GS.Tier = FunctionState::Compiled;
+    ++NumPromoted;
+    if (Listener)
+      Listener->notifyFunctionPromoted(*G, GS.Calls, GS.BackEdges);
+  }
+}
+
+/// callCompiled - Run the compiled code of F on ArgVals, and return its
+/// result.
+///
+GenericValue
+TieredInterpreter::callCompiled(Function *F, const FunctionState &S,
+                                const std::vector<GenericValue> &ArgVals) {
+  FunctionType *FTy = F->getFunctionType();
+  const StructLayout *Layout = TD.getStructLayout(S.ArgsTy);
+  SmallVector<uint64_t, 8> Args((Layout->getSizeInBytes() + 7) / 8);
+  char *ArgBuf = (char *)Args.data();
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    StoreValueToMemory(ArgVals[i],
+                       (GenericValue *)(ArgBuf + Layout->getElementOffset(i)),
+                       FTy->getParamType(i));
+
+  Type *RetTy = FTy->getReturnType();
+  SmallVector<uint64_t, 2> Ret(
+      RetTy->isVoidTy() ? 0 : (TD.getTypeStoreSize(RetTy) + 7) / 8);
+
+  // The interpreter and the C library buffer the output of the program
+  // separately; keep it in order.
+  outs().flush();
+  S.Entry(ArgBuf, Ret.data());
+  fflush(stdout);
+
+  GenericValue Result;
+  if (!RetTy->isVoidTy())
+    LoadValueFromMemory(Result, (GenericValue *)Ret.data(), RetTy);
+  return Result;
+}
+
+void TieredInterpreter::callFunction(Function *F,
+                                     const std::vector<GenericValue> &ArgVals) {
+  if (!F->isDeclaration()) {
+    FunctionState &S = getState(F);
+    if (S.Tier == FunctionState::Interpreted &&
+        ++S.Calls + S.BackEdges >= Threshold)
+      promote(F, S);
+
+    if (S.Entry) {
+      ++NumCompiledCalls;
+      GenericValue Result = callCompiled(F, S, ArgVals);
+      // Simulate a call and a 'ret' of the compiled function.
+      ECStack.push_back(ExecutionContext());
+      ECStack.back().CurFunction = F;
+      popStackAndReturnValueToCaller(F->getReturnType(), Result);
+      return;
+    }
+  }
+  Interpreter::callFunction(F, ArgVals);
+}
+
+void TieredInterpreter::onBackEdge(ExecutionContext &SF) {
+  FunctionState &S = getState(SF.CurFunction);
+  if (S.Tier == FunctionState::Interpreted)
+    ++S.BackEdges;
+}
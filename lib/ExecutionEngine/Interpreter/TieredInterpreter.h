@@ -0,0 +1,110 @@
+//===-- TieredInterpreter.h -------------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header file defines the tiered interpreter, which hands the functions
+// it runs often to a JIT.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLI_TIEREDINTERPRETER_H
+#define LLI_TIEREDINTERPRETER_H
+
+#include "Interpreter.h"
+#include "llvm/ADT/DenseMap.h"
+#include <string>
+
+namespace llvm {
+
+class StructType;
+class TierListener;
+
+// TieredInterpreter - An interpreter which counts the calls and the loop back
+// edges of the functions it runs, and once a function reaches the threshold,
+// compiles it with an MCJIT engine and calls its compiled code from then on.
+//
+// A promoted function is compiled together with all the functions it calls
+// that are still interpreted, in a module of its own where the global
+// variables of the program are the memory of the interpreter, so that
+// compiled code never calls back into the interpreter.  Functions which take
+// the address of a function, call a function pointer, or call exit or atexit,
+// which the interpreter implements itself, cannot be compiled and stay
+// interpreted, as do their callers.  Calls already running in the interpreter
+// finish there: only the next calls of a function run its compiled code.
+//
+class TieredInterpreter : public Interpreter {
+  // FunctionState - The tier of a defined function, and its counters while
+  // it is interpreted.
+  //
+  struct FunctionState {
+    enum TierKind { Interpreted, Compiled, Uncompilable };
+    TierKind Tier;
+    uint64_t Calls;
+    uint64_t BackEdges;
+
+    // Entry - For a compiled function, the wrapper loading its arguments from
+    // a struct of type ArgsTy and storing its result, which the interpreter
+    // calls.
+    void (*Entry)(void *Args, void *Result);
+    StructType *ArgsTy;
+
+    FunctionState()
+      : Tier(Interpreted), Calls(0), BackEdges(0), Entry(0), ArgsTy(0) {}
+  };
+
+  ExecutionEngine *JIT;
+  unsigned Threshold;
+  TierListener *Listener;
+  DenseMap<const Function *, FunctionState *> States;
+
+  // NumModules - The number of modules added to the JIT, to name them.
+  unsigned NumModules;
+
+  FunctionState &getState(Function *F);
+  void promote(Function *F, FunctionState &S);
+  void keepInterpreted(Function *F, FunctionState &S, const std::string &Why);
+  GenericValue callCompiled(Function *F, const FunctionState &S,
+                            const std::vector<GenericValue> &ArgVals);
+
+public:
+  // TieredInterpreter - Interpret M, and promote functions to JIT once they
+  // were called or looped Threshold times.  Takes ownership of JIT.
+  TieredInterpreter(Module *M, ExecutionEngine *JIT, unsigned Threshold);
+  ~TieredInterpreter();
+
+  static void Register() {
+    TieredCtor = create;
+  }
+
+  /// create - Create a tiered interpreter of M compiling code with JIT, an
+  /// MCJIT engine which is destroyed with it.
+  ///
+  static ExecutionEngine *create(Module *M, std::string *ErrorStr,
+                                 ExecutionEngine *JIT, unsigned Threshold);
+
+  void callFunction(Function *F,
+                    const std::vector<GenericValue> &ArgVals) override;
+
+  void setTierListener(TierListener *L) override { Listener = L; }
+
+  // The compiled code comes from the JIT, which the object cache and the
+  // target machine are for.
+  void setObjectCache(ObjectCache *Cache) override {
+    JIT->setObjectCache(Cache);
+  }
+  TargetMachine *getTargetMachine() override {
+    return JIT->getTargetMachine();
+  }
+
+protected:
+  void onBackEdge(ExecutionContext &SF) override;
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,446 @@
+//===-- BackgroundCompiler.cpp - Recompile MCJIT code on a thread ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the BackgroundCompiler class.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "background-compiler"
+#include "llvm/ExecutionEngine/BackgroundCompiler.h"
+#include "llvm/ADT/IntEqClasses.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+using namespace llvm;
+
+STATISTIC(NumStubs, "Number of functions called through stubs");
+STATISTIC(NumOptimized, "Number of functions optimized in the background");
+STATISTIC(NumCancelled, "Number of functions whose optimization was cancelled");
+
+/// InlineDepth - How many calls away from the functions to optimize the
+/// bodies of their callees are read, to be inlined.
+static const unsigned InlineDepth = 2;
+
+/// BatchSize - How many functions optimizeModule optimizes at once at most.
+/// Smaller batches are patched in sooner and let the destructor of the
+/// compiler wait less.
+static const unsigned BatchSize = 8;
+
+/// canCallThroughStub - Return whether a stub forwarding its arguments to the
+/// body of \p F can stand for \p F.
+static bool canCallThroughStub(const Function &F) {
+  if (F.isDeclaration() || F.hasAvailableExternallyLinkage() ||
+      F.isVarArg() || F.hasPrefixData() ||
+      F.hasFnAttribute(Attribute::Naked))
+    return false;
+  for (Function::const_arg_iterator I = F.arg_begin(), E = F.arg_end(); I != E;
+       ++I)
+    if (I->hasInAllocaAttr())
+      return false;
+  return true;
+}
+
+/// externalizeLocals - Give the local symbols of \p M names unique to the
+/// engine and export them, so that other modules can refer to them.
+static void externalizeLocals(Module &M, unsigned ModuleID) {
+  std::string Suffix = ".local" + utostr(ModuleID);
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage()) {
+      I->setName(I->getName() + Suffix);
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      I->setVisibility(GlobalValue::HiddenVisibility);
+    }
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (I->hasLocalLinkage()) {
+      I->setName(I->getName() + Suffix);
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      I->setVisibility(GlobalValue::HiddenVisibility);
+    }
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I)
+    if (I->hasLocalLinkage()) {
+      I->setName(I->getName() + Suffix);
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      I->setVisibility(GlobalValue::HiddenVisibility);
+    }
+}
+
+/// createStub - Move the body of \p F to a new function and make \p F call it
+/// through a new global, which is returned.
+static GlobalVariable *createStub(Function &F, const DataLayout &DL) {
+  Module &M = *F.getParent();
+  LLVMContext &Context = M.getContext();
+  Function *Body = Function::Create(F.getFunctionType(), F.getLinkage(),
+                                    F.getName() + ".tier0", &M);
+  Body->copyAttributesFrom(&F);
+  Body->getBasicBlockList().splice(Body->begin(), F.getBasicBlockList());
+  for (Function::arg_iterator I = F.arg_begin(), E = F.arg_end(),
+                              J = Body->arg_begin();
+       I != E; ++I, ++J) {
+    I->replaceAllUsesWith(J);
+    J->takeName(I);
+  }
+
+  // The slot is an integer, which atomic instructions support.  It is written
+  // with a single store by the worker thread.
+  IntegerType *IntPtrTy = DL.getIntPtrType(Context);
+  GlobalVariable *Slot = new GlobalVariable(
+      M, IntPtrTy, false, GlobalValue::ExternalLinkage,
+      ConstantExpr::getPtrToInt(Body, IntPtrTy), F.getName() + ".slot");
+  Slot->setAlignment(DL.getPointerABIAlignment());
+
+  // The stub reads memory, whatever the body does.
+  F.removeFnAttr(Attribute::ReadNone);
+  F.removeFnAttr(Attribute::ReadOnly);
+
+  IRBuilder<> Builder(BasicBlock::Create(Context, "", &F));
+  LoadInst *Callee = Builder.Insert(new LoadInst(
+      Slot, "", false, Slot->getAlignment(), Unordered));
+  SmallVector<Value *, 8> Args;
+  for (Function::arg_iterator I = F.arg_begin(), E = F.arg_end(); I != E; ++I)
+    Args.push_back(I);
+  CallInst *Call = Builder.CreateCall(
+      Builder.CreateIntToPtr(Callee, Body->getType()), Args);
+  Call->setTailCall();
+  Call->setCallingConv(F.getCallingConv());
+  AttributeSet Attrs = F.getAttributes();
+  Call->setAttributes(Attrs.removeAttributes(
+      Context, AttributeSet::FunctionIndex, Attrs.getFnAttributes()));
+  if (F.getReturnType()->isVoidTy())
+    Builder.CreateRetVoid();
+  else
+    Builder.CreateRet(Call);
+  return Slot;
+}
+
+/// readBodies - Read the bodies of \p Functions from the bitcode of their
+/// module, and of the functions they call up to InlineDepth calls away.
+static void readBodies(std::vector<Function *> Functions) {
+  for (unsigned Depth = 0; !Functions.empty(); ++Depth) {
+    std::vector<Function *> Callees;
+    for (unsigned I = 0, E = Functions.size(); I != E; ++I) {
+      std::string ErrInfo;
+      if (Functions[I]->Materialize(&ErrInfo))
+        report_fatal_error("Could not read back a function: " + ErrInfo);
+      if (Depth == InlineDepth)
+        continue;
+      for (inst_iterator II = inst_begin(Functions[I]),
+                         IE = inst_end(Functions[I]);
+           II != IE; ++II) {
+        CallSite CS(&*II);
+        if (!CS)
+          continue;
+        Function *Callee = CS.getCalledFunction();
+        if (Callee && Callee->isMaterializable())
+          Callees.push_back(Callee);
+      }
+    }
+    Functions.swap(Callees);
+  }
+}
+
+/// prepareClone - Turn the lazily read copy \p M of a source module into a
+/// module defining the optimized versions of the functions named in \p Names,
+/// renamed with a .tier1 suffix, and referring to the symbols of the source
+/// module for everything else.  The functions they call are read too, to be
+/// inlined.
+static void prepareClone(Module &M, const StringSet<> &Names) {
+  SmallVector<GlobalVariable *, 4> Appending;
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    // Constructors and the like belong to the source module.
+    if (I->hasAppendingLinkage()) {
+      Appending.push_back(I);
+      continue;
+    }
+    if (I->isDeclaration())
+      continue;
+    // Keep the values of constants for the optimizer.
+    if (I->isConstant() && I->hasDefinitiveInitializer()) {
+      I->setLinkage(GlobalValue::AvailableExternallyLinkage);
+      continue;
+    }
+    I->setInitializer(0);
+    I->setLinkage(GlobalValue::ExternalLinkage);
+  }
+  for (unsigned I = 0, E = Appending.size(); I != E; ++I) {
+    Appending[I]->replaceAllUsesWith(
+        UndefValue::get(Appending[I]->getType()));
+    Appending[I]->eraseFromParent();
+  }
+
+  while (!M.alias_empty()) {
+    GlobalAlias *GA = M.alias_begin();
+    std::string Name = GA->getName();
+    GA->setName("");
+    Type *Ty = GA->getType()->getElementType();
+    GlobalValue *Decl;
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, Name, &M);
+    else
+      Decl = new GlobalVariable(M, Ty, false, GlobalValue::ExternalLinkage, 0,
+                                Name);
+    GA->replaceAllUsesWith(ConstantExpr::getBitCast(Decl, GA->getType()));
+    GA->eraseFromParent();
+  }
+
+  std::vector<Function *> Functions;
+  for (StringSet<>::const_iterator I = Names.begin(), E = Names.end(); I != E;
+       ++I)
+    Functions.push_back(M.getFunction(I->getKey()));
+  readBodies(Functions);
+
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isMaterializable()) {
+      // Left unread, the function is just declared.
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      continue;
+    }
+    if (I->isDeclaration())
+      continue;
+    if (Names.count(I->getName()))
+      I->setName(I->getName() + ".tier1");
+    else
+      I->setLinkage(GlobalValue::AvailableExternallyLinkage);
+  }
+}
+
+/// optimizeClone - Run the optimization pipeline of \p OptLevel over \p M and
+/// drop the functions kept for inlining.
+static void optimizeClone(Module &M, CodeGenOpt::Level OptLevel,
+                          TargetMachine &TM) {
+  PassManagerBuilder Builder;
+  Builder.OptLevel = OptLevel;
+  if (OptLevel > CodeGenOpt::Less)
+    Builder.Inliner = createFunctionInliningPass(OptLevel, 0);
+  else if (OptLevel != CodeGenOpt::None)
+    Builder.Inliner = createAlwaysInlinerPass();
+
+  FunctionPassManager FPM(&M);
+  FPM.add(new DataLayoutPass(&M));
+  TM.addAnalysisPasses(FPM);
+  PassManager MPM;
+  MPM.add(new DataLayoutPass(&M));
+  TM.addAnalysisPasses(MPM);
+  Builder.populateFunctionPassManager(FPM);
+  Builder.populateModulePassManager(MPM);
+
+  FPM.doInitialization();
+  // Running the passes would read the functions left unread.
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      FPM.run(*I);
+  FPM.doFinalization();
+  MPM.run(M);
+
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (I->hasAvailableExternallyLinkage())
+      I->deleteBody();
+}
+
+BackgroundCompiler::BackgroundCompiler(ExecutionEngine &EE,
+                                       CodeGenOpt::Level OptLevel)
+    : EE(EE), OptLevel(OptLevel), Cancelled(false), Pool(1) {}
+
+BackgroundCompiler::~BackgroundCompiler() {
+  {
+    MutexGuard Locked(Lock);
+    Cancelled = true;
+  }
+  Pool.wait();
+  for (unsigned I = 0, E = Sources.size(); I != E; ++I)
+    delete Sources[I];
+}
+
+void BackgroundCompiler::addModule(Module *M) {
+  externalizeLocals(*M, Sources.size());
+
+  SourceModule *Source = new SourceModule();
+  Source->Name = M->getModuleIdentifier();
+  raw_string_ostream OS(Source->Bitcode);
+  WriteBitcodeToFile(M, OS);
+  OS.flush();
+  Sources.push_back(Source);
+
+  // Collect the functions first, since stubs add functions to the module.
+  std::vector<Function *> Functions;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (canCallThroughStub(*I))
+      Functions.push_back(I);
+  for (unsigned I = 0, E = Functions.size(); I != E; ++I) {
+    GlobalVariable *Slot = createStub(*Functions[I], *EE.getDataLayout());
+    const Function *Body = cast<Function>(
+        cast<ConstantExpr>(Slot->getInitializer())->getOperand(0));
+    StubInfo Info = { Source, Slot->getName(), Body, false };
+    Stubs[Functions[I]] = Info;
+    ++NumStubs;
+  }
+
+  EE.addModule(M);
+}
+
+bool BackgroundCompiler::optimizeFunction(const Function *F) {
+  DenseMap<const Function *, StubInfo>::iterator I = Stubs.find(F);
+  if (I == Stubs.end())
+    return false;
+  if (I->second.Queued)
+    return true;
+  I->second.Queued = true;
+
+  Request *R = new Request();
+  R->Source = I->second.Source;
+  R->Names.push_back(std::make_pair(F->getName(), I->second.SlotName));
+  R->Functions.push_back(F);
+  queue(R);
+  return true;
+}
+
+void BackgroundCompiler::optimizeModule(const Module *M) {
+  std::vector<const Function *> Functions;
+  DenseMap<const Function *, unsigned> Numbers;
+  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I) {
+    DenseMap<const Function *, StubInfo>::iterator S = Stubs.find(I);
+    if (S == Stubs.end() || S->second.Queued)
+      continue;
+    S->second.Queued = true;
+    Numbers[I] = Functions.size();
+    Functions.push_back(I);
+  }
+
+  // Group the functions by the direct calls between them.  The bodies call
+  // the stubs of the other functions.
+  IntEqClasses Groups(Functions.size());
+  for (unsigned I = 0, E = Functions.size(); I != E; ++I)
+    for (const_inst_iterator II = inst_begin(Stubs[Functions[I]].Body),
+                             IE = inst_end(Stubs[Functions[I]].Body);
+         II != IE; ++II) {
+      ImmutableCallSite CS(&*II);
+      if (!CS || !CS.getCalledFunction())
+        continue;
+      DenseMap<const Function *, unsigned>::iterator N =
+          Numbers.find(CS.getCalledFunction());
+      if (N != Numbers.end())
+        Groups.join(I, N->second);
+    }
+  Groups.compress();
+
+  // The groups are numbered in the order of their first function.
+  std::vector<Request *> Requests(Groups.getNumClasses());
+  for (unsigned I = 0, E = Functions.size(); I != E; ++I) {
+    Request *&R = Requests[Groups[I]];
+    if (!R) {
+      R = new Request();
+      R->Source = Stubs[Functions[I]].Source;
+    }
+    R->Names.push_back(std::make_pair(Functions[I]->getName(),
+                                      Stubs[Functions[I]].SlotName));
+    R->Functions.push_back(Functions[I]);
+    if (R->Functions.size() == BatchSize) {
+      queue(R);
+      R = 0;
+    }
+  }
+  for (unsigned I = 0, E = Requests.size(); I != E; ++I)
+    if (Requests[I])
+      queue(Requests[I]);
+}
+
+bool BackgroundCompiler::isOptimized(const Function *F) {
+  MutexGuard Locked(Lock);
+  return Optimized.count(F);
+}
+
+void BackgroundCompiler::queue(Request *R) {
+  // Generate the code of every module now, so that the worker thread only
+  // looks up the symbols the optimized code refers to.
+  EE.finalizeObject();
+  Pool.async([this, R] { compile(R); });
+}
+
+bool BackgroundCompiler::isCancelled(const Request &R) {
+  MutexGuard Locked(Lock);
+  if (Cancelled)
+    NumCancelled += R.Names.size();
+  return Cancelled;
+}
+
+void BackgroundCompiler::compile(Request *R) {
+  std::unique_ptr<Request> Owner(R);
+  if (isCancelled(*R))
+    return;
+
+  // The functions are read into a context of their own, which no other thread
+  // uses, and only the bodies needed are read.
+  LLVMContext Context;
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(R->Source->Bitcode,
+                                                    R->Source->Name, false);
+  ErrorOr<Module *> ModuleOrErr = getLazyBitcodeModule(Buffer, Context);
+  if (error_code EC = ModuleOrErr.getError()) {
+    delete Buffer;
+    report_fatal_error("Could not read back a module: " + EC.message());
+  }
+  std::unique_ptr<Module> M(ModuleOrErr.get());
+  M->setModuleIdentifier(R->Source->Name + ".tier1");
+
+  StringSet<> Names;
+  for (unsigned I = 0, E = R->Names.size(); I != E; ++I)
+    Names.insert(R->Names[I].first);
+  prepareClone(*M, Names);
+  TargetMachine &TM = *EE.getTargetMachine();
+  optimizeClone(*M, OptLevel, TM);
+  if (isCancelled(*R))
+    return;
+
+  DEBUG(dbgs() << "Optimized " << R->Names.size() << " functions of "
+               << R->Source->Name << " in the background\n");
+
+  std::vector<uint64_t> Addrs, Slots;
+  {
+    MutexGuard Locked(EE.lock);
+    CodeGenOpt::Level StubOptLevel = TM.getOptLevel();
+    TM.setOptLevel(OptLevel);
+    EE.addModule(M.get());
+    for (unsigned I = 0, E = R->Names.size(); I != E; ++I) {
+      Addrs.push_back(EE.getFunctionAddress(R->Names[I].first + ".tier1"));
+      Slots.push_back(EE.getGlobalValueAddress(R->Names[I].second));
+    }
+    // The engine needs the module no longer, and must not delete it.
+    EE.removeModule(M.get());
+    TM.setOptLevel(StubOptLevel);
+  }
+
+  // Publish the code once its memory is finalized.
+  sys::MemoryFence();
+  MutexGuard Locked(Lock);
+  for (unsigned I = 0, E = Addrs.size(); I != E; ++I) {
+    assert(Addrs[I] && Slots[I] && "Optimized function was not generated!");
+    *reinterpret_cast<volatile uintptr_t *>(Slots[I]) = Addrs[I];
+    Optimized.insert(R->Functions[I]);
+    ++NumOptimized;
+  }
+}
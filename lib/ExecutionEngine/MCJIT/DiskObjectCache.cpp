@@ -0,0 +1,204 @@
+//===-- DiskObjectCache.cpp - On-disk cache of MCJIT objects --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the DiskObjectCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "disk-object-cache"
+#include "llvm/ExecutionEngine/DiskObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+STATISTIC(NumHits, "Number of objects loaded from the disk object cache");
+STATISTIC(NumMisses, "Number of modules not found in the disk object cache");
+STATISTIC(NumEvicted, "Number of objects evicted from the disk object cache");
+
+namespace {
+/// MappedObject - A private mapping of a cached object.  The dynamic linker
+/// writes to the objects it loads, so the pages it touches are copied while
+/// the file is left alone.
+class MappedObject : public MemoryBuffer {
+  sys::fs::mapped_file_region Region;
+
+public:
+  /// Map the \p Size bytes of file \p FD, which is closed in any case.
+  MappedObject(int FD, uint64_t Size, error_code &EC)
+      : Region(FD, true, sys::fs::mapped_file_region::priv, Size, 0, EC) {
+    if (!EC)
+      init(Region.const_data(), Region.const_data() + Size, false);
+  }
+
+  BufferKind getBufferKind() const override { return MemoryBuffer_MMap; }
+};
+
+/// CachedFile - An object in the cache directory, while pruning it.
+struct CachedFile {
+  sys::TimeValue LastUse;
+  uint64_t Size;
+  std::string Path;
+
+  bool operator<(const CachedFile &RHS) const {
+    if (LastUse != RHS.LastUse)
+      return LastUse < RHS.LastUse;
+    return Path < RHS.Path;
+  }
+};
+}
+
+DiskObjectCache::DiskObjectCache(StringRef Dir, const TargetMachine &TM,
+                                 uint64_t MaxSize)
+    : CacheDir(Dir), MaxSize(MaxSize) {
+  // Everything that changes the code generated for a module, other than the
+  // module itself, is part of the key, including the version of LLVM.
+  raw_string_ostream OS(TargetKey);
+  OS << "LLVM " PACKAGE_VERSION << '\0' << TM.getTargetTriple() << '\0'
+     << TM.getTargetCPU() << '\0' << TM.getTargetFeatureString() << '\0'
+     << TM.getOptLevel() << ' ' << TM.getRelocationModel() << ' '
+     << TM.getCodeModel();
+  const TargetOptions &Options = TM.Options;
+#define OPTION(X) OS << ' ' << Options.X
+  OPTION(UnsafeFPMath); OPTION(NoInfsFPMath); OPTION(NoNaNsFPMath);
+  OPTION(HonorSignDependentRoundingFPMathOption); OPTION(UseSoftFloat);
+  OPTION(NoZerosInBSS); OPTION(JITEmitDebugInfo);
+  OPTION(JITEmitDebugInfoToDisk); OPTION(GuaranteedTailCallOpt);
+  OPTION(DisableTailCalls); OPTION(StackAlignmentOverride);
+  OPTION(EnableFastISel); OPTION(PositionIndependentExecutable);
+  OPTION(EnableSegmentedStacks); OPTION(UseInitArray); OPTION(TrapFuncName);
+  OPTION(FloatABIType); OPTION(AllowFPOpFusion);
+#undef OPTION
+  OS.flush();
+}
+
+DiskObjectCache::~DiskObjectCache() {}
+
+std::string DiskObjectCache::getObjectPath(const Module *M) const {
+  std::string Bitcode;
+  raw_string_ostream OS(Bitcode);
+  WriteBitcodeToFile(M, OS);
+  OS.flush();
+
+  MD5 Hash;
+  Hash.update(TargetKey);
+  Hash.update(Bitcode);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Name;
+  MD5::stringifyResult(Result, Name);
+  Name += ".o";
+
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, Name.str());
+  return Path.str();
+}
+
+MemoryBuffer *DiskObjectCache::getObject(const Module *M) {
+  std::string Path = getObjectPath(M);
+
+  // Objects are only replaced by identical ones, so the file can be opened
+  // after its size is read.
+  sys::fs::file_status Status;
+  int FD;
+  if (!sys::fs::status(Path, Status) && Status.getSize() != 0 &&
+      !sys::fs::openFileForRead(Path, FD)) {
+    // The modification time of an object is the time it was last used.
+    sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+    error_code EC;
+    std::unique_ptr<MappedObject> Obj(
+        new MappedObject(FD, Status.getSize(), EC));
+    if (!EC) {
+      ++NumHits;
+      return Obj.release();
+    }
+  }
+
+  // Remember where to put the object, since compiling the module changes it.
+  ++NumMisses;
+  MutexGuard Locked(Lock);
+  PendingPaths[M] = Path;
+  return 0;
+}
+
+void DiskObjectCache::notifyObjectCompiled(const Module *M,
+                                           const MemoryBuffer *Obj) {
+  std::string Path;
+  {
+    MutexGuard Locked(Lock);
+    DenseMap<const Module *, std::string>::iterator I = PendingPaths.find(M);
+    // The module was compiled without being looked up first, so its IR may
+    // not be the one its object should be found by.
+    if (I == PendingPaths.end())
+      return;
+    Path = I->second;
+    PendingPaths.erase(I);
+  }
+
+  if (sys::fs::create_directories(CacheDir))
+    return;
+
+  // Write the object to a temporary file renamed into place, so that other
+  // processes only ever see complete objects.
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Path + "-%%%%%%.tmp", FD, TempPath))
+    return;
+  raw_fd_ostream OS(FD, true);
+  OS.write(Obj->getBufferStart(), Obj->getBufferSize());
+  OS.close();
+  if (OS.has_error() || sys::fs::rename(TempPath.str(), Path)) {
+    OS.clear_error();
+    sys::fs::remove(TempPath.str());
+    return;
+  }
+
+  if (MaxSize)
+    prune();
+}
+
+void DiskObjectCache::prune() {
+  std::vector<CachedFile> Files;
+  uint64_t TotalSize = 0;
+  error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    if (sys::path::extension(I->path()) != ".o")
+      continue;
+    sys::fs::file_status Status;
+    if (I->status(Status))
+      continue;
+    CachedFile File = { Status.getLastModificationTime(), Status.getSize(),
+                        I->path() };
+    Files.push_back(File);
+    TotalSize += File.Size;
+  }
+
+  // Objects of other processes may be deleted concurrently, in which case we
+  // just delete a bit more than needed.
+  std::sort(Files.begin(), Files.end());
+  for (std::vector<CachedFile>::iterator I = Files.begin(), E = Files.end();
+       I != E && TotalSize > MaxSize; ++I) {
+    if (sys::fs::remove(I->Path))
+      continue;
+    TotalSize -= I->Size;
+    ++NumEvicted;
+  }
+}
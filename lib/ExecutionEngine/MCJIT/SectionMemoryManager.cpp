@@ -72,11 +72,7 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
   // FIXME: Initialize the Near member for each memory group to avoid
   // interleaving.
   error_code ec;
-  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(RequiredSize,
-                                                          &MemGroup.Near,
-                                                          sys::Memory::MF_READ |
-                                                            sys::Memory::MF_WRITE,
-                                                          ec);
+  sys::MemoryBlock MB = allocateBlock(MemGroup, RequiredSize, ec);
   if (ec) {
     // FIXME: Add error propagation to the interface.
     return NULL;
@@ -102,6 +98,19 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
   return (uint8_t*)Addr;
 }
 
+sys::MemoryBlock SectionMemoryManager::allocateBlock(MemoryGroup &MemGroup,
+                                                    uintptr_t Size,
+                                                    error_code &ec) {
+  if (Pool)
+    return Pool->allocate(&MemGroup == &CodeMem ? SectionMemoryPool::Code
+                                                : SectionMemoryPool::Data,
+                          Size, ec);
+  return sys::Memory::allocateMappedMemory(Size, &MemGroup.Near,
+                                           sys::Memory::MF_READ |
+                                             sys::Memory::MF_WRITE,
+                                           ec);
+}
+
 bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
 {
   // FIXME: Should in-progress permissions be reverted if an error occurs?
@@ -110,14 +119,18 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   // Don't allow free memory blocks to be used after setting protection flags.
   CodeMem.FreeMem.clear();
 
-  // Make code memory executable.
-  ec = applyMemoryGroupPermissions(CodeMem,
-                                   sys::Memory::MF_READ | sys::Memory::MF_EXEC);
-  if (ec) {
-    if (ErrMsg) {
-      *ErrMsg = ec.message();
+  // Make code memory executable, unless the pool keeps it executable and
+  // writable all along so as not to split its huge pages.
+  if (!Pool || !Pool->keepsCodeWritable()) {
+    ec = applyMemoryGroupPermissions(CodeMem,
+                                     sys::Memory::MF_READ |
+                                       sys::Memory::MF_EXEC);
+    if (ec) {
+      if (ErrMsg) {
+        *ErrMsg = ec.message();
+      }
+      return true;
     }
-    return true;
   }
 
   // Don't allow free memory blocks to be used after setting protection flags.
@@ -164,13 +177,21 @@ void SectionMemoryManager::invalidateInstructionCache() {
                                             CodeMem.AllocatedMem[i].size());
 }
 
+void SectionMemoryManager::releaseMemoryGroup(MemoryGroup &MemGroup) {
+  for (unsigned i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i) {
+    if (Pool)
+      Pool->release(&MemGroup == &CodeMem ? SectionMemoryPool::Code
+                                          : SectionMemoryPool::Data,
+                    MemGroup.AllocatedMem[i]);
+    else
+      sys::Memory::releaseMappedMemory(MemGroup.AllocatedMem[i]);
+  }
+}
+
 SectionMemoryManager::~SectionMemoryManager() {
-  for (unsigned i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(CodeMem.AllocatedMem[i]);
-  for (unsigned i = 0, e = RWDataMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(RWDataMem.AllocatedMem[i]);
-  for (unsigned i = 0, e = RODataMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(RODataMem.AllocatedMem[i]);
+  releaseMemoryGroup(CodeMem);
+  releaseMemoryGroup(RWDataMem);
+  releaseMemoryGroup(RODataMem);
 }
 
 } // namespace llvm
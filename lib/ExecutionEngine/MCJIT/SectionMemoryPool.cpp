@@ -0,0 +1,118 @@
+//===- SectionMemoryPool.cpp - Memory shared by JIT memory managers -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the SectionMemoryPool class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SectionMemoryPool.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <iterator>
+
+using namespace llvm;
+
+SectionMemoryPool::SectionMemoryPool(size_t SlabSize, bool UseHugePages)
+  : SlabSize(SlabSize), UseHugePages(UseHugePages) {}
+
+SectionMemoryPool::~SectionMemoryPool() {
+  for (unsigned K = 0; K != 2; ++K)
+    for (unsigned i = 0, e = Pools[K].Mapped.size(); i != e; ++i)
+      sys::Memory::releaseMappedMemory(Pools[K].Mapped[i]);
+}
+
+sys::MemoryBlock SectionMemoryPool::allocate(MemoryKind Kind, size_t Size,
+                                             error_code &EC) {
+  static const size_t PageSize = sys::process::get_self()->page_size();
+  Size = size_t(RoundUpToAlignment(std::max(Size, size_t(1)), PageSize));
+  EC = error_code::success();
+
+  MutexGuard Locked(Lock);
+  Slabs &Pool = Pools[Kind];
+  std::map<uintptr_t, size_t>::iterator I = Pool.Free.begin(),
+                                        E = Pool.Free.end();
+  while (I != E && I->second < Size)
+    ++I;
+
+  if (I == E) {
+    // Map a new slab, after the last one if possible.
+    unsigned Flags = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+    if (Kind == Code && keepsCodeWritable())
+      Flags |= sys::Memory::MF_EXEC | sys::Memory::MF_HUGE_HINT;
+    sys::MemoryBlock Slab = sys::Memory::allocateMappedMemory(
+        std::max(Size, SlabSize),
+        Pool.Mapped.empty() ? 0 : &Pool.Mapped.back(), Flags, EC);
+    if (EC)
+      return sys::MemoryBlock();
+    Pool.Mapped.push_back(Slab);
+    I = Pool.Free.insert(std::make_pair((uintptr_t)Slab.base(),
+                                        Slab.size())).first;
+  }
+
+  uintptr_t Addr = I->first;
+  size_t FreeSize = I->second;
+  Pool.Free.erase(I);
+  if (FreeSize > Size)
+    Pool.Free.insert(std::make_pair(Addr + Size, FreeSize - Size));
+  return sys::MemoryBlock((void *)Addr, Size);
+}
+
+void SectionMemoryPool::release(MemoryKind Kind,
+                                const sys::MemoryBlock &Block) {
+  if (!Block.base())
+    return;
+  // Code blocks kept writable never had their permissions changed, and
+  // reprotecting part of a huge page would split it.
+  if (Kind != Code || !keepsCodeWritable())
+    sys::Memory::protectMappedMemory(Block, sys::Memory::MF_READ |
+                                              sys::Memory::MF_WRITE);
+
+  MutexGuard Locked(Lock);
+  std::map<uintptr_t, size_t> &Free = Pools[Kind].Free;
+  uintptr_t Addr = (uintptr_t)Block.base();
+  size_t Size = Block.size();
+
+  // Merge the block with the free blocks just after and before it.
+  std::map<uintptr_t, size_t>::iterator Next = Free.lower_bound(Addr);
+  assert((Next == Free.end() || Next->first >= Addr + Size) &&
+         "Releasing a free block!");
+  if (Next != Free.end() && Next->first == Addr + Size) {
+    Size += Next->second;
+    Free.erase(Next++);
+  }
+  if (Next != Free.begin()) {
+    std::map<uintptr_t, size_t>::iterator Prev = std::prev(Next);
+    assert(Prev->first + Prev->second <= Addr && "Releasing a free block!");
+    if (Prev->first + Prev->second == Addr) {
+      Prev->second += Size;
+      return;
+    }
+  }
+  Free.insert(Next, std::make_pair(Addr, Size));
+}
+
+size_t SectionMemoryPool::getMappedSize(MemoryKind Kind) const {
+  MutexGuard Locked(Lock);
+  size_t Size = 0;
+  for (unsigned i = 0, e = Pools[Kind].Mapped.size(); i != e; ++i)
+    Size += Pools[Kind].Mapped[i].size();
+  return Size;
+}
+
+size_t SectionMemoryPool::getFreeSize(MemoryKind Kind) const {
+  MutexGuard Locked(Lock);
+  size_t Size = 0;
+  for (std::map<uintptr_t, size_t>::const_iterator
+         I = Pools[Kind].Free.begin(), E = Pools[Kind].Free.end();
+       I != E; ++I)
+    Size += I->second;
+  return Size;
+}
@@ -484,7 +484,11 @@ ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
-  ConstantInt *&Slot = pImpl->IntConstants[DenseMapAPIntKeyInfo::KeyTy(V, ITy)];
+  DenseMapAPIntKeyInfo::KeyTy Key(V, ITy);
+  unsigned Shard = LLVMContextImpl::getConstantShard(
+      DenseMapAPIntKeyInfo::getHashValue(Key));
+  UniquingGuard Guard(pImpl, pImpl->IntConstantsLocks[Shard]);
+  ConstantInt *&Slot = pImpl->IntConstants[Shard][Key];
   if (!Slot) Slot = new ConstantInt(ITy, V);
   return Slot;
 }
@@ -608,7 +612,11 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
 
-  ConstantFP *&Slot = pImpl->FPConstants[DenseMapAPFloatKeyInfo::KeyTy(V)];
+  DenseMapAPFloatKeyInfo::KeyTy Key(V);
+  unsigned Shard = LLVMContextImpl::getConstantShard(
+      DenseMapAPFloatKeyInfo::getHashValue(Key));
+  UniquingGuard Guard(pImpl, pImpl->FPConstantsLocks[Shard]);
+  ConstantFP *&Slot = pImpl->FPConstants[Shard][Key];
 
   if (!Slot) {
     Type *Ty;
@@ -835,6 +843,7 @@ Constant *ConstantArray::get(ArrayType *Ty, ArrayRef<Constant*> V) {
   }
 
   // Otherwise, we really do want to create a ConstantArray.
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ArrayConstants.getOrCreate(Ty, V);
 }
 
@@ -898,7 +907,9 @@ Constant *ConstantStruct::get(StructType *ST, ArrayRef<Constant*> V) {
   if (isUndef)
     return UndefValue::get(ST);
 
-  return ST->getContext().pImpl->StructConstants.getOrCreate(ST, V);
+  LLVMContextImpl *pImpl = ST->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  return pImpl->StructConstants.getOrCreate(ST, V);
 }
 
 Constant *ConstantStruct::get(StructType *T, ...) {
@@ -1017,6 +1028,7 @@ Constant *ConstantVector::get(ArrayRef<Constant*> V) {
 
   // Otherwise, the element type isn't compatible with ConstantDataVector, or
   // the operand list constants a ConstantExpr or something else strange.
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->VectorConstants.getOrCreate(T, V);
 }
 
@@ -1234,7 +1246,9 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
   
-  ConstantAggregateZero *&Entry = Ty->getContext().pImpl->CAZConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  ConstantAggregateZero *&Entry = pImpl->CAZConstants[Ty];
   if (Entry == 0)
     Entry = new ConstantAggregateZero(Ty);
 
@@ -1244,14 +1258,18 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 /// destroyConstant - Remove the constant from the constant table.
 ///
 void ConstantAggregateZero::destroyConstant() {
-  getContext().pImpl->CAZConstants.erase(getType());
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  pImpl->CAZConstants.erase(getType());
   destroyConstantImpl();
 }
 
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantArray::destroyConstant() {
-  getType()->getContext().pImpl->ArrayConstants.remove(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  pImpl->ArrayConstants.remove(this);
   destroyConstantImpl();
 }
 
@@ -1262,14 +1280,18 @@ void ConstantArray::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantStruct::destroyConstant() {
-  getType()->getContext().pImpl->StructConstants.remove(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  pImpl->StructConstants.remove(this);
   destroyConstantImpl();
 }
 
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantVector::destroyConstant() {
-  getType()->getContext().pImpl->VectorConstants.remove(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  pImpl->VectorConstants.remove(this);
   destroyConstantImpl();
 }
 
@@ -1314,7 +1336,9 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
-  ConstantPointerNull *&Entry = Ty->getContext().pImpl->CPNConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  ConstantPointerNull *&Entry = pImpl->CPNConstants[Ty];
   if (Entry == 0)
     Entry = new ConstantPointerNull(Ty);
 
@@ -1324,7 +1348,9 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantPointerNull::destroyConstant() {
-  getContext().pImpl->CPNConstants.erase(getType());
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  pImpl->CPNConstants.erase(getType());
   // Free the constant and any dangling references to it.
   destroyConstantImpl();
 }
@@ -1334,7 +1360,9 @@ void ConstantPointerNull::destroyConstant() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
-  UndefValue *&Entry = Ty->getContext().pImpl->UVConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  UndefValue *&Entry = pImpl->UVConstants[Ty];
   if (Entry == 0)
     Entry = new UndefValue(Ty);
 
@@ -1344,8 +1372,10 @@ UndefValue *UndefValue::get(Type *Ty) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void UndefValue::destroyConstant() {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   // Free the constant and any dangling references to it.
-  getContext().pImpl->UVConstants.erase(getType());
+  pImpl->UVConstants.erase(getType());
   destroyConstantImpl();
 }
 
@@ -1358,8 +1388,9 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
-  BlockAddress *&BA =
-    F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
+  LLVMContextImpl *pImpl = F->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  BlockAddress *&BA = pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (BA == 0)
     BA = new BlockAddress(F, BB);
 
@@ -1381,8 +1412,9 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F != 0 && "Block must have a parent");
-  BlockAddress *BA =
-      F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
+  LLVMContextImpl *pImpl = F->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  BlockAddress *BA = pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
   return BA;
 }
@@ -1390,8 +1422,9 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
-  getFunction()->getType()->getContext().pImpl
-    ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  pImpl->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
   destroyConstantImpl();
 }
@@ -1409,15 +1442,16 @@ void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
 
   // See if the 'new' entry already exists, if not, just update this in place
   // and return early.
-  BlockAddress *&NewBA =
-    getContext().pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  BlockAddress *&NewBA = pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
   if (NewBA == 0) {
     getBasicBlock()->AdjustBlockAddressRefCount(-1);
 
     // Remove the old entry, this can't cause the map to rehash (just a
     // tombstone will get added).
-    getContext().pImpl->BlockAddresses.erase(std::make_pair(getFunction(),
-                                                            getBasicBlock()));
+    pImpl->BlockAddresses.erase(std::make_pair(getFunction(),
+                                               getBasicBlock()));
     NewBA = this;
     setOperand(0, NewF);
     setOperand(1, NewBB);
@@ -1451,6 +1485,7 @@ static inline Constant *getFoldedCast(
   // Look up the constant in the table first to ensure uniqueness.
   ExprMapKeyType Key(opc, C);
 
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(Ty, Key);
 }
 
@@ -1774,6 +1809,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C1, Constant *C2,
   ExprMapKeyType Key(Opcode, ArgVec, 0, Flags);
 
   LLVMContextImpl *pImpl = C1->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(C1->getType(), Key);
 }
 
@@ -1851,6 +1887,7 @@ Constant *ConstantExpr::getSelect(Constant *C, Constant *V1, Constant *V2) {
   ExprMapKeyType Key(Instruction::Select, ArgVec);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(V1->getType(), Key);
 }
 
@@ -1887,6 +1924,7 @@ Constant *ConstantExpr::getGetElementPtr(Constant *C, ArrayRef<Value *> Idxs,
                            InBounds ? GEPOperator::IsInBounds : 0);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -1909,6 +1947,7 @@ ConstantExpr::getICmp(unsigned short pred, Constant *LHS, Constant *RHS) {
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -1930,6 +1969,7 @@ ConstantExpr::getFCmp(unsigned short pred, Constant *LHS, Constant *RHS) {
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -1948,6 +1988,7 @@ Constant *ConstantExpr::getExtractElement(Constant *Val, Constant *Idx) {
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
   Type *ReqTy = Val->getType()->getVectorElementType();
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -1967,6 +2008,7 @@ Constant *ConstantExpr::getInsertElement(Constant *Val, Constant *Elt,
   const ExprMapKeyType Key(Instruction::InsertElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(Val->getType(), Key);
 }
 
@@ -1987,6 +2029,7 @@ Constant *ConstantExpr::getShuffleVector(Constant *V1, Constant *V2,
   const ExprMapKeyType Key(Instruction::ShuffleVector, ArgVec);
 
   LLVMContextImpl *pImpl = ShufTy->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ShufTy, Key);
 }
 
@@ -2007,6 +2050,7 @@ Constant *ConstantExpr::getInsertValue(Constant *Agg, Constant *Val,
   const ExprMapKeyType Key(Instruction::InsertValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2028,6 +2072,7 @@ Constant *ConstantExpr::getExtractValue(Constant *Agg,
   const ExprMapKeyType Key(Instruction::ExtractValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2182,7 +2227,9 @@ Constant *ConstantExpr::getBinOpAbsorber(unsigned Opcode, Type *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantExpr::destroyConstant() {
-  getType()->getContext().pImpl->ExprConstants.remove(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  pImpl->ExprConstants.remove(this);
   destroyConstantImpl();
 }
 
@@ -2277,8 +2324,10 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
   StringMap<ConstantDataSequential*>::MapEntryTy &Slot =
-    Ty->getContext().pImpl->CDSConstants.GetOrCreateValue(Elements);
+    pImpl->CDSConstants.GetOrCreateValue(Elements);
 
   // The bucket can point to a linked list of different CDS's that have the same
   // body but different types.  For example, 0,0,0,1 could be a 4 element array
@@ -2301,8 +2350,9 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
 
 void ConstantDataSequential::destroyConstant() {
   // Remove the constant from the StringMap.
-  StringMap<ConstantDataSequential*> &CDSConstants = 
-    getType()->getContext().pImpl->CDSConstants;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  StringMap<ConstantDataSequential*> &CDSConstants = pImpl->CDSConstants;
 
   StringMap<ConstantDataSequential*>::iterator Slot =
     CDSConstants.find(getRawDataValues());
@@ -2316,7 +2366,7 @@ void ConstantDataSequential::destroyConstant() {
     // If there is only one value in the bucket (common case) it must be this
     // entry, and removing the entry should remove the bucket completely.
     assert((*Entry) == this && "Hash mismatch in ConstantDataSequential");
-    getContext().pImpl->CDSConstants.erase(Slot);
+    CDSConstants.erase(Slot);
   } else {
     // Otherwise, there are multiple entries linked off the bucket, unlink the 
     // node we care about but keep the bucket around.
@@ -2587,6 +2637,7 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
   Constant *ToC = cast<Constant>(To);
 
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
 
   SmallVector<Constant*, 8> Values;
   LLVMContextImpl::ArrayConstantsTy::LookupKey Lookup;
@@ -2694,6 +2745,7 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
   Values[OperandToUpdate] = ToC;
 
   LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
 
   Constant *Replacement = 0;
   if (isAllZeros) {
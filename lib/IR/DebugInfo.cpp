@@ -843,6 +843,7 @@ DILocation DILocation::copyWithNewScope(LLVMContext &Ctx,
 /// file and line location.
 unsigned DILocation::computeNewDiscriminator(LLVMContext &Ctx) {
   std::pair<const char *, unsigned> Key(getFilename().data(), getLineNumber());
+  UniquingGuard Guard(Ctx.pImpl, Ctx.pImpl->MetadataLock);
   return ++Ctx.pImpl->DiscriminatorTable[Key];
 }
 
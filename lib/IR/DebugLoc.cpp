@@ -19,7 +19,8 @@ using namespace llvm;
 
 MDNode *DebugLoc::getScope(const LLVMContext &Ctx) const {
   if (ScopeIdx == 0) return 0;
-  
+
+  UniquingGuard Guard(Ctx.pImpl, Ctx.pImpl->MetadataLock);
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -38,8 +39,9 @@ MDNode *DebugLoc::getInlinedAt(const LLVMContext &Ctx) const {
   // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
   // position specified.  Zero is invalid.
   if (ScopeIdx >= 0) return 0;
-  
+
   // Otherwise, the index is in the ScopeInlinedAtRecords array.
+  UniquingGuard Guard(Ctx.pImpl, Ctx.pImpl->MetadataLock);
   assert(unsigned(-ScopeIdx) <= Ctx.pImpl->ScopeInlinedAtRecords.size() &&
          "Invalid ScopeIdx");
   return Ctx.pImpl->ScopeInlinedAtRecords[-ScopeIdx-1].second.get();
@@ -52,7 +54,8 @@ void DebugLoc::getScopeAndInlinedAt(MDNode *&Scope, MDNode *&IA,
     Scope = IA = 0;
     return;
   }
-  
+
+  UniquingGuard Guard(Ctx.pImpl, Ctx.pImpl->MetadataLock);
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -180,6 +183,7 @@ unsigned DenseMapInfo<DebugLoc>::getHashValue(const DebugLoc &Key) {
 
 int LLVMContextImpl::getOrAddScopeRecordIdxEntry(MDNode *Scope,
                                                  int ExistingIdx) {
+  UniquingGuard Guard(this, MetadataLock);
   // If we already have an entry for this scope, return it.
   int &Idx = ScopeRecordIdx[Scope];
   if (Idx) return Idx;
@@ -203,6 +207,7 @@ int LLVMContextImpl::getOrAddScopeRecordIdxEntry(MDNode *Scope,
 
 int LLVMContextImpl::getOrAddScopeInlinedAtIdxEntry(MDNode *Scope, MDNode *IA,
                                                     int ExistingIdx) {
+  UniquingGuard Guard(this, MetadataLock);
   // If we already have an entry, return it.
   int &Idx = ScopeInlinedAtIdx[std::make_pair(Scope, IA)];
   if (Idx) return Idx;
@@ -237,7 +242,8 @@ void DebugRecVH::deleted() {
     setValPtr(0);
     return;
   }
-    
+
+  UniquingGuard Guard(Ctx, Ctx->MetadataLock);
   MDNode *Cur = get();
   
   // If the index is positive, it is an entry in ScopeRecords.
@@ -286,6 +292,7 @@ void DebugRecVH::allUsesReplacedWith(Value *NewVa) {
     return;
   }
   
+  UniquingGuard Guard(Ctx, Ctx->MetadataLock);
   MDNode *OldVal = get();
   assert(OldVal != NewVa && "Node replaced with self?");
   
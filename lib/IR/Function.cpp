@@ -242,8 +242,11 @@ Function::~Function() {
   clearGC();
 
   // Remove the intrinsicID from the Cache.
-  if (getValueName() && isIntrinsic())
-    getContext().pImpl->IntrinsicIDCache.erase(this);
+  if (getValueName() && isIntrinsic()) {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+    pImpl->IntrinsicIDCache.erase(this);
+  }
 }
 
 void Function::BuildLazyArguments() const {
@@ -388,8 +391,10 @@ unsigned Function::getIntrinsicID() const {
   if (!ValName || !isIntrinsic())
     return 0;
 
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ValuesLock);
   LLVMContextImpl::IntrinsicIDCacheTy &IntrinsicIDCache =
-    getContext().pImpl->IntrinsicIDCache;
+    pImpl->IntrinsicIDCache;
   if (!IntrinsicIDCache.count(this)) {
     unsigned Id = lookupIntrinsicID();
     IntrinsicIDCache[this]=Id;
@@ -772,8 +777,9 @@ bool Function::callsFunctionThatReturnsTwice() const {
 
 Constant *Function::getPrefixData() const {
   assert(hasPrefixData());
-  const LLVMContextImpl::PrefixDataMapTy &PDMap =
-      getContext().pImpl->PrefixDataMap;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+  const LLVMContextImpl::PrefixDataMapTy &PDMap = pImpl->PrefixDataMap;
   assert(PDMap.find(this) != PDMap.end());
   return cast<Constant>(PDMap.find(this)->second->getReturnValue());
 }
@@ -783,18 +789,24 @@ void Function::setPrefixData(Constant *PrefixData) {
     return;
 
   unsigned SCData = getSubclassDataFromValue();
-  LLVMContextImpl::PrefixDataMapTy &PDMap = getContext().pImpl->PrefixDataMap;
-  ReturnInst *&PDHolder = PDMap[this];
-  if (PrefixData) {
-    if (PDHolder)
-      PDHolder->setOperand(0, PrefixData);
-    else
-      PDHolder = ReturnInst::Create(getContext(), PrefixData);
-    SCData |= 2;
-  } else {
-    delete PDHolder;
-    PDMap.erase(this);
-    SCData &= ~2;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ReturnInst *OldHolder = 0;
+  {
+    UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+    LLVMContextImpl::PrefixDataMapTy &PDMap = pImpl->PrefixDataMap;
+    ReturnInst *&PDHolder = PDMap[this];
+    if (PrefixData) {
+      if (PDHolder)
+        PDHolder->setOperand(0, PrefixData);
+      else
+        PDHolder = ReturnInst::Create(getContext(), PrefixData);
+      SCData |= 2;
+    } else {
+      OldHolder = PDHolder;
+      PDMap.erase(this);
+      SCData &= ~2;
+    }
   }
+  delete OldHolder;
   setValueSubclassData(SCData);
 }
@@ -30,8 +30,10 @@ InlineAsm *InlineAsm::get(FunctionType *Ty, StringRef AsmString,
                           bool isAlignStack, AsmDialect asmDialect) {
   InlineAsmKeyType Key(AsmString, Constraints, hasSideEffects, isAlignStack,
                        asmDialect);
+  PointerType *PTy = PointerType::getUnqual(Ty);
   LLVMContextImpl *pImpl = Ty->getContext().pImpl;
-  return pImpl->InlineAsms.getOrCreate(PointerType::getUnqual(Ty), Key);
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  return pImpl->InlineAsms.getOrCreate(PTy, Key);
 }
 
 InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
@@ -48,7 +50,9 @@ InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
 }
 
 void InlineAsm::destroyConstant() {
-  getType()->getContext().pImpl->InlineAsms.remove(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ConstantsLock);
+  pImpl->InlineAsms.remove(this);
   delete this;
 }
 
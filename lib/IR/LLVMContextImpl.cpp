@@ -11,15 +11,55 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "uniquing"
 #include "LLVMContextImpl.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/Module.h"
 #include <algorithm>
 using namespace llvm;
 
+STATISTIC(NumContendedConstants,
+          "Number of constant table locks waited for");
+STATISTIC(NumContendedTypes, "Number of type table locks waited for");
+STATISTIC(NumContendedMetadata, "Number of metadata table locks waited for");
+STATISTIC(NumContendedAttributes,
+          "Number of attribute table locks waited for");
+STATISTIC(NumContendedValues,
+          "Number of value handle and intrinsic table locks waited for");
+STATISTIC(NumContendedUseLists, "Number of use list locks waited for");
+
+void UniquingLock::acquireContended() {
+  switch (Group) {
+  case ConstantsGroup:  ++NumContendedConstants; break;
+  case TypesGroup:      ++NumContendedTypes; break;
+  case MetadataGroup:   ++NumContendedMetadata; break;
+  case AttributesGroup: ++NumContendedAttributes; break;
+  case ValuesGroup:     ++NumContendedValues; break;
+  case UseListsGroup:   ++NumContendedUseLists; break;
+  }
+  M.acquire();
+}
+
+UseListGuard::UseListGuard(const Value *V) : L(0) {
+  if (isa<Instruction>(V) || isa<Argument>(V) || isa<BasicBlock>(V))
+    return;
+  LLVMContextImpl *pImpl = V->getContext().pImpl;
+  if (!pImpl->ConcurrentUniquing)
+    return;
+  L = &pImpl->getUseListLock(V);
+  L->acquire();
+}
+
 LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
-  : TheTrueVal(0), TheFalseVal(0),
+  : ConcurrentUniquing(false),
+    ConstantsLock(UniquingLock::ConstantsGroup),
+    TypesLock(UniquingLock::TypesGroup),
+    MetadataLock(UniquingLock::MetadataGroup),
+    AttributesLock(UniquingLock::AttributesGroup),
+    ValuesLock(UniquingLock::ValuesGroup),
+    TheTrueVal(0), TheFalseVal(0),
     VoidTy(C, Type::VoidTyID),
     LabelTy(C, Type::LabelTyID),
     HalfTy(C, Type::HalfTyID),
@@ -89,8 +129,10 @@ LLVMContextImpl::~LLVMContextImpl() {
   DeleteContainerSeconds(CPNConstants);
   DeleteContainerSeconds(UVConstants);
   InlineAsms.freeConstants();
-  DeleteContainerSeconds(IntConstants);
-  DeleteContainerSeconds(FPConstants);
+  for (unsigned i = 0; i != NumConstantShards; ++i) {
+    DeleteContainerSeconds(IntConstants[i]);
+    DeleteContainerSeconds(FPConstants[i]);
+  }
   
   for (StringMap<ConstantDataSequential*>::iterator I = CDSConstants.begin(),
        E = CDSConstants.end(); I != E; ++I)
@@ -31,6 +31,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/Mutex.h"
 #include <vector>
 
 namespace llvm {
@@ -230,6 +231,38 @@ public:
   void allUsesReplacedWith(Value *VNew) override;
 };
   
+/// UniquingLock - A lock guarding one group of the uniquing tables of a
+/// context, taken only while the context is in concurrent uniquing mode.
+/// Acquisitions which have to wait for another thread are counted by the
+/// statistics of the group, which show how contended the tables are.
+class UniquingLock {
+public:
+  enum LockGroup { ConstantsGroup, TypesGroup, MetadataGroup,
+                   AttributesGroup, ValuesGroup, UseListsGroup };
+
+private:
+  sys::Mutex M;
+  LockGroup Group;
+
+  void acquireContended();
+
+public:
+  explicit UniquingLock(LockGroup Group = ConstantsGroup) : Group(Group) {}
+
+  void acquire() {
+    if (!M.tryacquire())
+      acquireContended();
+  }
+  void release() { M.release(); }
+};
+
+/// UseListLock - A lock guarding the use lists of one shard of the values
+/// that the functions of a context share.
+class UseListLock : public UniquingLock {
+public:
+  UseListLock() : UniquingLock(UseListsGroup) {}
+};
+
 class LLVMContextImpl {
 public:
   /// OwnedModules - The set of modules instantiated in this context, and which
@@ -242,13 +275,59 @@ public:
   LLVMContext::DiagnosticHandlerTy DiagnosticHandler;
   void *DiagnosticContext;
 
+  /// ConcurrentUniquing - Whether the tables below are accessed under their
+  /// locks, so that several threads can create constants, types, metadata and
+  /// attributes of this context at once.
+  bool ConcurrentUniquing;
+
+  /// ConstantsLock - Guards the constant tables, except for the shards of
+  /// the integer and floating point constants, which have a lock each.  It is
+  /// taken before the other locks, never after them.
+  UniquingLock ConstantsLock;
+  UniquingLock TypesLock;
+  /// MetadataLock - Guards the metadata tables, the metadata of instructions,
+  /// the metadata kinds, the debug location scopes and the discriminators.
+  UniquingLock MetadataLock;
+  UniquingLock AttributesLock;
+  /// ValuesLock - Guards the value handle lists, the intrinsic ID cache and
+  /// the prefix data map.  Value handles are created under the other locks,
+  /// so no lock but a use list lock is taken while holding this one, and the
+  /// callbacks of the handles run without it.
+  UniquingLock ValuesLock;
+
+  /// The use lists of the values the functions share, which are constants,
+  /// globals, metadata and inline asm, are guarded by the lock of the shard
+  /// of the value.  These locks are taken last: nothing else is done while
+  /// holding one but linking or unlinking a use.
+  enum { NumUseListShards = 64 };
+  UseListLock UseListLocks[NumUseListShards];
+
+  UseListLock &getUseListLock(const Value *V) {
+    return UseListLocks[DenseMapInfo<const Value *>::getHashValue(V) %
+                        NumUseListShards];
+  }
+
+  /// The integer and floating point constants are the ones created the most,
+  /// so their tables are split in shards by the hash of the value, which lets
+  /// threads creating different constants go without waiting for each other.
+  enum { ConstantShardBits = 4, NumConstantShards = 1 << ConstantShardBits };
+
   typedef DenseMap<DenseMapAPIntKeyInfo::KeyTy, ConstantInt *,
                    DenseMapAPIntKeyInfo> IntMapTy;
-  IntMapTy IntConstants;
+  IntMapTy IntConstants[NumConstantShards];
+  UniquingLock IntConstantsLocks[NumConstantShards];
   
   typedef DenseMap<DenseMapAPFloatKeyInfo::KeyTy, ConstantFP*, 
                          DenseMapAPFloatKeyInfo> FPMapTy;
-  FPMapTy FPConstants;
+  FPMapTy FPConstants[NumConstantShards];
+  UniquingLock FPConstantsLocks[NumConstantShards];
+
+  /// getConstantShard - Return the shard of a key of the given hash.  The
+  /// tables use the low bits of the hash, so the shard comes from the high
+  /// bits.
+  static unsigned getConstantShard(unsigned Hash) {
+    return Hash >> (32 - ConstantShardBits);
+  }
 
   FoldingSet<AttributeImpl> AttrsSet;
   FoldingSet<AttributeSetImpl> AttrsLists;
@@ -375,6 +454,40 @@ public:
   ~LLVMContextImpl();
 };
 
+/// UniquingGuard - Hold a uniquing lock of a context for the lifetime of this
+/// object, if the context is in concurrent uniquing mode.
+class UniquingGuard {
+  UniquingLock *L;
+  UniquingGuard(const UniquingGuard &) LLVM_DELETED_FUNCTION;
+  void operator=(const UniquingGuard &) LLVM_DELETED_FUNCTION;
+public:
+  UniquingGuard(const LLVMContextImpl *pImpl, UniquingLock &Lock)
+    : L(pImpl->ConcurrentUniquing ? &Lock : 0) {
+    if (L)
+      L->acquire();
+  }
+  ~UniquingGuard() {
+    if (L)
+      L->release();
+  }
+};
+
+/// UseListGuard - Hold the use list lock of a value for the lifetime of this
+/// object, if the value is shared by the functions of a context which is in
+/// concurrent uniquing mode.  The use lists of instructions, arguments and
+/// basic blocks are only changed by the thread working on their function.
+class UseListGuard {
+  UniquingLock *L;
+  UseListGuard(const UseListGuard &) LLVM_DELETED_FUNCTION;
+  void operator=(const UseListGuard &) LLVM_DELETED_FUNCTION;
+public:
+  explicit UseListGuard(const Value *V);
+  ~UseListGuard() {
+    if (L)
+      L->release();
+  }
+};
+
 }
 
 #endif
@@ -22,6 +22,8 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -460,14 +462,23 @@ namespace {
 static ManagedStatic<sys::SmartMutex<true> > TimingInfoMutex;
 
 class TimingInfo {
-  DenseMap<Pass*, Timer*> TimingData;
+  typedef DenseMap<Pass*, Timer*> PassTimerMap;
+  PassTimerMap TimingData;
   TimerGroup TG;
+
+  // The timers each thread looked up so far, so that threads running their
+  // own pass managers only take TimingInfoMutex the first time they time a
+  // pass. A pass runs on one thread, and so does its timer.
+  sys::ThreadLocal<const PassTimerMap> ThreadTimers;
+  std::vector<PassTimerMap*> AllThreadTimers;
 public:
   // Use 'create' member to get this.
   TimingInfo() : TG("... Pass execution timing report ...") {}
 
   // TimingDtor - Print out information about timing information
   ~TimingInfo() {
+    for (unsigned i = 0, e = AllThreadTimers.size(); i != e; ++i)
+      delete AllThreadTimers[i];
     // Delete all of the timers, which accumulate their info into the
     // TimerGroup.
     for (DenseMap<Pass*, Timer*>::iterator I = TimingData.begin(),
@@ -486,10 +497,21 @@ public:
     if (P->getAsPMDataManager())
       return 0;
 
+    PassTimerMap *Cache = const_cast<PassTimerMap*>(ThreadTimers.get());
+    if (Cache)
+      if (Timer *T = Cache->lookup(P))
+        return T;
+
     sys::SmartScopedLock<true> Lock(*TimingInfoMutex);
+    if (!Cache) {
+      Cache = new PassTimerMap();
+      AllThreadTimers.push_back(Cache);
+      ThreadTimers.set(Cache);
+    }
     Timer *&T = TimingData[P];
     if (T == 0)
       T = new Timer(P->getPassName(), TG);
+    (*Cache)[P] = T;
     return T;
   }
 };
@@ -1309,6 +1331,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        TimeTraceScope PassTrace(BP->getPassName(), F.getName());
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1536,6 +1559,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      TimeTraceScope PassTrace(FP->getPassName(), F.getName());
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1614,6 +1638,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      TimeTraceScope PassTrace(MP->getPassName(), M.getModuleIdentifier());
 
       LocalChanged |= MP->runOnModule(M);
     }
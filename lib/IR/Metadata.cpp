@@ -38,6 +38,7 @@ MDString::MDString(LLVMContext &C)
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
   StringMapEntry<Value*> &Entry =
     pImpl->MDStringCache.GetOrCreateValue(Str);
   Value *&S = Entry.getValue();
@@ -135,6 +136,7 @@ MDNode::~MDNode() {
   assert((getSubclassDataFromValue() & DestroyFlag) != 0 &&
          "Not being destroyed through destroy()?");
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
   if (isNotUniqued()) {
     pImpl->NonUniquedMDNodes.erase(this);
   } else {
@@ -228,6 +230,7 @@ MDNode *MDNode::getMDNode(LLVMContext &Context, ArrayRef<Value*> Vals,
     ID.AddPointer(V);
 
   void *InsertPoint;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
   MDNode *N = pImpl->MDNodeSet.FindNodeOrInsertPos(ID, InsertPoint);
 
   if (N || !Insert)
@@ -321,11 +324,14 @@ void MDNode::Profile(FoldingSetNodeID &ID) const {
 void MDNode::setIsNotUniqued() {
   setValueSubclassData(getSubclassDataFromValue() | NotUniquedBit);
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
   pImpl->NonUniquedMDNodes.insert(this);
 }
 
 // Replace value from this node's operand list.
 void MDNode::replaceOperand(MDNodeOperand *Op, Value *To) {
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
   Value *From = *Op;
 
   // If is possible that someone did GV->RAUW(inst), replacing a global variable
@@ -356,8 +362,6 @@ void MDNode::replaceOperand(MDNodeOperand *Op, Value *To) {
   // already went to null), then there is nothing else to do here.
   if (isNotUniqued()) return;
 
-  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
-
   // Remove "this" from the context map.  FoldingSet doesn't have to reprofile
   // this node to remove it, so we don't care what state the operands are in.
   pImpl->MDNodeSet.RemoveNode(this);
@@ -594,8 +598,10 @@ void Instruction::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   if (!hasMetadataHashEntry())
     return; // Nothing to remove!
 
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
   DenseMap<const Instruction *, LLVMContextImpl::MDMapTy> &MetadataStore =
-      getContext().pImpl->MetadataStore;
+      pImpl->MetadataStore;
 
   if (KnownSet.empty()) {
     // Just drop our entry at the store.
@@ -638,10 +644,13 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     DbgLoc = DebugLoc::getFromDILocation(Node);
     return;
   }
-  
+
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
-    LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
+    LLVMContextImpl::MDMapTy &Info = pImpl->MetadataStore[this];
     assert(!Info.empty() == hasMetadataHashEntry() &&
            "HasMetadata bit is wonked");
     if (Info.empty()) {
@@ -661,16 +670,15 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
   }
 
   // Otherwise, we're removing metadata from an instruction.
-  assert((hasMetadataHashEntry() ==
-          getContext().pImpl->MetadataStore.count(this)) &&
+  assert((hasMetadataHashEntry() == pImpl->MetadataStore.count(this)) &&
          "HasMetadata bit out of date!");
   if (!hasMetadataHashEntry())
     return;  // Nothing to remove!
-  LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
+  LLVMContextImpl::MDMapTy &Info = pImpl->MetadataStore[this];
 
   // Common case is removing the only entry.
   if (Info.size() == 1 && Info[0].first == KindID) {
-    getContext().pImpl->MetadataStore.erase(this);
+    pImpl->MetadataStore.erase(this);
     setHasMetadataHashEntry(false);
     return;
   }
@@ -692,8 +700,10 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
     return DbgLoc.getAsMDNode(getContext());
   
   if (!hasMetadataHashEntry()) return 0;
-  
-  LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
+
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
+  LLVMContextImpl::MDMapTy &Info = pImpl->MetadataStore[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
   for (const auto &I : Info)
@@ -712,12 +722,13 @@ void Instruction::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
                                     DbgLoc.getAsMDNode(getContext())));
     if (!hasMetadataHashEntry()) return;
   }
-  
-  assert(hasMetadataHashEntry() &&
-         getContext().pImpl->MetadataStore.count(this) &&
+
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
+  assert(hasMetadataHashEntry() && pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
   const LLVMContextImpl::MDMapTy &Info =
-    getContext().pImpl->MetadataStore.find(this)->second;
+    pImpl->MetadataStore.find(this)->second;
   assert(!Info.empty() && "Shouldn't have called this");
 
   Result.append(Info.begin(), Info.end());
@@ -731,11 +742,12 @@ void Instruction::
 getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
                                     MDNode*> > &Result) const {
   Result.clear();
-  assert(hasMetadataHashEntry() &&
-         getContext().pImpl->MetadataStore.count(this) &&
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
+  assert(hasMetadataHashEntry() && pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
   const LLVMContextImpl::MDMapTy &Info =
-    getContext().pImpl->MetadataStore.find(this)->second;
+    pImpl->MetadataStore.find(this)->second;
   assert(!Info.empty() && "Shouldn't have called this");
   Result.append(Info.begin(), Info.end());
 
@@ -748,7 +760,9 @@ getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
-  getContext().pImpl->MetadataStore.erase(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->MetadataLock);
+  pImpl->MetadataStore.erase(this);
   setHasMetadataHashEntry(false);
 }
 
@@ -101,6 +101,7 @@ PreservedAnalyses FunctionPassManager::run(Function *F,
 }
 
 bool FunctionAnalysisManager::empty() const {
+  sys::ScopedLock Guard(ResultsLock);
   assert(FunctionAnalysisResults.empty() ==
              FunctionAnalysisResultLists.empty() &&
          "The storage and index of analysis results disagree on how many there "
@@ -109,22 +110,37 @@ bool FunctionAnalysisManager::empty() const {
 }
 
 void FunctionAnalysisManager::clear() {
+  sys::ScopedLock Guard(ResultsLock);
   FunctionAnalysisResults.clear();
   FunctionAnalysisResultLists.clear();
 }
 
 FunctionAnalysisManager::ResultConceptT &
 FunctionAnalysisManager::getResultImpl(void *PassID, Function *F) {
+  {
+    sys::ScopedLock Guard(ResultsLock);
+    FunctionAnalysisResultMapT::iterator RI =
+        FunctionAnalysisResults.find(std::make_pair(PassID, F));
+    if (RI != FunctionAnalysisResults.end())
+      return *RI->second->second;
+  }
+
+  // If we don't have a cached result for this function, look up the pass and
+  // run it to produce a result, which we then add to the cache. The lock is
+  // released meanwhile, as the pass may need other results, and other threads
+  // may be working on other functions.
+  std::unique_ptr<ResultConceptT> Result = lookupPass(PassID).run(F, this);
+
+  sys::ScopedLock Guard(ResultsLock);
   FunctionAnalysisResultMapT::iterator RI;
   bool Inserted;
   std::tie(RI, Inserted) = FunctionAnalysisResults.insert(std::make_pair(
       std::make_pair(PassID, F), FunctionAnalysisResultListT::iterator()));
-
-  // If we don't have a cached result for this function, look up the pass and
-  // run it to produce a result, which we then add to the cache.
+  // Another thread may have computed the same result in the meantime, in
+  // which case the first one wins so that references handed out stay valid.
   if (Inserted) {
     FunctionAnalysisResultListT &ResultList = FunctionAnalysisResultLists[F];
-    ResultList.emplace_back(PassID, lookupPass(PassID).run(F, this));
+    ResultList.emplace_back(PassID, std::move(Result));
     RI->second = std::prev(ResultList.end());
   }
 
@@ -133,12 +149,14 @@ FunctionAnalysisManager::getResultImpl(void *PassID, Function *F) {
 
 FunctionAnalysisManager::ResultConceptT *
 FunctionAnalysisManager::getCachedResultImpl(void *PassID, Function *F) const {
+  sys::ScopedLock Guard(ResultsLock);
   FunctionAnalysisResultMapT::const_iterator RI =
       FunctionAnalysisResults.find(std::make_pair(PassID, F));
   return RI == FunctionAnalysisResults.end() ? 0 : &*RI->second->second;
 }
 
 void FunctionAnalysisManager::invalidateImpl(void *PassID, Function *F) {
+  sys::ScopedLock Guard(ResultsLock);
   FunctionAnalysisResultMapT::iterator RI =
       FunctionAnalysisResults.find(std::make_pair(PassID, F));
   if (RI == FunctionAnalysisResults.end())
@@ -151,6 +169,7 @@ void FunctionAnalysisManager::invalidateImpl(Function *F,
                                              const PreservedAnalyses &PA) {
   // Clear all the invalidated results associated specifically with this
   // function.
+  sys::ScopedLock Guard(ResultsLock);
   SmallVector<void *, 8> InvalidatedPassIDs;
   FunctionAnalysisResultListT &ResultsList = FunctionAnalysisResultLists[F];
   for (FunctionAnalysisResultListT::iterator I = ResultsList.begin(),
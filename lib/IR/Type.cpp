@@ -311,10 +311,12 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
   
-  IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
+  LLVMContextImpl *pImpl = C.pImpl;
+  UniquingGuard Guard(pImpl, pImpl->TypesLock);
+  IntegerType *&Entry = pImpl->IntegerTypes[NumBits];
   
   if (Entry == 0)
-    Entry = new (C.pImpl->TypeAllocator) IntegerType(C, NumBits);
+    Entry = new (pImpl->TypeAllocator) IntegerType(C, NumBits);
   
   return Entry;
 }
@@ -356,6 +358,7 @@ FunctionType *FunctionType::get(Type *ReturnType,
                                 ArrayRef<Type*> Params, bool isVarArg) {
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
   FunctionTypeKeyInfo::KeyTy Key(ReturnType, Params, isVarArg);
+  UniquingGuard Guard(pImpl, pImpl->TypesLock);
   LLVMContextImpl::FunctionTypeMap::iterator I =
     pImpl->FunctionTypes.find_as(Key);
   FunctionType *FT;
@@ -400,16 +403,17 @@ StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes,
                             bool isPacked) {
   LLVMContextImpl *pImpl = Context.pImpl;
   AnonStructTypeKeyInfo::KeyTy Key(ETypes, isPacked);
+  UniquingGuard Guard(pImpl, pImpl->TypesLock);
   LLVMContextImpl::StructTypeMap::iterator I =
     pImpl->AnonStructTypes.find_as(Key);
   StructType *ST;
 
   if (I == pImpl->AnonStructTypes.end()) {
     // Value not found.  Create a new type!
-    ST = new (Context.pImpl->TypeAllocator) StructType(Context);
+    ST = new (pImpl->TypeAllocator) StructType(Context);
     ST->setSubclassData(SCDB_IsLiteral);  // Literal struct.
     ST->setBody(ETypes, isPacked);
-    Context.pImpl->AnonStructTypes[ST] = true;
+    pImpl->AnonStructTypes[ST] = true;
   } else {
     ST = I->first;
   }
@@ -425,7 +429,12 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
     setSubclassData(getSubclassData() | SCDB_Packed);
 
   unsigned NumElements = Elements.size();
-  Type **Elts = getContext().pImpl->TypeAllocator.Allocate<Type*>(NumElements);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  Type **Elts;
+  {
+    UniquingGuard Guard(pImpl, pImpl->TypesLock);
+    Elts = pImpl->TypeAllocator.Allocate<Type*>(NumElements);
+  }
   memcpy(Elts, Elements.data(), sizeof(Elements[0]) * NumElements);
   
   ContainedTys = Elts;
@@ -435,7 +444,9 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
 void StructType::setName(StringRef Name) {
   if (Name == getName()) return;
 
-  StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->TypesLock);
+  StringMap<StructType *> &SymbolTable = pImpl->NamedStructTypes;
   typedef StringMap<StructType *>::MapEntryTy EntryTy;
 
   // If this struct already had a name, remove its symbol table entry. Don't
@@ -454,7 +465,7 @@ void StructType::setName(StringRef Name) {
   }
   
   // Look up the entry for the name.
-  EntryTy *Entry = &getContext().pImpl->NamedStructTypes.GetOrCreateValue(Name);
+  EntryTy *Entry = &SymbolTable.GetOrCreateValue(Name);
   
   // While we have a name collision, try a random rename.
   if (Entry->getValue()) {
@@ -466,10 +477,9 @@ void StructType::setName(StringRef Name) {
     do {
       TempStr.resize(NameSize + 1);
       TmpStream.resync();
-      TmpStream << getContext().pImpl->NamedStructTypesUniqueID++;
+      TmpStream << pImpl->NamedStructTypesUniqueID++;
       
-      Entry = &getContext().pImpl->
-                 NamedStructTypes.GetOrCreateValue(TmpStream.str());
+      Entry = &SymbolTable.GetOrCreateValue(TmpStream.str());
     } while (Entry->getValue());
   }
 
@@ -486,7 +496,12 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
-  StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
+  LLVMContextImpl *pImpl = Context.pImpl;
+  StructType *ST;
+  {
+    UniquingGuard Guard(pImpl, pImpl->TypesLock);
+    ST = new (pImpl->TypeAllocator) StructType(Context);
+  }
   if (!Name.empty())
     ST->setName(Name);
   return ST;
@@ -613,7 +628,9 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 /// getTypeByName - Return the type with the specified name, or null if there
 /// is none by that name.
 StructType *Module::getTypeByName(StringRef Name) const {
-  return getContext().pImpl->NamedStructTypes.lookup(Name);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->TypesLock);
+  return pImpl->NamedStructTypes.lookup(Name);
 }
 
 
@@ -678,6 +695,7 @@ ArrayType *ArrayType::get(Type *elementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
     
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->TypesLock);
   ArrayType *&Entry = 
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
   
@@ -707,8 +725,9 @@ VectorType *VectorType::get(Type *elementType, unsigned NumElements) {
          "Elements of a VectorType must be a primitive type");
   
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
-  VectorType *&Entry = ElementType->getContext().pImpl
-    ->VectorTypes[std::make_pair(ElementType, NumElements)];
+  UniquingGuard Guard(pImpl, pImpl->TypesLock);
+  VectorType *&Entry =
+    pImpl->VectorTypes[std::make_pair(ElementType, NumElements)];
   
   if (Entry == 0)
     Entry = new (pImpl->TypeAllocator) VectorType(ElementType, NumElements);
@@ -729,6 +748,7 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
   
   LLVMContextImpl *CImpl = EltTy->getContext().pImpl;
+  UniquingGuard Guard(CImpl, CImpl->TypesLock);
   
   // Since AddressSpace #0 is the common case, we special case it.
   PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
@@ -8,12 +8,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Use.h"
+#include "LLVMContextImpl.h"
 #include "llvm/IR/User.h"
 #include "llvm/IR/Value.h"
 #include <new>
 
 namespace llvm {
 
+bool Use::GuardSharedUseLists = false;
+
+void Use::removeFromGuardedList() {
+  UseListGuard Guard(Val);
+  unlinkFromList();
+}
+
 void Use::swap(Use &RHS) {
   if (Val == RHS.Val)
     return;
@@ -87,6 +87,11 @@ Value::~Value() {
   LeakDetector::removeGarbageObject(this);
 }
 
+void Value::addGuardedUse(Use &U) {
+  UseListGuard Guard(this);
+  U.addToList(&UseList);
+}
+
 /// hasNUses - Return true if this Value has exactly N users.
 ///
 bool Value::hasNUses(unsigned N) const {
@@ -196,8 +201,11 @@ void Value::setName(const Twine &NewName) {
   if (getSymTab(this, ST))
     return;  // Cannot set a name on this value (e.g. constant).
 
-  if (Function *F = dyn_cast<Function>(this))
-    getContext().pImpl->IntrinsicIDCache.erase(F);
+  if (Function *F = dyn_cast<Function>(this)) {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+    pImpl->IntrinsicIDCache.erase(F);
+  }
 
   if (!ST) { // No symbol table to update?  Just do the change.
     if (NameRef.empty()) {
@@ -552,6 +560,7 @@ void ValueHandleBase::AddToUseList() {
   assert(VP.getPointer() && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ValuesLock);
 
   if (VP.getPointer()->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -591,11 +600,22 @@ void ValueHandleBase::AddToUseList() {
   }
 }
 
+void ValueHandleBase::AddToUseListOf(const ValueHandleBase &RHS) {
+  // The previous pointer of RHS moves when the ValueHandles map grows, so it
+  // is only read under the lock.
+  LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+  AddToExistingUseList(RHS.getPrevPtr());
+}
+
 /// RemoveFromUseList - Remove this ValueHandle from its current use list.
 void ValueHandleBase::RemoveFromUseList() {
   assert(VP.getPointer() && VP.getPointer()->HasValueHandle &&
          "Pointer doesn't have a use list!");
 
+  LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
+  UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
   assert(*PrevPtr == this && "List invariant broken");
@@ -610,7 +630,6 @@ void ValueHandleBase::RemoveFromUseList() {
   // If the Next pointer was null, then it is possible that this was the last
   // ValueHandle watching VP.  If so, delete its entry from the ValueHandles
   // map.
-  LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
   DenseMap<Value*, ValueHandleBase*> &Handles = pImpl->ValueHandles;
   if (Handles.isPointerIntoBucketsArray(PrevPtr)) {
     Handles.erase(VP.getPointer());
@@ -625,7 +644,11 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[V];
+  ValueHandleBase *Entry;
+  {
+    UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+    Entry = pImpl->ValueHandles[V];
+  }
   assert(Entry && "Value bit set but no entries exist");
 
   // We use a local ValueHandleBase as an iterator so that ValueHandles can add
@@ -637,9 +660,15 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // be processed and the checking code will mete out righteous punishment if
   // the handle is still present once we have finished processing all the other
   // value handles (it is fine to momentarily add then remove a value handle).
+  // In concurrent uniquing mode, the lists are only locked while the iterator
+  // moves: the handles lock them again when they are updated, and callbacks
+  // may take other locks of the context.
   for (ValueHandleBase Iterator(Assert, *Entry); Entry; Entry = Iterator.Next) {
-    Iterator.RemoveFromUseList();
-    Iterator.AddToExistingUseListAfter(Entry);
+    {
+      UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+      Iterator.RemoveFromUseList();
+      Iterator.AddToExistingUseListAfter(Entry);
+    }
     assert(Entry->Next == &Iterator && "Loop invariant broken.");
 
     switch (Entry->getKind()) {
@@ -683,17 +712,25 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[Old];
+  ValueHandleBase *Entry;
+  {
+    UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+    Entry = pImpl->ValueHandles[Old];
+  }
 
   assert(Entry && "Value bit set but no entries exist");
 
   // We use a local ValueHandleBase as an iterator so that
   // ValueHandles can add and remove themselves from the list without
   // breaking our iteration.  This is not really an AssertingVH; we
-  // just have to give ValueHandleBase some kind.
+  // just have to give ValueHandleBase some kind.  As in ValueIsDeleted, the
+  // lists are only locked while the iterator moves.
   for (ValueHandleBase Iterator(Assert, *Entry); Entry; Entry = Iterator.Next) {
-    Iterator.RemoveFromUseList();
-    Iterator.AddToExistingUseListAfter(Entry);
+    {
+      UniquingGuard Guard(pImpl, pImpl->ValuesLock);
+      Iterator.RemoveFromUseList();
+      Iterator.AddToExistingUseListAfter(Entry);
+    }
     assert(Entry->Next == &Iterator && "Loop invariant broken.");
 
     switch (Entry->getKind()) {
@@ -721,6 +758,7 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
 #ifndef NDEBUG
   // If any new tracking or weak value handles were added while processing the
   // list, then complain about it now.
+  UniquingGuard Guard(pImpl, pImpl->ValuesLock);
   if (Old->HasValueHandle)
     for (Entry = pImpl->ValueHandles[Old]; Entry; Entry = Entry->Next)
       switch (Entry->getKind()) {
@@ -16,6 +16,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/RuntimeLibcalls.h"
 #include "llvm/Config/config.h"
 #include "llvm/IR/Constants.h"
@@ -67,7 +68,7 @@ LTOCodeGenerator::LTOCodeGenerator()
       TargetMach(NULL), EmitDwarfDebugInfo(false), ScopeRestrictionsDone(false),
       CodeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC),
       InternalizeStrategy(LTO_INTERNALIZE_FULL), NativeObjectFile(NULL),
-      DiagHandler(NULL), DiagContext(NULL) {
+      Parallelism(1), DiagHandler(NULL), DiagContext(NULL) {
   initializeLTOPasses();
 }
 
@@ -230,8 +231,9 @@ bool LTOCodeGenerator::compile_to_file(const char** name,
   // generate object file
   tool_output_file objFile(Filename.c_str(), FD);
 
-  bool genResult = generateObjectFile(objFile.os(), disableOpt, disableInline,
-                                      disableGVNLoadPRE, errMsg);
+  raw_ostream *OS = &objFile.os();
+  bool genResult = generateObjectFiles(OS, disableOpt, disableInline,
+                                       disableGVNLoadPRE, errMsg);
   objFile.os().close();
   if (objFile.os().has_error()) {
     objFile.os().clear_error();
@@ -250,6 +252,57 @@ bool LTOCodeGenerator::compile_to_file(const char** name,
   return true;
 }
 
+bool LTOCodeGenerator::compile_to_files(const char *const **names,
+                                        unsigned *count,
+                                        bool disableOpt,
+                                        bool disableInline,
+                                        bool disableGVNLoadPRE,
+                                        std::string &errMsg) {
+  NativeObjectPaths.clear();
+  NativeObjectNames.clear();
+
+  // make a unique temp .o file for each partition
+  std::vector<std::unique_ptr<tool_output_file>> objFiles;
+  std::vector<raw_ostream *> OSs;
+  for (unsigned I = 0; I != Parallelism; ++I) {
+    SmallString<128> Filename;
+    int FD;
+    error_code EC = sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      return false;
+    }
+    NativeObjectPaths.push_back(Filename.str());
+    objFiles.emplace_back(new tool_output_file(Filename.c_str(), FD));
+    OSs.push_back(&objFiles.back()->os());
+  }
+
+  // generate the object files
+  bool genResult = generateObjectFiles(OSs, disableOpt, disableInline,
+                                       disableGVNLoadPRE, errMsg);
+  bool hasError = false;
+  for (const auto &objFile : objFiles) {
+    objFile->os().close();
+    if (objFile->os().has_error()) {
+      objFile->os().clear_error();
+      hasError = true;
+    }
+  }
+  if (hasError || !genResult) {
+    // The tool_output_files remove their files when they are destroyed.
+    NativeObjectPaths.clear();
+    return false;
+  }
+
+  for (unsigned I = 0; I != Parallelism; ++I) {
+    objFiles[I]->keep();
+    NativeObjectNames.push_back(NativeObjectPaths[I].c_str());
+  }
+  *names = NativeObjectNames.data();
+  *count = NativeObjectNames.size();
+  return true;
+}
+
 const void* LTOCodeGenerator::compile(size_t* length,
                                       bool disableOpt,
                                       bool disableInline,
@@ -463,12 +516,13 @@ void LTOCodeGenerator::applyScopeRestrictions() {
   ScopeRestrictionsDone = true;
 }
 
-/// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          bool DisableOpt,
-                                          bool DisableInline,
-                                          bool DisableGVNLoadPRE,
-                                          std::string &errMsg) {
+/// Optimize merged modules using various IPO passes, and generate code for
+/// them into one object file per output stream.
+bool LTOCodeGenerator::generateObjectFiles(ArrayRef<raw_ostream *> outs,
+                                           bool DisableOpt,
+                                           bool DisableInline,
+                                           bool DisableGVNLoadPRE,
+                                           std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
@@ -504,11 +558,29 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // Make sure everything is still good.
   passes.add(createVerifierPass());
 
+  if (outs.size() > 1) {
+    // The ObjCARCContractPass must run before the module is split, as in the
+    // single object case below.
+    passes.add(createObjCARCContractPass());
+    passes.run(*mergedModule);
+
+    // Each partition is compiled by a target machine of its own, configured
+    // like ours.
+    mergedModule->setTargetTriple(TargetMach->getTargetTriple());
+    return !splitCodeGen(*mergedModule, outs, TargetMach->getTargetCPU(),
+                         TargetMach->getTargetFeatureString(),
+                         TargetMach->Options,
+                         TargetMach->getRelocationModel(),
+                         TargetMach->getCodeModel(),
+                         TargetMach->getOptLevel(),
+                         TargetMachine::CGFT_ObjectFile, errMsg);
+  }
+
   PassManager codeGenPasses;
 
   codeGenPasses.add(new DataLayoutPass(mergedModule));
 
-  formatted_raw_ostream Out(out);
+  formatted_raw_ostream Out(*outs[0]);
 
   // If the bitcode files contain ARC code and were compiled with optimization,
   // the ObjCARCContractPass must be run, so do it unconditionally here.
@@ -11,11 +11,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "link-modules"
 #include "llvm/Linker/Linker.h"
 #include "llvm-c/Linker.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/TypeFinder.h"
@@ -26,6 +29,10 @@
 #include <cctype>
 using namespace llvm;
 
+STATISTIC(NumTypeIndexHits, "Number of struct types matched by structure");
+STATISTIC(NumTypeIndexMisses,
+          "Number of struct types with no isomorphic type by structure");
+
 
 //===----------------------------------------------------------------------===//
 // TypeMap implementation.
@@ -33,6 +40,7 @@ using namespace llvm;
 
 namespace {
   typedef SmallPtrSet<StructType*, 32> TypeSet;
+  typedef DenseMap<unsigned, TinyPtrVector<StructType*> > StructTypeIndexTy;
 
 class TypeMapTy : public ValueMapTypeRemapper {
   /// MappedTypes - This is a mapping from a source type to a destination type
@@ -54,13 +62,26 @@ class TypeMapTy : public ValueMapTypeRemapper {
   SmallPtrSet<StructType*, 16> DstResolvedOpaqueTypes;
 
 public:
-  TypeMapTy(TypeSet &Set) : DstStructTypesSet(Set) {}
+  TypeMapTy(TypeSet &Set, StructTypeIndexTy &Index)
+    : DstStructTypesSet(Set), DstStructTypeIndex(Index) {}
 
   TypeSet &DstStructTypesSet;
+
+  /// DstStructTypeIndex - The non-opaque named types of DstStructTypesSet by
+  /// getStructTypeKey. Types are added as they get a body, so that linking a
+  /// module never looks at the types the previous links left.
+  StructTypeIndexTy &DstStructTypeIndex;
+
   /// addTypeMapping - Indicate that the specified type in the destination
   /// module is conceptually equivalent to the specified type in the source
-  /// module.
-  void addTypeMapping(Type *DstTy, Type *SrcTy);
+  /// module.  Returns true if the types were mapped onto each other.
+  bool addTypeMapping(Type *DstTy, Type *SrcTy);
+
+  /// addTypeMappingByStructure - Map a named struct type of the source module
+  /// onto an isomorphic destination type with the same name up to a numeric
+  /// suffix, found in DstStructTypeIndex. Returns true if one was found.
+  bool addTypeMappingByStructure(StructType *SrcTy,
+                                 const TypeSet &SrcStructTypesSet);
 
   /// linkDefinedTypeBodies - Produce a body for an opaque type in the dest
   /// module from a type definition in the source module.
@@ -95,24 +116,102 @@ private:
 };
 }
 
-void TypeMapTy::addTypeMapping(Type *DstTy, Type *SrcTy) {
+bool TypeMapTy::addTypeMapping(Type *DstTy, Type *SrcTy) {
   Type *&Entry = MappedTypes[SrcTy];
-  if (Entry) return;
+  if (Entry) return Entry == DstTy;
   
   if (DstTy == SrcTy) {
     Entry = DstTy;
-    return;
+    return true;
   }
   
   // Check to see if these types are recursively isomorphic and establish a
   // mapping between them if so.
-  if (!areTypesIsomorphic(DstTy, SrcTy)) {
+  bool Isomorphic = areTypesIsomorphic(DstTy, SrcTy);
+  if (!Isomorphic) {
     // Oops, they aren't isomorphic.  Just discard this request by rolling out
     // any speculative mappings we've established.
     for (unsigned i = 0, e = SpeculativeTypes.size(); i != e; ++i)
       MappedTypes.erase(SpeculativeTypes[i]);
   }
   SpeculativeTypes.clear();
+  return Isomorphic;
+}
+
+/// getStructuralHash - Hash the structure of a type such that isomorphic
+/// types hash the same. Identified structs nested in the type only contribute
+/// their kind, as an opaque struct is isomorphic to any struct.
+static hash_code getStructuralHash(Type *Ty, unsigned Depth) {
+  hash_code Hash = hash_combine(Ty->getTypeID(), Ty->getNumContainedTypes());
+  if (IntegerType *ITy = dyn_cast<IntegerType>(Ty))
+    return hash_combine(Hash, ITy->getBitWidth());
+  if (StructType *STy = dyn_cast<StructType>(Ty)) {
+    if (Depth != 0 && !STy->isLiteral())
+      return hash_combine(Ty->getTypeID());
+    Hash = hash_combine(Hash, STy->isLiteral(), STy->isPacked());
+  } else if (PointerType *PTy = dyn_cast<PointerType>(Ty)) {
+    Hash = hash_combine(Hash, PTy->getAddressSpace());
+  } else if (FunctionType *FTy = dyn_cast<FunctionType>(Ty)) {
+    Hash = hash_combine(Hash, FTy->isVarArg());
+  } else if (ArrayType *ATy = dyn_cast<ArrayType>(Ty)) {
+    Hash = hash_combine(Hash, ATy->getNumElements());
+  } else if (VectorType *VTy = dyn_cast<VectorType>(Ty)) {
+    Hash = hash_combine(Hash, VTy->getNumElements());
+  }
+
+  // A few levels tell types apart well enough, and bound the work on deeply
+  // nested literal types.
+  if (Depth == 3)
+    return Hash;
+  for (unsigned i = 0, e = Ty->getNumContainedTypes(); i != e; ++i)
+    Hash = hash_combine(Hash, getStructuralHash(Ty->getContainedType(i),
+                                                Depth + 1));
+  return Hash;
+}
+
+/// getStructTypeKey - Return the key of a non-opaque named struct type in a
+/// StructTypeIndexTy: the hash of its structure and of its name without the
+/// numeric suffix given to types renamed when loaded into the same context.
+static unsigned getStructTypeKey(StructType *STy) {
+  StringRef Name = STy->getName();
+  size_t DotPos = Name.rfind('.');
+  if (DotPos != 0 && DotPos != StringRef::npos && DotPos + 1 != Name.size() &&
+      Name.substr(DotPos + 1).find_first_not_of("0123456789") ==
+          StringRef::npos)
+    Name = Name.substr(0, DotPos);
+  return hash_combine(Name, getStructuralHash(STy, 0));
+}
+
+/// addToStructTypeIndex - Index a destination struct type if it is named and
+/// has a body. Opaque types are indexed once they get one.
+static void addToStructTypeIndex(StructTypeIndexTy &Index, StructType *STy) {
+  if (!STy->isOpaque() && STy->hasName())
+    Index[getStructTypeKey(STy)].push_back(STy);
+}
+
+bool TypeMapTy::addTypeMappingByStructure(StructType *SrcTy,
+                                          const TypeSet &SrcStructTypesSet) {
+  if (MappedTypes.lookup(SrcTy))
+    return true;
+
+  StructTypeIndexTy::iterator Bucket =
+      DstStructTypeIndex.find(getStructTypeKey(SrcTy));
+  if (Bucket != DstStructTypeIndex.end()) {
+    // Types renamed since they were indexed stay in their old bucket, and
+    // keys may collide: areTypesIsomorphic has the final word.
+    for (TinyPtrVector<StructType*>::iterator I = Bucket->second.begin(),
+         E = Bucket->second.end(); I != E; ++I) {
+      StructType *DstTy = *I;
+      if (SrcStructTypesSet.count(DstTy) || !DstStructTypesSet.count(DstTy))
+        continue;
+      if (addTypeMapping(DstTy, SrcTy)) {
+        ++NumTypeIndexHits;
+        return true;
+      }
+    }
+  }
+  ++NumTypeIndexMisses;
+  return false;
 }
 
 /// areTypesIsomorphic - Recursively walk this pair of types, returning true
@@ -227,15 +326,19 @@ void TypeMapTy::linkDefinedTypeBodies() {
     
     // If DstSTy has no name or has a longer name than STy, then viciously steal
     // STy's name.
-    if (!SrcSTy->hasName()) continue;
-    StringRef SrcName = SrcSTy->getName();
-    
-    if (!DstSTy->hasName() || DstSTy->getName().size() > SrcName.size()) {
-      TmpName.insert(TmpName.end(), SrcName.begin(), SrcName.end());
-      SrcSTy->setName("");
-      DstSTy->setName(TmpName.str());
-      TmpName.clear();
+    if (SrcSTy->hasName()) {
+      StringRef SrcName = SrcSTy->getName();
+      if (!DstSTy->hasName() || DstSTy->getName().size() > SrcName.size()) {
+        TmpName.insert(TmpName.end(), SrcName.begin(), SrcName.end());
+        SrcSTy->setName("");
+        DstSTy->setName(TmpName.str());
+        TmpName.clear();
+      }
     }
+
+    // DstSTy was opaque, so it is not indexed yet.
+    if (DstStructTypesSet.count(DstSTy))
+      addToStructTypeIndex(DstStructTypeIndex, DstSTy);
   }
   
   DstResolvedOpaqueTypes.clear();
@@ -406,15 +509,25 @@ namespace {
     std::vector<Function*> LazilyLinkFunctions;
 
     bool SuppressWarnings;
+
+    // If not null, only the needed globals of the source are linked in, and
+    // these are the symbols to link in even if nothing refers to them.
+    const StringSet<> *RequiredSymbols;
+
+    // The globals of the source module to link in when only linking the
+    // needed ones.
+    SmallPtrSet<GlobalValue*, 64> NeededGlobals;
     
   public:
     std::string ErrorMsg;
 
-    ModuleLinker(Module *dstM, TypeSet &Set, Module *srcM, unsigned mode,
-                 bool SuppressWarnings=false)
-        : DstM(dstM), SrcM(srcM), TypeMap(Set),
+    ModuleLinker(Module *dstM, TypeSet &Set, StructTypeIndexTy &Index,
+                 Module *srcM, unsigned mode, bool SuppressWarnings=false,
+                 const StringSet<> *RequiredSymbols=0)
+        : DstM(dstM), SrcM(srcM), TypeMap(Set, Index),
           ValMaterializer(TypeMap, DstM, LazilyLinkFunctions), Mode(mode),
-          SuppressWarnings(SuppressWarnings) {}
+          SuppressWarnings(SuppressWarnings),
+          RequiredSymbols(RequiredSymbols) {}
 
     bool run();
     
@@ -455,6 +568,12 @@ namespace {
     }
     
     void computeTypeMapping();
+
+    bool computeNeededGlobals();
+    bool isNeeded(GlobalValue *SrcGV) {
+      return !RequiredSymbols || NeededGlobals.count(SrcGV);
+    }
+    void skipUnneededGlobal(GlobalValue *SrcGV);
     
     bool linkAppendingVarProto(GlobalVariable *DstGV, GlobalVariable *SrcGV);
     bool linkGlobalProto(GlobalVariable *SrcGV);
@@ -652,26 +771,34 @@ void ModuleLinker::computeTypeMapping() {
       continue;
     
     // Check to see if the destination module has a struct with the prefix name.
-    if (StructType *DST = DstM->getTypeByName(ST->getName().substr(0, DotPos)))
-      // Don't use it if this actually came from the source module. They're in
-      // the same LLVMContext after all. Also don't use it unless the type is
-      // actually used in the destination module. This can happen in situations
-      // like this:
-      //
-      //      Module A                         Module B
-      //      --------                         --------
-      //   %Z = type { %A }                %B = type { %C.1 }
-      //   %A = type { %B.1, [7 x i8] }    %C.1 = type { i8* }
-      //   %B.1 = type { %C }              %A.2 = type { %B.3, [5 x i8] }
-      //   %C = type { i8* }               %B.3 = type { %C.1 }
-      //
-      // When we link Module B with Module A, the '%B' in Module B is
-      // used. However, that would then use '%C.1'. But when we process '%C.1',
-      // we prefer to take the '%C' version. So we are then left with both
-      // '%C.1' and '%C' being used for the same types. This leads to some
-      // variables using one type and some using the other.
-      if (!SrcStructTypesSet.count(DST) && TypeMap.DstStructTypesSet.count(DST))
-        TypeMap.addTypeMapping(DST, ST);
+    // Don't use it if this actually came from the source module. They're in
+    // the same LLVMContext after all. Also don't use it unless the type is
+    // actually used in the destination module. This can happen in situations
+    // like this:
+    //
+    //      Module A                         Module B
+    //      --------                         --------
+    //   %Z = type { %A }                %B = type { %C.1 }
+    //   %A = type { %B.1, [7 x i8] }    %C.1 = type { i8* }
+    //   %B.1 = type { %C }              %A.2 = type { %B.3, [5 x i8] }
+    //   %C = type { i8* }               %B.3 = type { %C.1 }
+    //
+    // When we link Module B with Module A, the '%B' in Module B is
+    // used. However, that would then use '%C.1'. But when we process '%C.1',
+    // we prefer to take the '%C' version. So we are then left with both
+    // '%C.1' and '%C' being used for the same types. This leads to some
+    // variables using one type and some using the other.
+    StructType *DST = DstM->getTypeByName(ST->getName().substr(0, DotPos));
+    if (DST && !SrcStructTypesSet.count(DST) &&
+        TypeMap.DstStructTypesSet.count(DST) &&
+        TypeMap.addTypeMapping(DST, ST))
+      continue;
+
+    // Otherwise, earlier links may have left an isomorphic type under another
+    // suffix of the name. Look it up by structure rather than comparing the
+    // type with each of them.
+    if (!ST->isOpaque())
+      TypeMap.addTypeMappingByStructure(ST, SrcStructTypesSet);
   }
 
   // Don't bother incorporating aliases, they aren't generally typed well.
@@ -681,6 +808,87 @@ void ModuleLinker::computeTypeMapping() {
   TypeMap.linkDefinedTypeBodies();
 }
 
+/// computeNeededGlobals - Find the globals of the source module to link in
+/// when only linking the needed ones. The roots are the appending variables,
+/// the globals named like a global of the destination, so that the linkage
+/// of both is resolved, and the required symbols. Whatever they refer to is
+/// needed as well; function bodies are materialized to find out. Returns true
+/// on error.
+bool ModuleLinker::computeNeededGlobals() {
+  SmallVector<GlobalValue*, 64> Worklist;
+  SmallPtrSet<Constant*, 64> VisitedConstants;
+  SmallVector<Constant*, 16> ConstantWorklist;
+
+  for (Module::global_iterator I = SrcM->global_begin(),
+       E = SrcM->global_end(); I != E; ++I)
+    if (I->hasAppendingLinkage() || getLinkedToGlobal(I) ||
+        (I->hasName() && RequiredSymbols->count(I->getName())))
+      if (NeededGlobals.insert(I))
+        Worklist.push_back(I);
+  for (Module::iterator I = SrcM->begin(), E = SrcM->end(); I != E; ++I)
+    if (getLinkedToGlobal(I) ||
+        (I->hasName() && RequiredSymbols->count(I->getName())))
+      if (NeededGlobals.insert(I))
+        Worklist.push_back(I);
+  for (Module::alias_iterator I = SrcM->alias_begin(), E = SrcM->alias_end();
+       I != E; ++I)
+    if (getLinkedToGlobal(I) ||
+        (I->hasName() && RequiredSymbols->count(I->getName())))
+      if (NeededGlobals.insert(I))
+        Worklist.push_back(I);
+
+  while (!Worklist.empty()) {
+    GlobalValue *GV = Worklist.pop_back_val();
+
+    if (GlobalVariable *Var = dyn_cast<GlobalVariable>(GV)) {
+      if (Var->hasInitializer())
+        ConstantWorklist.push_back(Var->getInitializer());
+    } else if (GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+      if (Constant *Aliasee = GA->getAliasee())
+        ConstantWorklist.push_back(Aliasee);
+    } else {
+      Function *F = cast<Function>(GV);
+      if (F->hasPrefixData())
+        ConstantWorklist.push_back(F->getPrefixData());
+      if (F->isMaterializable() && F->Materialize(&ErrorMsg))
+        return true;
+      for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+        for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE;
+             ++I)
+          for (User::op_iterator OI = I->op_begin(), OE = I->op_end();
+               OI != OE; ++OI)
+            if (Constant *C = dyn_cast<Constant>(*OI))
+              ConstantWorklist.push_back(C);
+    }
+
+    // Globals are referenced directly or through constant expressions and
+    // aggregates.
+    while (!ConstantWorklist.empty()) {
+      Constant *C = ConstantWorklist.pop_back_val();
+      if (!VisitedConstants.insert(C))
+        continue;
+      if (GlobalValue *Ref = dyn_cast<GlobalValue>(C)) {
+        if (Ref->getParent() == SrcM && NeededGlobals.insert(Ref))
+          Worklist.push_back(Ref);
+        continue;
+      }
+      // The block of a blockaddress is not a constant; its function is.
+      for (User::op_iterator OI = C->op_begin(), OE = C->op_end(); OI != OE;
+           ++OI)
+        if (Constant *Op = dyn_cast<Constant>(*OI))
+          ConstantWorklist.push_back(Op);
+    }
+  }
+  return false;
+}
+
+/// skipUnneededGlobal - Leave a global of the source module out of the link.
+/// Only metadata can still refer to it, and it gets a null value instead.
+void ModuleLinker::skipUnneededGlobal(GlobalValue *SrcGV) {
+  DoNotLinkFromSource.insert(SrcGV);
+  ValueMap[SrcGV] = Constant::getNullValue(TypeMap.get(SrcGV->getType()));
+}
+
 /// linkAppendingVarProto - If there were any appending global variables, link
 /// them together now.  Return true on error.
 bool ModuleLinker::linkAppendingVarProto(GlobalVariable *DstGV,
@@ -1240,27 +1448,45 @@ bool ModuleLinker::run() {
   // Loop over all of the linked values to compute type mappings.
   computeTypeMapping();
 
+  if (RequiredSymbols && computeNeededGlobals())
+    return true;
+
   // Insert all of the globals in src into the DstM module... without linking
   // initializers (which could refer to functions not yet mapped over).
   for (Module::global_iterator I = SrcM->global_begin(),
-       E = SrcM->global_end(); I != E; ++I)
+       E = SrcM->global_end(); I != E; ++I) {
+    if (!isNeeded(I)) {
+      skipUnneededGlobal(I);
+      continue;
+    }
     if (linkGlobalProto(I))
       return true;
+  }
 
   // Link the functions together between the two modules, without doing function
   // bodies... this just adds external function prototypes to the DstM
   // function...  We do this so that when we begin processing function bodies,
   // all of the global values that may be referenced are available in our
   // ValueMap.
-  for (Module::iterator I = SrcM->begin(), E = SrcM->end(); I != E; ++I)
+  for (Module::iterator I = SrcM->begin(), E = SrcM->end(); I != E; ++I) {
+    if (!isNeeded(I)) {
+      skipUnneededGlobal(I);
+      continue;
+    }
     if (linkFunctionProto(I))
       return true;
+  }
 
   // If there were any aliases, link them now.
   for (Module::alias_iterator I = SrcM->alias_begin(),
-       E = SrcM->alias_end(); I != E; ++I)
+       E = SrcM->alias_end(); I != E; ++I) {
+    if (!isNeeded(I)) {
+      skipUnneededGlobal(I);
+      continue;
+    }
     if (linkAliasProto(I))
       return true;
+  }
 
   for (unsigned i = 0, e = AppendingVars.size(); i != e; ++i)
     linkAppendingVarInit(AppendingVars[i]);
@@ -1358,10 +1584,13 @@ bool ModuleLinker::run() {
 }
 
 Linker::Linker(Module *M, bool SuppressWarnings)
-    : Composite(M), SuppressWarnings(SuppressWarnings) {
+    : Composite(M), SuppressWarnings(SuppressWarnings),
+      LinkOnlyNeeded(false) {
   TypeFinder StructTypes;
   StructTypes.run(*M, true);
   IdentifiedStructTypes.insert(StructTypes.begin(), StructTypes.end());
+  for (unsigned i = 0, e = StructTypes.size(); i != e; ++i)
+    addToStructTypeIndex(StructTypeIndex, StructTypes[i]);
 }
 
 Linker::~Linker() {
@@ -1373,8 +1602,9 @@ void Linker::deleteModule() {
 }
 
 bool Linker::linkInModule(Module *Src, unsigned Mode, std::string *ErrorMsg) {
-  ModuleLinker TheLinker(Composite, IdentifiedStructTypes, Src, Mode,
-                         SuppressWarnings);
+  ModuleLinker TheLinker(Composite, IdentifiedStructTypes, StructTypeIndex,
+                         Src, Mode, SuppressWarnings,
+                         LinkOnlyNeeded ? &RequiredSymbols : 0);
   if (TheLinker.run()) {
     if (ErrorMsg)
       *ErrorMsg = TheLinker.ErrorMsg;
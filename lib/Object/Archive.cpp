@@ -18,11 +18,13 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 
 using namespace llvm;
 using namespace object;
 
 static const char *const Magic = "!<arch>\n";
+static const char *const ThinMagic = "!<thin>\n";
 
 void Archive::anchor() { }
 
@@ -87,7 +89,11 @@ Archive::Child::Child(const Archive *Parent, const char *Start)
 
   const ArchiveMemberHeader *Header =
       reinterpret_cast<const ArchiveMemberHeader *>(Start);
-  Data = StringRef(Start, sizeof(ArchiveMemberHeader) + Header->getSize());
+  // Only the symbol and string tables of a thin archive are stored in it.
+  uint64_t Size = sizeof(ArchiveMemberHeader);
+  if (!Parent->IsThin || Header->getName() == "/" || Header->getName() == "//")
+    Size += Header->getSize();
+  Data = StringRef(Start, Size);
 
   // Setup StartOfFile and PaddingBytes.
   StartOfFile = sizeof(ArchiveMemberHeader);
@@ -101,6 +107,12 @@ Archive::Child::Child(const Archive *Parent, const char *Start)
   }
 }
 
+uint64_t Archive::Child::getSize() const {
+  if (Parent->IsThin)
+    return getHeader()->getSize();
+  return Data.size() - StartOfFile;
+}
+
 Archive::Child Archive::Child::getNext() const {
   size_t SpaceToSkip = Data.size();
   // If it's odd, add 1 to make it even.
@@ -145,8 +157,12 @@ error_code Archive::Child::getName(StringRef &Result) const {
                    + Parent->StringTable->getSize()))
       return object_error::parse_failed;
 
-    // GNU long file names end with a /.
-    if (Parent->kind() == K_GNU) {
+    // GNU long file names end with a /. The names in thin archives are paths,
+    // so look for the newline following it there.
+    if (Parent->IsThin) {
+      StringRef::size_type End = StringRef(addr).find("/\n");
+      Result = StringRef(addr, End);
+    } else if (Parent->kind() == K_GNU) {
       StringRef::size_type End = StringRef(addr).find('/');
       Result = StringRef(addr, End);
     } else {
@@ -175,6 +191,16 @@ error_code Archive::Child::getMemoryBuffer(std::unique_ptr<MemoryBuffer> &Result
   if (error_code ec = getName(Name))
     return ec;
   SmallString<128> Path;
+  if (Parent->IsThin) {
+    // Member paths are relative to the directory of the archive.
+    if (sys::path::is_relative(Name)) {
+      Path = sys::path::parent_path(Parent->getFileName());
+      sys::path::append(Path, Name);
+    } else {
+      Path = Name;
+    }
+    return MemoryBuffer::getFile(Path.str(), Result, -1, false);
+  }
   Result.reset(MemoryBuffer::getMemBuffer(
       getBuffer(), FullPath ? (Twine(Parent->getFileName()) + "(" + Name + ")")
                                   .toStringRef(Path)
@@ -221,11 +247,17 @@ ErrorOr<Archive*> Archive::create(MemoryBuffer *Source) {
 }
 
 Archive::Archive(MemoryBuffer *source, error_code &ec)
-  : Binary(Binary::ID_Archive, source), SymbolTable(child_end()) {
+  : Binary(Binary::ID_Archive, source), SymbolTable(child_end()),
+    IsThin(false), PublishedSymbolIndex(0) {
   // Check for sufficient magic.
   assert(source);
-  if (source->getBufferSize() < 8 ||
-      StringRef(source->getBufferStart(), 8) != Magic) {
+  if (source->getBufferSize() < 8) {
+    ec = object_error::invalid_file_type;
+    return;
+  }
+  StringRef Buffer(source->getBufferStart(), 8);
+  IsThin = Buffer == ThinMagic;
+  if (Buffer != Magic && !IsThin) {
     ec = object_error::invalid_file_type;
     return;
   }
@@ -454,22 +486,42 @@ Archive::symbol_iterator Archive::symbol_end() const {
     Symbol(this, symbol_count, 0));
 }
 
-Archive::child_iterator Archive::findSym(StringRef name) const {
-  Archive::symbol_iterator bs = symbol_begin();
-  Archive::symbol_iterator es = symbol_end();
-  Archive::child_iterator result;
-  
-  StringRef symname;
-  for (; bs != es; ++bs) {
-    if (bs->getName(symname))
-        return child_end();
-    if (symname == name) {
-      if (bs->getMember(result))
-        return child_end();
-      return result;
+const Archive::SymbolIndexTy &Archive::getSymbolIndex() const {
+  if (const SymbolIndexTy *Published =
+          PublishedSymbolIndex.load(std::memory_order_acquire))
+    return *Published;
+
+  sys::ScopedLock Guard(SymbolIndexLock);
+  if (SymbolIndex)
+    return *SymbolIndex;
+
+  std::unique_ptr<SymbolIndexTy> NewIndex(new SymbolIndexTy());
+  if (hasSymbolTable() && kind() != K_BSD) {
+    uint32_t Index = 0;
+    StringRef SymName;
+    for (symbol_iterator I = symbol_begin(), E = symbol_end(); I != E;
+         ++I, ++Index) {
+      if (I->getName(SymName))
+        break;
+      // Like a walk of the symbol table, find the first definition.
+      NewIndex->GetOrCreateValue(SymName, Index);
     }
   }
-  return child_end();
+  SymbolIndex = std::move(NewIndex);
+  PublishedSymbolIndex.store(SymbolIndex.get(), std::memory_order_release);
+  return *SymbolIndex;
+}
+
+Archive::child_iterator Archive::findSym(StringRef name) const {
+  const SymbolIndexTy &Index = getSymbolIndex();
+  SymbolIndexTy::const_iterator I = Index.find(name);
+  if (I == Index.end())
+    return child_end();
+
+  Archive::child_iterator result;
+  if (Symbol(this, I->getValue(), 0).getMember(result))
+    return child_end();
+  return result;
 }
 
 bool Archive::hasSymbolTable() const {
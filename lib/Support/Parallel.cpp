@@ -0,0 +1,71 @@
+//===- llvm/Support/Parallel.cpp - Parallel algorithms --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements TaskGroup.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include <chrono>
+
+using namespace llvm;
+
+#if LLVM_ENABLE_THREADS
+
+TaskGroup::TaskGroup(ThreadPool &Pool) : Pool(Pool), Pending(0) {}
+
+TaskGroup::~TaskGroup() { wait(); }
+
+void TaskGroup::spawnImpl(ThreadPool::TaskTy Task) {
+  {
+    std::unique_lock<std::mutex> LockGuard(Lock);
+    ++Pending;
+  }
+  Pool.async([this, Task] {
+    Task();
+    std::unique_lock<std::mutex> LockGuard(Lock);
+    if (--Pending == 0)
+      Done.notify_all();
+  });
+}
+
+void TaskGroup::wait() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> LockGuard(Lock);
+      if (Pending == 0)
+        return;
+    }
+
+    // Help the pool rather than blocking, as this may be one of its workers.
+    if (Pool.runPendingTask())
+      continue;
+
+    // Nothing is queued, so our tasks are running on other threads. Tasks
+    // they spawn may still need our help, hence the timeout.
+    std::unique_lock<std::mutex> LockGuard(Lock);
+    Done.wait_for(LockGuard, std::chrono::milliseconds(1),
+                  [&] { return Pending == 0; });
+  }
+}
+
+#else // LLVM_ENABLE_THREADS Disabled
+
+TaskGroup::TaskGroup(ThreadPool &Pool) : Pool(Pool) {}
+
+TaskGroup::~TaskGroup() {}
+
+void TaskGroup::spawnImpl(ThreadPool::TaskTy Task) {
+  // The pool runs the task right away.
+  Pool.async(std::move(Task));
+}
+
+void TaskGroup::wait() {}
+
+#endif
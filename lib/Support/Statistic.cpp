@@ -25,11 +25,14 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 using namespace llvm;
 
@@ -44,6 +47,26 @@ Enabled(
     "stats",
     cl::desc("Enable statistics output from program (available with Asserts)"));
 
+bool llvm::ThreadLocalStatistics = false;
+
+static cl::opt<bool, true>
+ThreadLocal("stats-thread-local",
+            cl::desc("Count statistics per thread and merge the counts when "
+                     "they are read"),
+            cl::location(ThreadLocalStatistics), cl::Hidden);
+
+namespace {
+enum StatisticsFormat { StatsText, StatsJSON, StatsCSV };
+}
+
+static cl::opt<StatisticsFormat>
+Format("stats-format", cl::desc("Format of the -stats output"),
+       cl::init(StatsText),
+       cl::values(clEnumValN(StatsText, "text", "Human readable table"),
+                  clEnumValN(StatsJSON, "json", "JSON object"),
+                  clEnumValN(StatsCSV, "csv", "Comma separated values"),
+                  clEnumValEnd));
+
 
 namespace {
 /// StatisticInfo - This class is used in a ManagedStatic so that it is created
@@ -53,17 +76,83 @@ class StatisticInfo {
   std::vector<const Statistic*> Stats;
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
+  friend void llvm::PrintStatisticsJSON(raw_ostream &OS);
+  friend void llvm::PrintStatisticsCSV(raw_ostream &OS);
 public:
   ~StatisticInfo();
 
   void addStatistic(const Statistic *S) {
     Stats.push_back(S);
   }
+
+  void sortStatistics();
+};
+
+/// StatisticCounters - The counters of the statistics of one thread, by
+/// statistic ID, when statistics are thread-local. Chunks of counters are
+/// allocated as the thread first bumps a statistic in them and never move,
+/// so that other threads can read the counters while the thread runs. Only
+/// the owning thread writes them, so it needs no atomic read-modify-write.
+class StatisticCounters {
+  enum { ChunkSize = 256, NumChunks = 256 };
+  typedef std::atomic<unsigned> Counter;
+  std::atomic<Counter *> Chunks[NumChunks];
+public:
+  StatisticCounters() {
+    for (unsigned i = 0; i != NumChunks; ++i)
+      Chunks[i].store(0, std::memory_order_relaxed);
+  }
+  ~StatisticCounters() {
+    for (unsigned i = 0; i != NumChunks; ++i)
+      delete[] Chunks[i].load(std::memory_order_relaxed);
+  }
+
+  static unsigned getMaxStatistics() { return ChunkSize * NumChunks; }
+
+  /// add - Add \p Delta to the counter of the statistic \p ID and return its
+  /// previous value. Only the thread owning the counters may call this.
+  unsigned add(unsigned ID, unsigned Delta) {
+    Counter *Chunk = Chunks[ID / ChunkSize].load(std::memory_order_relaxed);
+    if (!Chunk) {
+      Chunk = new Counter[ChunkSize];
+      for (unsigned i = 0; i != ChunkSize; ++i)
+        Chunk[i].store(0, std::memory_order_relaxed);
+      Chunks[ID / ChunkSize].store(Chunk, std::memory_order_release);
+    }
+    Counter &C = Chunk[ID % ChunkSize];
+    unsigned OldValue = C.load(std::memory_order_relaxed);
+    C.store(OldValue + Delta, std::memory_order_relaxed);
+    return OldValue;
+  }
+
+  /// lookup - Return the counter of the statistic \p ID, which is zero if
+  /// the thread never bumped a statistic near it.
+  unsigned lookup(unsigned ID) const {
+    const Counter *Chunk =
+        Chunks[ID / ChunkSize].load(std::memory_order_acquire);
+    return Chunk ? Chunk[ID % ChunkSize].load(std::memory_order_relaxed) : 0;
+  }
+};
+
+/// ThreadCountersInfo - The counters of all the threads that bumped a
+/// thread-local statistic. The counters of a thread outlive it, so that its
+/// counts are kept; they are freed by llvm_shutdown.
+struct ThreadCountersInfo {
+  sys::ThreadLocal<const StatisticCounters> Current;
+  std::vector<StatisticCounters*> All;
+  unsigned NextID;
+
+  ThreadCountersInfo() : NextID(0) {}
+  ~ThreadCountersInfo() {
+    for (unsigned i = 0, e = All.size(); i != e; ++i)
+      delete All[i];
+  }
 };
 }
 
 static ManagedStatic<StatisticInfo> StatInfo;
 static ManagedStatic<sys::SmartMutex<true> > StatLock;
+static ManagedStatic<ThreadCountersInfo> ThreadCounters;
 
 /// RegisterStatistic - The first time a statistic is bumped, this method is
 /// called.
@@ -72,6 +161,12 @@ void Statistic::RegisterStatistic() {
   // printed.
   sys::SmartScopedLock<true> Writer(*StatLock);
   if (!Initialized) {
+    // Create ThreadCounters first, so that it is still alive when StatInfo
+    // prints the statistics on llvm_shutdown.
+    ID = ThreadCounters->NextID++;
+    if (ID >= StatisticCounters::getMaxStatistics())
+      report_fatal_error("too many statistics for -stats-thread-local");
+
     if (Enabled)
       StatInfo->addStatistic(this);
 
@@ -84,11 +179,61 @@ void Statistic::RegisterStatistic() {
   }
 }
 
+unsigned Statistic::addThreadLocal(unsigned Delta) {
+  init();
+  ThreadCountersInfo &Info = *ThreadCounters;
+  StatisticCounters *Counters =
+      const_cast<StatisticCounters*>(Info.Current.get());
+  if (!Counters) {
+    Counters = new StatisticCounters();
+    Info.Current.set(Counters);
+    sys::SmartScopedLock<true> Writer(*StatLock);
+    Info.All.push_back(Counters);
+  }
+  return Value + Counters->add(ID, Delta);
+}
+
+/// sumThreadLocalValues - Return the sum of the counters of statistic \p ID
+/// of all the threads. The caller holds StatLock.
+static unsigned sumThreadLocalValues(unsigned ID) {
+  ThreadCountersInfo &Info = *ThreadCounters;
+  unsigned Sum = 0;
+  for (unsigned i = 0, e = Info.All.size(); i != e; ++i)
+    Sum += Info.All[i]->lookup(ID);
+  return Sum;
+}
+
+unsigned Statistic::getMergedValue() const {
+  if (!Initialized)
+    return Value;
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  return Value + sumThreadLocalValues(ID);
+}
+
+void Statistic::setMergedValue(unsigned Val) {
+  init();
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  // The sums wrap around like the counters do.
+  Value = Val - sumThreadLocalValues(ID);
+}
+
 // Print information when destroyed, iff command line option is specified.
 StatisticInfo::~StatisticInfo() {
   llvm::PrintStatistics();
 }
 
+void StatisticInfo::sortStatistics() {
+  // Sort the fields by name.
+  std::stable_sort(Stats.begin(), Stats.end(),
+                   [](const Statistic *LHS, const Statistic *RHS) {
+    if (int Cmp = std::strcmp(LHS->getName(), RHS->getName()))
+      return Cmp < 0;
+
+    // Secondary key is the description.
+    return std::strcmp(LHS->getDesc(), RHS->getDesc()) < 0;
+  });
+}
+
 void llvm::EnableStatistics() {
   Enabled.setValue(true);
 }
@@ -109,15 +254,7 @@ void llvm::PrintStatistics(raw_ostream &OS) {
                           (unsigned)std::strlen(Stats.Stats[i]->getName()));
   }
 
-  // Sort the fields by name.
-  std::stable_sort(Stats.Stats.begin(), Stats.Stats.end(),
-                   [](const Statistic *LHS, const Statistic *RHS) {
-    if (int Cmp = std::strcmp(LHS->getName(), RHS->getName()))
-      return Cmp < 0;
-
-    // Secondary key is the description.
-    return std::strcmp(LHS->getDesc(), RHS->getDesc()) < 0;
-  });
+  Stats.sortStatistics();
 
   // Print out the statistics header...
   OS << "===" << std::string(73, '-') << "===\n"
@@ -136,6 +273,36 @@ void llvm::PrintStatistics(raw_ostream &OS) {
 
 }
 
+void llvm::PrintStatisticsJSON(raw_ostream &OS) {
+  StatisticInfo &Stats = *StatInfo;
+  Stats.sortStatistics();
+
+  OS << "{\n  \"statistics\": [";
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    OS << (i ? ",\n" : "\n") << "    { \"name\": ";
+    OS.write_json_string(Stats.Stats[i]->getName());
+    OS << ", \"description\": ";
+    OS.write_json_string(Stats.Stats[i]->getDesc());
+    OS << ", \"value\": " << Stats.Stats[i]->getValue() << " }";
+  }
+  OS << "\n  ]\n}\n";
+  OS.flush();
+}
+
+void llvm::PrintStatisticsCSV(raw_ostream &OS) {
+  StatisticInfo &Stats = *StatInfo;
+  Stats.sortStatistics();
+
+  OS << "name,description,value\n";
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    OS.write_csv_field(Stats.Stats[i]->getName());
+    OS << ',';
+    OS.write_csv_field(Stats.Stats[i]->getDesc());
+    OS << ',' << Stats.Stats[i]->getValue() << '\n';
+  }
+  OS.flush();
+}
+
 void llvm::PrintStatistics() {
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
   StatisticInfo &Stats = *StatInfo;
@@ -145,7 +312,11 @@ void llvm::PrintStatistics() {
 
   // Get the stream to write to.
   raw_ostream &OutStream = *CreateInfoOutputFile();
-  PrintStatistics(OutStream);
+  switch (Format) {
+  case StatsText: PrintStatistics(OutStream); break;
+  case StatsJSON: PrintStatisticsJSON(OutStream); break;
+  case StatsCSV:  PrintStatisticsCSV(OutStream); break;
+  }
   delete &OutStream;   // Close the file.
 #else
   // Check if the -stats option is set instead of checking
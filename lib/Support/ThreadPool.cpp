@@ -0,0 +1,191 @@
+//==-- llvm/Support/ThreadPool.cpp - A ThreadPool implementation -*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a crude C++11 based thread pool.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace llvm;
+
+#if LLVM_ENABLE_THREADS
+
+/// Returns the number of threads to use for a requested count of zero.
+static unsigned getDefaultThreadCount() {
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+ThreadPool::ThreadPool()
+    : ThreadCount(getDefaultThreadCount()), QueuedTasks(0),
+      OutstandingTasks(0), NextQueue(0), ShuttingDown(false) {
+  startThreads();
+}
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : ThreadCount(ThreadCount ? ThreadCount : getDefaultThreadCount()),
+      QueuedTasks(0), OutstandingTasks(0), NextQueue(0), ShuttingDown(false) {
+  startThreads();
+}
+
+void ThreadPool::startThreads() {
+  for (unsigned I = 0; I != ThreadCount; ++I)
+    Queues.emplace_back(new WorkerQueue());
+  Threads.reserve(ThreadCount);
+  for (unsigned I = 0; I != ThreadCount; ++I)
+    Threads.emplace_back([this, I] { work(I); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    ShuttingDown = true;
+  }
+  WorkAvailable.notify_all();
+  for (std::thread &Worker : Threads)
+    Worker.join();
+}
+
+unsigned ThreadPool::getCurrentWorker() const {
+  std::thread::id Self = std::this_thread::get_id();
+  for (unsigned I = 0, E = Threads.size(); I != E; ++I)
+    if (Threads[I].get_id() == Self)
+      return I;
+  return ThreadCount;
+}
+
+bool ThreadPool::popTask(unsigned Index, PackagedTaskTy &Task) {
+  // Our own queue is used as a stack, so that a task submitted by the task
+  // that just ran is picked up first.
+  {
+    WorkerQueue &Own = *Queues[Index];
+    std::unique_lock<std::mutex> LockGuard(Own.Lock);
+    if (!Own.Tasks.empty()) {
+      Task = std::move(Own.Tasks.back());
+      Own.Tasks.pop_back();
+      return true;
+    }
+  }
+
+  // Steal the oldest task of another worker.
+  for (unsigned I = 1; I != ThreadCount; ++I) {
+    WorkerQueue &Victim = *Queues[(Index + I) % ThreadCount];
+    std::unique_lock<std::mutex> LockGuard(Victim.Lock);
+    if (!Victim.Tasks.empty()) {
+      Task = std::move(Victim.Tasks.front());
+      Victim.Tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::work(unsigned Index) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> LockGuard(StateLock);
+      WorkAvailable.wait(LockGuard,
+                         [&] { return ShuttingDown || QueuedTasks != 0; });
+      // Only exit once all the queued work has been done.
+      if (QueuedTasks == 0)
+        return;
+      // Claim one of the queued tasks, which guarantees that popTask finds
+      // one below.
+      --QueuedTasks;
+    }
+
+    runClaimedTask(Index);
+  }
+}
+
+void ThreadPool::runClaimedTask(unsigned Index) {
+  PackagedTaskTy Task;
+  while (!popTask(Index, Task))
+    std::this_thread::yield();
+  Task();
+
+  std::unique_lock<std::mutex> LockGuard(StateLock);
+  if (--OutstandingTasks == 0)
+    AllDone.notify_all();
+}
+
+bool ThreadPool::runPendingTask() {
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    if (QueuedTasks == 0)
+      return false;
+    --QueuedTasks;
+  }
+
+  // A thread from outside the pool searches all the queues in order.
+  unsigned Index = getCurrentWorker();
+  runClaimedTask(Index == ThreadCount ? 0 : Index);
+  return true;
+}
+
+void ThreadPool::wait() {
+  assert(getCurrentWorker() == ThreadCount &&
+         "Waiting on the pool from one of its tasks would deadlock");
+  std::unique_lock<std::mutex> LockGuard(StateLock);
+  AllDone.wait(LockGuard, [&] { return OutstandingTasks == 0; });
+}
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  PackagedTaskTy PackagedTask(std::move(Task));
+  std::shared_future<void> Future = PackagedTask.get_future().share();
+
+  unsigned Index = getCurrentWorker();
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    assert(!ShuttingDown && "Queuing a task on a pool being destroyed");
+    ++OutstandingTasks;
+    if (Index == ThreadCount) {
+      Index = NextQueue;
+      NextQueue = (NextQueue + 1) % ThreadCount;
+    }
+  }
+
+  {
+    WorkerQueue &Queue = *Queues[Index];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    Queue.Tasks.push_back(std::move(PackagedTask));
+  }
+
+  // Only announce the task once it can be popped.
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    ++QueuedTasks;
+  }
+  WorkAvailable.notify_one();
+  return Future;
+}
+
+#else // LLVM_ENABLE_THREADS Disabled
+
+ThreadPool::ThreadPool() : ThreadCount(1) {}
+
+ThreadPool::ThreadPool(unsigned ThreadCount) : ThreadCount(1) {}
+
+ThreadPool::~ThreadPool() {}
+
+void ThreadPool::wait() {}
+
+bool ThreadPool::runPendingTask() { return false; }
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  // Without threads every task runs right away, in submission order.
+  PackagedTaskTy PackagedTask(std::move(Task));
+  std::shared_future<void> Future = PackagedTask.get_future().share();
+  PackagedTask();
+  return Future;
+}
+
+#endif
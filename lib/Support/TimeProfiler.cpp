@@ -0,0 +1,169 @@
+//===-- TimeProfiler.cpp - Compile time trace -----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the compile time tracer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+typedef std::chrono::steady_clock ClockTy;
+
+namespace {
+/// TraceEntry - An event, in microseconds since the profiler started.
+struct TraceEntry {
+  uint64_t Start;
+  uint64_t Duration;
+  unsigned Tid;
+  std::string Name;
+  std::string Detail;
+};
+
+/// ThreadEvents - The events a thread began and did not end yet.
+struct ThreadEvents {
+  unsigned Tid;
+  std::vector<TraceEntry> Stack;
+};
+}
+
+namespace llvm {
+class TimeTraceProfiler {
+  const ClockTy::time_point StartTime;
+  const unsigned Granularity;
+
+  sys::ThreadLocal<const ThreadEvents> CurrentThread;
+
+  /// Lock - Guards the members below, which threads only touch when they
+  /// first record an event and when an event ends.
+  sys::Mutex Lock;
+  std::vector<ThreadEvents*> Threads;
+  std::vector<TraceEntry> Entries;
+
+  uint64_t now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               ClockTy::now() - StartTime).count();
+  }
+
+  ThreadEvents &getThreadEvents() {
+    ThreadEvents *Events = const_cast<ThreadEvents*>(CurrentThread.get());
+    if (!Events) {
+      Events = new ThreadEvents();
+      sys::ScopedLock Guard(Lock);
+      Events->Tid = Threads.size();
+      Threads.push_back(Events);
+      CurrentThread.set(Events);
+    }
+    return *Events;
+  }
+
+public:
+  explicit TimeTraceProfiler(unsigned Granularity)
+    : StartTime(ClockTy::now()), Granularity(Granularity) {}
+
+  ~TimeTraceProfiler() {
+    for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+      delete Threads[i];
+  }
+
+  void begin(StringRef Name, StringRef Detail) {
+    ThreadEvents &Events = getThreadEvents();
+    Events.Stack.push_back(TraceEntry());
+    TraceEntry &E = Events.Stack.back();
+    E.Start = now();
+    E.Tid = Events.Tid;
+    E.Name = Name;
+    E.Detail = Detail;
+  }
+
+  void end() {
+    ThreadEvents &Events = getThreadEvents();
+    assert(!Events.Stack.empty() && "Ending an event that never began");
+    TraceEntry &E = Events.Stack.back();
+    E.Duration = now() - E.Start;
+    if (E.Duration >= Granularity) {
+      sys::ScopedLock Guard(Lock);
+      Entries.push_back(TraceEntry());
+      std::swap(Entries.back(), E);
+    }
+    Events.Stack.pop_back();
+  }
+
+  void write(raw_ostream &OS, StringRef ProcessName);
+};
+}
+
+TimeTraceProfiler *llvm::TimeTraceProfilerInstance = 0;
+
+void llvm::timeTraceProfilerInitialize(unsigned Granularity) {
+  assert(!TimeTraceProfilerInstance && "Profiler already initialized");
+  TimeTraceProfilerInstance = new TimeTraceProfiler(Granularity);
+}
+
+void llvm::timeTraceProfilerCleanup() {
+  delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = 0;
+}
+
+void llvm::timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
+  if (TimeTraceProfilerInstance)
+    TimeTraceProfilerInstance->begin(Name, Detail);
+}
+
+void llvm::timeTraceProfilerEnd() {
+  if (TimeTraceProfilerInstance)
+    TimeTraceProfilerInstance->end();
+}
+
+void llvm::timeTraceProfilerWrite(raw_ostream &OS, StringRef ProcessName) {
+  assert(TimeTraceProfilerInstance && "Profiler not initialized");
+  TimeTraceProfilerInstance->write(OS, ProcessName);
+}
+
+bool llvm::timeTraceProfilerWrite(StringRef Path, StringRef ProcessName,
+                                  std::string &ErrorInfo) {
+  tool_output_file Out(Path.str().c_str(), ErrorInfo, sys::fs::F_Text);
+  if (!ErrorInfo.empty())
+    return false;
+  timeTraceProfilerWrite(Out.os(), ProcessName);
+  Out.keep();
+  return true;
+}
+
+void TimeTraceProfiler::write(raw_ostream &OS, StringRef ProcessName) {
+  sys::ScopedLock Guard(Lock);
+
+  // Complete events ("ph": "X") of the same thread nest by their times.
+  OS << "{\"traceEvents\":[\n";
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i) {
+    const TraceEntry &E = Entries[i];
+    OS << "{\"pid\":1,\"tid\":" << E.Tid << ",\"ph\":\"X\",\"ts\":" << E.Start
+       << ",\"dur\":" << E.Duration << ",\"name\":";
+    OS.write_json_string(E.Name);
+    if (!E.Detail.empty()) {
+      OS << ",\"args\":{\"detail\":";
+      OS.write_json_string(E.Detail);
+      OS << '}';
+    }
+    OS << "},\n";
+  }
+  OS << "{\"pid\":1,\"tid\":0,\"ph\":\"M\",\"name\":\"process_name\","
+     << "\"args\":{\"name\":";
+  OS.write_json_string(ProcessName);
+  OS << "}}\n]}\n";
+  OS.flush();
+}
@@ -50,6 +50,17 @@ namespace {
   InfoOutputFilename("info-output-file", cl::value_desc("filename"),
                      cl::desc("File to append -stats and -timer output to"),
                    cl::Hidden, cl::location(getLibSupportInfoOutputFilename()));
+
+  enum TimerFormat { TimerText, TimerJSON, TimerCSV };
+
+  static cl::opt<TimerFormat>
+  Format("timer-format", cl::desc("Format of the -time-passes and other "
+                                  "timer reports"),
+         cl::init(TimerText),
+         cl::values(clEnumValN(TimerText, "text", "Human readable table"),
+                    clEnumValN(TimerJSON, "json", "JSON object"),
+                    clEnumValN(TimerCSV, "csv", "Comma separated values"),
+                    clEnumValEnd));
 }
 
 // CreateInfoOutputFile - Return a file stream to print our output on.
@@ -103,6 +114,7 @@ void Timer::init(StringRef N) {
   assert(TG == 0 && "Timer already initialized");
   Name.assign(N.begin(), N.end());
   Started = false;
+  Running = false;
   TG = getDefaultTimerGroup();
   TG->addTimer(*this);
 }
@@ -111,6 +123,7 @@ void Timer::init(StringRef N, TimerGroup &tg) {
   assert(TG == 0 && "Timer already initialized");
   Name.assign(N.begin(), N.end());
   Started = false;
+  Running = false;
   TG = &tg;
   TG->addTimer(*this);
 }
@@ -143,25 +156,20 @@ TimeRecord TimeRecord::getCurrentTime(bool Start) {
   return Result;
 }
 
-static ManagedStatic<std::vector<Timer*> > ActiveTimers;
+// A timer only touches its own state when started and stopped, so threads
+// running timers of their own, like the pass timers of their pass managers,
+// don't contend.
 
 void Timer::startTimer() {
-  Started = true;
-  ActiveTimers->push_back(this);
+  assert(!Running && "Cannot start a running timer");
+  Started = Running = true;
   Time -= TimeRecord::getCurrentTime(true);
 }
 
 void Timer::stopTimer() {
+  assert(Running && "stop but no startTimer?");
   Time += TimeRecord::getCurrentTime(false);
-
-  if (ActiveTimers->back() == this) {
-    ActiveTimers->pop_back();
-  } else {
-    std::vector<Timer*>::iterator I =
-      std::find(ActiveTimers->begin(), ActiveTimers->end(), this);
-    assert(I != ActiveTimers->end() && "stop but no startTimer?");
-    ActiveTimers->erase(I);
-  }
+  Running = false;
 }
 
 static void printVal(double Val, double Total, raw_ostream &OS) {
@@ -235,11 +243,12 @@ static Timer &getNamedRegionTimer(StringRef Name) {
 
 NamedRegionTimer::NamedRegionTimer(StringRef Name,
                                    bool Enabled)
-  : TimeRegion(!Enabled ? 0 : &getNamedRegionTimer(Name)) {}
+  : TimeRegion(!Enabled ? 0 : &getNamedRegionTimer(Name)), Trace(Name) {}
 
 NamedRegionTimer::NamedRegionTimer(StringRef Name, StringRef GroupName,
                                    bool Enabled)
-  : TimeRegion(!Enabled ? 0 : &NamedGroupedTimers->get(Name, GroupName)) {}
+  : TimeRegion(!Enabled ? 0 : &NamedGroupedTimers->get(Name, GroupName)),
+    Trace(Name) {}
 
 //===----------------------------------------------------------------------===//
 //   TimerGroup Implementation
@@ -249,11 +258,42 @@ NamedRegionTimer::NamedRegionTimer(StringRef Name, StringRef GroupName,
 /// TimerGroup ctor/dtor and is protected by the TimerLock lock.
 static TimerGroup *TimerGroupList = 0;
 
+/// printJSONReport - Print the JSON objects of timer groups, separated by
+/// commas, as a single JSON document.
+static void printJSONReport(raw_ostream &OS, StringRef Groups) {
+  OS << "{\n  \"timer_groups\": [\n" << Groups << "\n  ]\n}\n";
+  OS.flush();
+}
+
+namespace llvm {
+/// TimerJSONReport - The JSON objects of the groups whose report goes to the
+/// info output file, printed as one document when LLVM shuts down.
+struct TimerJSONReport {
+  std::string Groups;
+
+  ~TimerJSONReport() {
+    // The groups still alive, like those owned by managed statics created
+    // before this one, go into the same document.
+    sys::SmartScopedLock<true> L(*TimerLock);
+    TimerGroup::addStartedJSONGroups(Groups);
+    if (Groups.empty())
+      return;
+    raw_ostream *OutStream = CreateInfoOutputFile();
+    printJSONReport(*OutStream, Groups);
+    delete OutStream;
+  }
+};
+}
+
+static ManagedStatic<TimerJSONReport> TheJSONReport;
+
 TimerGroup::TimerGroup(StringRef name)
   : Name(name.begin(), name.end()), FirstTimer(0) {
     
   // Add the group to TimerGroupList.
   sys::SmartScopedLock<true> L(*TimerLock);
+  if (Format == TimerJSON)
+    (void)*TheJSONReport;
   if (TimerGroupList)
     TimerGroupList->Prev = &Next;
   Next = TimerGroupList;
@@ -293,6 +333,9 @@ void TimerGroup::removeTimer(Timer &T) {
   // them were started.
   if (FirstTimer != 0 || TimersToPrint.empty())
     return;
+
+  if (Format == TimerJSON)
+    return addJSONGroup(TheJSONReport->Groups);
   
   raw_ostream *OutStream = CreateInfoOutputFile();
   PrintQueuedTimers(*OutStream);
@@ -313,6 +356,11 @@ void TimerGroup::addTimer(Timer &T) {
 void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
   // Sort the timers in descending order by amount of time taken.
   std::sort(TimersToPrint.begin(), TimersToPrint.end());
+
+  if (Format == TimerJSON)
+    return PrintQueuedTimersJSON(OS);
+  if (Format == TimerCSV)
+    return PrintQueuedTimersCSV(OS);
   
   TimeRecord Total;
   for (unsigned i = 0, e = TimersToPrint.size(); i != e; ++i)
@@ -359,12 +407,74 @@ void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
   TimersToPrint.clear();
 }
 
-/// print - Print any started timers in this group and zero them.
-void TimerGroup::print(raw_ostream &OS) {
-  sys::SmartScopedLock<true> L(*TimerLock);
+/// writeJSONTimes - Write the members of a JSON object holding the times of
+/// \p Time.
+static void writeJSONTimes(raw_ostream &OS, const TimeRecord &Time) {
+  OS << format("\"user\": %.6f, \"system\": %.6f, \"wall\": %.6f",
+               Time.getUserTime(), Time.getSystemTime(), Time.getWallTime())
+     << ", \"mem\": " << (int64_t)Time.getMemUsed();
+}
+
+void TimerGroup::PrintQueuedTimersJSON(raw_ostream &OS) {
+  TimeRecord Total;
+  for (unsigned i = 0, e = TimersToPrint.size(); i != e; ++i)
+    Total += TimersToPrint[i].first;
+
+  OS << "    {\n      \"group\": ";
+  OS.write_json_string(Name);
+  OS << ",\n      \"total\": { ";
+  writeJSONTimes(OS, Total);
+  OS << " },\n      \"timers\": [";
+  for (unsigned i = 0, e = TimersToPrint.size(); i != e; ++i) {
+    const std::pair<TimeRecord, std::string> &Entry = TimersToPrint[e-i-1];
+    OS << (i ? ",\n" : "\n") << "        { \"name\": ";
+    OS.write_json_string(Entry.second);
+    OS << ", ";
+    writeJSONTimes(OS, Entry.first);
+    OS << " }";
+  }
+  OS << "\n      ]\n    }";
+  OS.flush();
+
+  TimersToPrint.clear();
+}
+
+void TimerGroup::PrintQueuedTimersCSV(raw_ostream &OS) {
+  OS << "group,name,user,system,wall,mem\n";
+  for (unsigned i = 0, e = TimersToPrint.size(); i != e; ++i) {
+    const std::pair<TimeRecord, std::string> &Entry = TimersToPrint[e-i-1];
+    OS.write_csv_field(Name);
+    OS << ',';
+    OS.write_csv_field(Entry.second);
+    OS << format(",%.6f,%.6f,%.6f,", Entry.first.getUserTime(),
+                 Entry.first.getSystemTime(), Entry.first.getWallTime())
+       << (int64_t)Entry.first.getMemUsed() << '\n';
+  }
+  OS.flush();
+
+  TimersToPrint.clear();
+}
+
+/// addJSONGroup - Append the JSON object of the queued timers to \p Groups,
+/// after a comma if needed.
+void TimerGroup::addJSONGroup(std::string &Groups) {
+  if (!Groups.empty())
+    Groups += ",\n";
+  raw_string_ostream OS(Groups);
+  PrintQueuedTimers(OS);
+}
+
+/// addStartedJSONGroups - Append the JSON objects of the groups with started
+/// timers to \p Groups and zero the timers.
+void TimerGroup::addStartedJSONGroups(std::string &Groups) {
+  for (TimerGroup *TG = TimerGroupList; TG; TG = TG->Next)
+    if (TG->queueStartedTimers())
+      TG->addJSONGroup(Groups);
+}
 
-  // See if any of our timers were started, if so add them to TimersToPrint and
-  // reset them.
+/// queueStartedTimers - Queue the started timers of this group for printing
+/// and zero them.  Returns false if none was started.
+bool TimerGroup::queueStartedTimers() {
   for (Timer *T = FirstTimer; T; T = T->Next) {
     if (!T->Started) continue;
     TimersToPrint.push_back(std::make_pair(T->Time, T->Name));
@@ -373,16 +483,36 @@ void TimerGroup::print(raw_ostream &OS) {
     T->Started = 0;
     T->Time = TimeRecord();
   }
+  return !TimersToPrint.empty();
+}
+
+/// print - Print any started timers in this group and zero them.
+void TimerGroup::print(raw_ostream &OS) {
+  sys::SmartScopedLock<true> L(*TimerLock);
 
   // If any timers were started, print the group.
-  if (!TimersToPrint.empty())
-    PrintQueuedTimers(OS);
+  if (!queueStartedTimers())
+    return;
+  if (Format != TimerJSON)
+    return PrintQueuedTimers(OS);
+  std::string Group;
+  addJSONGroup(Group);
+  printJSONReport(OS, Group);
 }
 
 /// printAll - This static method prints all timers and clears them all out.
 void TimerGroup::printAll(raw_ostream &OS) {
   sys::SmartScopedLock<true> L(*TimerLock);
 
-  for (TimerGroup *TG = TimerGroupList; TG; TG = TG->Next)
-    TG->print(OS);
+  if (Format != TimerJSON) {
+    for (TimerGroup *TG = TimerGroupList; TG; TG = TG->Next)
+      TG->print(OS);
+    return;
+  }
+
+  // The groups go into a single JSON document.
+  std::string Groups;
+  addStartedJSONGroups(Groups);
+  if (!Groups.empty())
+    printJSONReport(OS, Groups);
 }
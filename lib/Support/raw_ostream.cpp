@@ -216,6 +216,32 @@ raw_ostream &raw_ostream::write_escaped(StringRef Str,
   return *this;
 }
 
+raw_ostream &raw_ostream::write_json_string(StringRef Str) {
+  *this << '"';
+  for (unsigned i = 0, e = Str.size(); i != e; ++i) {
+    unsigned char c = Str[i];
+    if (c == '"' || c == '\\')
+      *this << '\\' << c;
+    else if (c < 0x20)
+      *this << "\\u00" << hexdigit(c >> 4, true) << hexdigit(c & 0xF, true);
+    else
+      *this << c;
+  }
+  return *this << '"';
+}
+
+raw_ostream &raw_ostream::write_csv_field(StringRef Str) {
+  if (Str.find_first_of(",\"\r\n") == StringRef::npos)
+    return *this << Str;
+  *this << '"';
+  for (unsigned i = 0, e = Str.size(); i != e; ++i) {
+    if (Str[i] == '"')
+      *this << '"';
+    *this << Str[i];
+  }
+  return *this << '"';
+}
+
 raw_ostream &raw_ostream::operator<<(const void *P) {
   *this << '0' << 'x';
 
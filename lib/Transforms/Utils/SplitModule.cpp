@@ -0,0 +1,314 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "split-module"
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+using namespace llvm;
+
+typedef EquivalenceClasses<const GlobalValue *> ClusterMapType;
+
+/// Collects the global values whose definitions contain a use of V, looking
+/// through constant expressions, block addresses and other constants.
+static void findUsingGlobals(const Value *V,
+                             SmallVectorImpl<const GlobalValue *> &Owners,
+                             SmallPtrSet<const Value *, 8> &Visited) {
+  for (const User *U : V->users()) {
+    if (const Instruction *I = dyn_cast<Instruction>(U))
+      Owners.push_back(I->getParent()->getParent());
+    else if (const GlobalValue *GV = dyn_cast<GlobalValue>(U))
+      Owners.push_back(GV);
+    else if (isa<Constant>(U) && Visited.insert(U))
+      findUsingGlobals(U, Owners, Visited);
+  }
+}
+
+static void findUsingGlobals(const Value *V,
+                             SmallVectorImpl<const GlobalValue *> &Owners) {
+  SmallPtrSet<const Value *, 8> Visited;
+  findUsingGlobals(V, Owners, Visited);
+}
+
+/// Returns true if GV lives in a global that is referenced by name from
+/// outside the IR, which the partitioning must not rename.
+static bool isUsedGlobal(const GlobalVariable &GV) {
+  return GV.getName() == "llvm.used" || GV.getName() == "llvm.compiler.used";
+}
+
+/// Groups the global values of M that must be placed in the same partition.
+static void findClusters(Module &M, ClusterMapType &GVtoClusterMap) {
+  // Keep functions in the same call graph SCC together, so that the calls
+  // between them remain local to the partition.
+  CallGraph CG(M);
+  for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I) {
+    const Function *Leader = nullptr;
+    for (CallGraphNode *Node : *I) {
+      const Function *F = Node->getFunction();
+      if (!F || F->isDeclaration())
+        continue;
+      GVtoClusterMap.insert(F);
+      if (Leader)
+        GVtoClusterMap.unionSets(Leader, F);
+      else
+        Leader = F;
+    }
+  }
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (!I->isDeclaration())
+      GVtoClusterMap.insert(I);
+
+  // An alias must be defined in the same partition as the global it aliases.
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I) {
+    GVtoClusterMap.insert(I);
+    if (const GlobalValue *Aliasee = I->getAliasedGlobal())
+      if (!Aliasee->isDeclaration())
+        GVtoClusterMap.unionSets(I, Aliasee);
+  }
+
+  // Keep local variables with the globals that use them, so that most of them
+  // stay internal. A block address is only meaningful in the module that
+  // defines its function, so its users are clustered with the function too.
+  SmallVector<const GlobalValue *, 8> Owners;
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    if (!I->hasLocalLinkage() || I->isDeclaration())
+      continue;
+    Owners.clear();
+    findUsingGlobals(I, Owners);
+    for (const GlobalValue *Owner : Owners)
+      if (!isa<GlobalVariable>(Owner) ||
+          !cast<GlobalVariable>(Owner)->hasAppendingLinkage())
+        GVtoClusterMap.unionSets(I, Owner);
+  }
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (!I->hasAddressTaken())
+      continue;
+    for (const User *U : I->users()) {
+      if (!isa<BlockAddress>(U))
+        continue;
+      Owners.clear();
+      findUsingGlobals(U, Owners);
+      for (const GlobalValue *Owner : Owners)
+        GVtoClusterMap.unionSets(I, Owner);
+    }
+  }
+}
+
+/// Returns a rough estimate of the cost of generating code for GV.
+static unsigned getCost(const GlobalValue *GV) {
+  const Function *F = dyn_cast<Function>(GV);
+  if (!F)
+    return 1;
+  unsigned Cost = 1;
+  for (Function::const_iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    Cost += BB->size();
+  return Cost;
+}
+
+/// Gives a local global value that is referenced from another partition a
+/// name that can be resolved at link time without exporting it from the
+/// final image.
+static void externalize(GlobalValue *GV) {
+  GV->setName(GV->getName() + ".llvm.split");
+  GV->setLinkage(GlobalValue::ExternalLinkage);
+  GV->setVisibility(GlobalValue::HiddenVisibility);
+}
+
+/// Turns the clone of a global that is defined in another partition into a
+/// declaration, and returns the declaration.
+static GlobalValue *makeDeclaration(GlobalValue *GV, Module &MPart) {
+  if (Function *F = dyn_cast<Function>(GV)) {
+    F->deleteBody();
+    return F;
+  }
+  if (GlobalVariable *Var = dyn_cast<GlobalVariable>(GV)) {
+    Var->setInitializer(nullptr);
+    Var->setLinkage(GlobalValue::ExternalLinkage);
+    return Var;
+  }
+
+  // An alias cannot be a declaration, so it is replaced by a declaration of a
+  // function or variable with the same name.
+  GlobalAlias *GA = cast<GlobalAlias>(GV);
+  PointerType *PTy = GA->getType();
+  GlobalValue *Decl;
+  if (FunctionType *FTy = dyn_cast<FunctionType>(PTy->getElementType()))
+    Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &MPart);
+  else
+    Decl = new GlobalVariable(MPart, PTy->getElementType(), false,
+                              GlobalValue::ExternalLinkage, nullptr, "",
+                              nullptr, GlobalVariable::NotThreadLocal,
+                              PTy->getAddressSpace());
+  Decl->takeName(GA);
+  Decl->setVisibility(GA->getVisibility());
+  GA->replaceAllUsesWith(Decl);
+  GA->eraseFromParent();
+  return Decl;
+}
+
+void llvm::SplitModule(Module &M, unsigned N,
+                       std::vector<std::unique_ptr<Module>> &Partitions) {
+  assert(N != 0 && "Cannot split a module into zero partitions");
+
+  // Visit the definitions in module order, so that the partitioning does not
+  // depend on the addresses of the values.
+  std::vector<GlobalValue *> Definitions;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      Definitions.push_back(I);
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (!I->isDeclaration())
+      Definitions.push_back(I);
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I)
+    Definitions.push_back(I);
+
+  ClusterMapType GVtoClusterMap;
+  findClusters(M, GVtoClusterMap);
+
+  // Number the clusters in order of their first member.
+  struct Cluster {
+    unsigned Cost;
+    bool Pinned;
+    unsigned Partition;
+  };
+  std::vector<Cluster> Clusters;
+  DenseMap<const GlobalValue *, unsigned> LeaderToCluster;
+  std::vector<unsigned> ClusterOf;
+  for (GlobalValue *GV : Definitions) {
+    const GlobalValue *Leader = GVtoClusterMap.getLeaderValue(GV);
+    std::pair<DenseMap<const GlobalValue *, unsigned>::iterator, bool> Ins =
+        LeaderToCluster.insert(std::make_pair(Leader, Clusters.size()));
+    if (Ins.second) {
+      Cluster C = { 0, false, 0 };
+      Clusters.push_back(C);
+    }
+    unsigned Idx = Ins.first->second;
+    ClusterOf.push_back(Idx);
+    Clusters[Idx].Cost += getCost(GV);
+  }
+
+  // Appending globals are concatenated by the linker, so they only need to be
+  // defined once. The values in llvm.used may be referenced by name from
+  // inline asm, so they are kept in the same partition and never renamed.
+  for (unsigned I = 0, E = Definitions.size(); I != E; ++I) {
+    GlobalVariable *Var = dyn_cast<GlobalVariable>(Definitions[I]);
+    if (!Var || !Var->hasAppendingLinkage())
+      continue;
+    Clusters[ClusterOf[I]].Pinned = true;
+    if (!isUsedGlobal(*Var))
+      continue;
+    for (const Use &Op : Var->getInitializer()->operands()) {
+      const Value *V = Op.get()->stripPointerCasts();
+      if (const GlobalValue *GV = dyn_cast<GlobalValue>(V))
+        if (GVtoClusterMap.findValue(GV) != GVtoClusterMap.end())
+          Clusters[LeaderToCluster[GVtoClusterMap.getLeaderValue(GV)]].Pinned =
+              true;
+    }
+  }
+
+  // Assign the clusters to partitions greedily, the most expensive first,
+  // each to the partition with the lowest total cost so far.
+  std::vector<unsigned> Order;
+  for (unsigned I = 0, E = Clusters.size(); I != E; ++I)
+    Order.push_back(I);
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+    return Clusters[A].Cost > Clusters[B].Cost;
+  });
+  std::vector<uint64_t> Load(N, 0);
+  for (unsigned Idx : Order) {
+    Cluster &C = Clusters[Idx];
+    if (!C.Pinned)
+      C.Partition =
+          std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Load[C.Partition] += C.Cost;
+  }
+
+  DenseMap<const GlobalValue *, unsigned> PartitionOf;
+  for (unsigned I = 0, E = Definitions.size(); I != E; ++I)
+    PartitionOf[Definitions[I]] = Clusters[ClusterOf[I]].Partition;
+
+  DEBUG(for (unsigned I = 0; I != N; ++I)
+          dbgs() << "Partition " << I << ": cost " << Load[I] << "\n");
+
+  // Give the local values that are used from another partition a name that
+  // each partition can refer to.
+  SmallVector<const GlobalValue *, 8> Owners;
+  for (GlobalValue *GV : Definitions) {
+    if (!GV->hasLocalLinkage())
+      continue;
+    unsigned Partition = PartitionOf[GV];
+    Owners.clear();
+    findUsingGlobals(GV, Owners);
+    for (const GlobalValue *Owner : Owners) {
+      if (PartitionOf.lookup(Owner) != Partition) {
+        externalize(GV);
+        break;
+      }
+    }
+  }
+
+  for (unsigned I = 0; I != N; ++I) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPart(CloneModule(&M, VMap));
+    if (I != 0)
+      MPart->setModuleInlineAsm("");
+
+    // Local values that were not externalized are only used from their own
+    // partition, so their declarations end up unused and can be dropped.
+    std::vector<GlobalValue *> LocalDecls;
+    for (GlobalValue *GV : Definitions) {
+      if (PartitionOf[GV] == I)
+        continue;
+      GlobalValue *NewGV = cast<GlobalValue>(VMap[GV]);
+      GlobalVariable *Var = dyn_cast<GlobalVariable>(NewGV);
+      if (Var && Var->hasAppendingLinkage()) {
+        Var->eraseFromParent();
+        continue;
+      }
+      GlobalValue *Decl = makeDeclaration(NewGV, *MPart);
+      if (GV->hasLocalLinkage())
+        LocalDecls.push_back(Decl);
+    }
+    for (GlobalValue *Decl : LocalDecls) {
+      Decl->removeDeadConstantUsers();
+      if (Decl->use_empty())
+        Decl->eraseFromParent();
+    }
+
+    Partitions.push_back(std::move(MPart));
+  }
+}
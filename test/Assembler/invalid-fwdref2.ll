@@ -0,0 +1,12 @@
+; RUN: not llvm-as %s -disable-output 2>&1 | FileCheck %s
+; The undefined value with the smallest name is reported, whatever the order
+; of the uses.
+
+; CHECK: use of undefined value '%alpha'
+
+define i32 @test(i32 %x) {
+  %a = add i32 %x, %zeta
+  %b = add i32 %a, %alpha
+  %c = add i32 %b, %mu
+  ret i32 %c
+}
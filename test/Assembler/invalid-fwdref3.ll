@@ -0,0 +1,12 @@
+; RUN: not llvm-as %s -disable-output 2>&1 | FileCheck %s
+; The undefined value with the smallest number is reported, whatever the order
+; of the uses.
+
+; CHECK: use of undefined value '%6'
+
+define i32 @test(i32) {
+  %2 = add i32 %0, %9
+  %3 = add i32 %2, %7
+  %4 = add i32 %3, %6
+  ret i32 %4
+}
@@ -0,0 +1,8 @@
+; RUN: llvm-as -print-parse-rate -disable-output %s 2>&1 | FileCheck %s
+
+; CHECK: parsed {{[0-9]+}} bytes in {{[0-9.]+}} s ({{[0-9.]+}} MB/s)
+
+define i32 @test(i32 %x) {
+  %"escaped\41name" = add i32 %x, 1
+  ret i32 %"escaped\41name"
+}
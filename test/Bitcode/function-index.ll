@@ -0,0 +1,49 @@
+; Check that function bodies are indexed, and that they can be found through
+; the index both with and without a bitcode wrapper header.
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s
+; RUN: llvm-as < %s | llvm-extract -func=c | llvm-dis | FileCheck %s -check-prefix=EXTRACT
+; RUN: opt -mtriple=x86_64-apple-darwin < %s | llvm-dis | FileCheck %s
+; RUN: opt -mtriple=x86_64-apple-darwin < %s | llvm-extract -func=c | llvm-dis | FileCheck %s -check-prefix=EXTRACT
+
+; BC: <MODULE_BLOCK
+; BC: <FNINDEXOFFSET
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_INDEX_BLOCK
+; BC-NEXT: <ENTRY
+; BC-NEXT: <ENTRY
+; BC-NEXT: <ENTRY
+; BC-NEXT: </FUNCTION_INDEX_BLOCK>
+; BC-NEXT: </MODULE_BLOCK>
+
+declare void @ext()
+
+; CHECK: define i32 @a(i32 %x)
+; CHECK-NEXT: add i32 %x, 1
+define i32 @a(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; CHECK: define i32 @b(i32 %x)
+; CHECK-NEXT: call i32 @a(i32 %x)
+define i32 @b(i32 %x) {
+  %y = call i32 @a(i32 %x)
+  ret i32 %y
+}
+
+; CHECK: define i32 @c(i32 %x)
+; CHECK-NEXT: call void @ext()
+; CHECK-NEXT: mul i32 %x, %x
+; EXTRACT-NOT: define i32 @a
+; EXTRACT-NOT: define i32 @b
+; EXTRACT: define i32 @c(i32 %x)
+; EXTRACT-NEXT: call void @ext()
+; EXTRACT-NEXT: mul i32 %x, %x
+define i32 @c(i32 %x) {
+  call void @ext()
+  %y = mul i32 %x, %x
+  ret i32 %y
+}
@@ -0,0 +1,69 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -j 2 %s -o %t
+; RUN: FileCheck --check-prefix=P0 %s < %t.0
+; RUN: FileCheck --check-prefix=P1 %s < %t.1
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -j 2 %s -o %t2
+; RUN: cmp %t.0 %t2.0
+; RUN: cmp %t.1 %t2.1
+; RUN: not llc -mtriple=x86_64-unknown-linux-gnu -j 2 %s -o - 2>&1 \
+; RUN:   | FileCheck --check-prefix=STDOUT %s
+
+; The most expensive function goes to the first partition, the rest of the
+; module to the second. Locals that are referenced across partitions become
+; hidden, and appending globals and aliases stay with their definitions.
+
+; STDOUT: -j cannot write to standard output
+
+@llvm.global_ctors = appending global [1 x { i32, void ()* }] [{ i32, void ()* } { i32 65535, void ()* @ctor }]
+@g = global i32 5
+@str = private unnamed_addr constant [4 x i8] c"abc\00"
+@counter = internal global i32 0
+
+@alias = alias i32 (i32)* @big
+
+; P0-NOT: {{^}}ctor.llvm.split:
+; P0-NOT: {{^}}helper.llvm.split:
+; P0-NOT: {{^}}small:
+; P0: {{^}}big:
+; P0: callq helper.llvm.split
+; P0: .quad ctor.llvm.split
+; P0: {{^}}g:
+; P0: .hidden helper.llvm.split
+; P0: alias = big
+
+; P1-NOT: {{^}}big:
+; P1-NOT: .init_array
+; P1: .hidden ctor.llvm.split
+; P1: {{^}}ctor.llvm.split:
+; P1: .hidden helper.llvm.split
+; P1: {{^}}helper.llvm.split:
+; P1: {{^}}small:
+; P1: callq alias
+; P1: .Lstr:
+; P1: .local counter
+
+define internal void @ctor() {
+  store i32 1, i32* @counter
+  ret void
+}
+
+define i32 @big(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %a, %a
+  %c = sub i32 %b, %x
+  %d = mul i32 %c, %b
+  %e = add i32 %d, %a
+  %f = call i32 @helper(i32 %e)
+  ret i32 %f
+}
+
+define internal i32 @helper(i32 %x) {
+  %l = load i32* @counter
+  %r = add i32 %x, %l
+  ret i32 %r
+}
+
+define i8* @small() {
+  %v = load i32* @g
+  %r = call i32 @alias(i32 %v)
+  ret i8* getelementptr ([4 x i8]* @str, i32 0, i32 0)
+}
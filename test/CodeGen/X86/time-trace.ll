@@ -0,0 +1,15 @@
+; RUN: llc -mtriple=x86_64-unknown-unknown -regalloc=greedy %s -o /dev/null \
+; RUN:   -time-trace-file=%t.json -time-trace-granularity=0
+; RUN: FileCheck %s < %t.json
+
+; Instruction selection phases nest in the pass that runs them.
+; CHECK-DAG: "name":"X86 DAG->DAG Instruction Selection","args":{"detail":"f"}
+; CHECK-DAG: "name":"DAG Combining 1"}
+; CHECK-DAG: "name":"Instruction Scheduling"}
+; CHECK-DAG: "name":"Greedy Register Allocator","args":{"detail":"f"}
+; CHECK: "args":{"name":"llc"}
+
+define i32 @f(i32 %x, i32 %y) {
+  %a = add i32 %x, %y
+  ret i32 %a
+}
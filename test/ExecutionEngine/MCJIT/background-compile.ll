@@ -0,0 +1,55 @@
+; Functions are called through stubs, whichever code the stubs call.
+; RUN: %lli_mcjit -background-compile -stats %s 2>&1 | FileCheck %s
+; RUN: %lli_mcjit -background-compile -O3 %s
+; REQUIRES: asserts
+
+; CHECK: 3 background-compiler - Number of functions called through stubs
+
+@results = internal global [2 x i32] zeroinitializer
+
+define internal i32 @fib(i32 %n) {
+entry:
+  %small = icmp slt i32 %n, 2
+  br i1 %small, label %done, label %recurse
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %f1 = call i32 @fib(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  ret i32 %sum
+
+done:
+  ret i32 %n
+}
+
+define void @record(i32 %i, i32 %v) {
+  %p = getelementptr [2 x i32]* @results, i32 0, i32 %i
+  store i32 %v, i32* %p
+  ret void
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %f = call i32 @fib(i32 24)
+  %slot = and i32 %i, 1
+  call void @record(i32 %slot, i32 %f)
+  %i.next = add i32 %i, 1
+  %again = icmp ne i32 %i.next, 200
+  br i1 %again, label %loop, label %exit
+
+exit:
+  %p0 = getelementptr [2 x i32]* @results, i32 0, i32 0
+  %r0 = load i32* %p0
+  %p1 = getelementptr [2 x i32]* @results, i32 0, i32 1
+  %r1 = load i32* %p1
+  %d0 = xor i32 %r0, 46368
+  %d1 = xor i32 %r1, 46368
+  %rc = or i32 %d0, %d1
+  ret i32 %rc
+}
@@ -0,0 +1,15 @@
+; The first run compiles the module into the cache, the second one loads it.
+; RUN: rm -rf %t.cache
+; RUN: %lli_mcjit -disk-object-cache=%t.cache -stats %s 2>&1 | FileCheck -check-prefix=MISS %s
+; RUN: %lli_mcjit -disk-object-cache=%t.cache -stats %s 2>&1 | FileCheck -check-prefix=HIT %s
+; RUN: ls %t.cache | count 1
+; REQUIRES: asserts
+
+; MISS-NOT: objects loaded from the disk object cache
+; MISS: 1 disk-object-cache - Number of modules not found in the disk object cache
+; HIT: 1 disk-object-cache - Number of objects loaded from the disk object cache
+; HIT-NOT: modules not found
+
+define i32 @main() {
+  ret i32 0
+}
@@ -0,0 +1,126 @@
+; Hot functions are compiled, and share the globals and the output of the
+; program with the interpreter.
+; RUN: %lli_mcjit -tier-up-threshold=50 -print-tier-transitions %s 2>&1 \
+; RUN:   > /dev/null | FileCheck -check-prefix=TIERS %s
+; RUN: %lli_mcjit -tier-up-threshold=50 %s | FileCheck %s
+; RUN: %lli_mcjit -tier-up-threshold=1 %s | FileCheck %s
+
+; TIERS-DAG: lli: compiled 'fib' after 50 calls and 0 back edges
+; TIERS-DAG: lli: compiled 'show' after 50 calls and 0 back edges
+; TIERS-DAG: lli: kept 'check' interpreted: it calls exit, which the interpreter implements
+; TIERS-DAG: lli: compiled 'sum' after 2 calls and 99 back edges
+; TIERS-NOT: lli:
+
+; CHECK: show 19
+; CHECK-NEXT: main 19
+; CHECK-NEXT: show 39
+; CHECK-NEXT: main 39
+; CHECK-NEXT: show 59
+; CHECK-NEXT: main 59
+; CHECK-NEXT: fib 55 calls 177
+; CHECK-NEXT: sum 4950
+
+@counter = internal global i32 0
+@.show = private constant [9 x i8] c"show %d\0A\00"
+@.main = private constant [9 x i8] c"main %d\0A\00"
+@.fib = private constant [17 x i8] c"fib %d calls %d\0A\00"
+@.sum = private constant [8 x i8] c"sum %d\0A\00"
+
+declare i32 @printf(i8*, ...)
+declare void @exit(i32)
+
+define internal i32 @fib(i32 %n) {
+entry:
+  %c = load i32* @counter
+  %c1 = add i32 %c, 1
+  store i32 %c1, i32* @counter
+  %small = icmp slt i32 %n, 2
+  br i1 %small, label %done, label %recurse
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %f1 = call i32 @fib(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %f2 = call i32 @fib(i32 %n2)
+  %f = add i32 %f1, %f2
+  ret i32 %f
+
+done:
+  ret i32 %n
+}
+
+define internal i32 @show(i32 %i) {
+entry:
+  %r = urem i32 %i, 20
+  %print = icmp eq i32 %r, 19
+  br i1 %print, label %then, label %else
+
+then:
+  %p = call i32 (i8*, ...)* @printf(i8* getelementptr ([9 x i8]* @.show, i32 0, i32 0), i32 %i)
+  ret i32 1
+
+else:
+  ret i32 0
+}
+
+define internal void @check(i32 %i, i32 %expected) {
+entry:
+  %ok = icmp eq i32 %i, %expected
+  br i1 %ok, label %done, label %fail
+
+fail:
+  call void @exit(i32 1)
+  unreachable
+
+done:
+  ret void
+}
+
+define internal i32 @sum(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i1, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc1, %loop ]
+  %acc1 = add i32 %acc, %i
+  %i1 = add i32 %i, 1
+  %done = icmp eq i32 %i1, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %acc1
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i1, %next ]
+  call void @check(i32 %i, i32 %i)
+  %printed = call i32 @show(i32 %i)
+  %printed.b = icmp ne i32 %printed, 0
+  br i1 %printed.b, label %print, label %next
+
+print:
+  %p = call i32 (i8*, ...)* @printf(i8* getelementptr ([9 x i8]* @.main, i32 0, i32 0), i32 %i)
+  br label %next
+
+next:
+  %i1 = add i32 %i, 1
+  %stop = icmp eq i32 %i1, 60
+  br i1 %stop, label %done, label %loop
+
+done:
+  %f = call i32 @fib(i32 10)
+  %c = load i32* @counter
+  %p2 = call i32 (i8*, ...)* @printf(i8* getelementptr ([17 x i8]* @.fib, i32 0, i32 0), i32 %f, i32 %c)
+  %s1 = call i32 @sum(i32 100)
+  %s2 = call i32 @sum(i32 100)
+  %s3 = call i32 @sum(i32 100)
+  %s12 = add i32 %s1, %s2
+  %s = sub i32 %s12, %s3
+  %p3 = call i32 (i8*, ...)* @printf(i8* getelementptr ([8 x i8]* @.sum, i32 0, i32 0), i32 %s)
+  ret i32 0
+}
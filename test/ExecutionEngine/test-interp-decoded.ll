@@ -0,0 +1,51 @@
+; RUN: %lli -force-interpreter=true %s > /dev/null
+; RUN: %lli -force-interpreter=true -interpreter-fast-paths=false %s > /dev/null
+
+declare i32 @llvm.ctpop.i32(i32)
+
+; The PHI nodes of the loop read each other: they must be copied in parallel.
+define i32 @fib(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %a = phi i32 [ 0, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 1, %entry ], [ %sum, %loop ]
+  %sum = add i32 %a, %b
+  %i.next = add i32 %i, 1
+  %more = icmp slt i32 %i.next, %n
+  br i1 %more, label %loop, label %exit
+
+exit:
+  ret i32 %b
+}
+
+; The sum of the population counts of 0 .. n-1.  The intrinsic is lowered by
+; the innermost call, while the callers are about to run it.
+define i32 @popsum(i32 %n) {
+entry:
+  %zero = icmp eq i32 %n, 0
+  br i1 %zero, label %done, label %recurse
+
+recurse:
+  %m = sub i32 %n, 1
+  %r = call i32 @popsum(i32 %m)
+  %c = call i32 @llvm.ctpop.i32(i32 %m)
+  %s = add i32 %r, %c
+  ret i32 %s
+
+done:
+  ret i32 0
+}
+
+define i32 @main() {
+entry:
+  %f = call i32 @fib(i32 10)
+  %fok = icmp eq i32 %f, 55
+  %p = call i32 @popsum(i32 8)
+  %pok = icmp eq i32 %p, 12
+  %ok = and i1 %fok, %pok
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,26 @@
+; RUN: llvm-as < %s > %t1
+; RUN: llvm-lto -j 2 -exported-symbol=foo -exported-symbol=bar \
+; RUN:   -disable-inlining -o %t2 %t1
+; RUN: llvm-nm %t2.0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-nm %t2.1 | FileCheck --check-prefix=CHECK1 %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK0-NOT: T bar
+; CHECK0: T foo
+; CHECK1: T bar
+; CHECK1-NOT: T foo
+
+define i32 @foo(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %a, %a
+  %c = sub i32 %b, %x
+  %d = mul i32 %c, %b
+  ret i32 %d
+}
+
+define i32 @bar(i32 %x) {
+  %r = call i32 @foo(i32 %x)
+  ret i32 %r
+}
@@ -0,0 +1,18 @@
+@tbl = internal constant [1 x i8*] [i8* blockaddress(@f, %l)]
+@unused_tbl = internal constant [1 x i8*] [i8* blockaddress(@unused, %l)]
+
+define void @f(i32 %i) {
+entry:
+  %p = getelementptr [1 x i8*]* @tbl, i32 0, i32 %i
+  %a = load i8** %p
+  indirectbr i8* %a, [label %l]
+l:
+  ret void
+}
+
+define void @unused() {
+entry:
+  indirectbr i8* blockaddress(@unused, %l), [label %l]
+l:
+  ret void
+}
@@ -0,0 +1,39 @@
+@used_var = global i32 1
+@unused_var = global i32 2
+@table = global [1 x i32()*] [i32()* @from_table]
+@llvm.used = appending global [1 x i8*] [i8* bitcast (i32* @kept_var to i8*)], section "llvm.metadata"
+@kept_var = internal global i32 3
+@alias = alias i32()* @aliased
+
+define i32 @foo() {
+  %v = load i32* @used_var
+  %r = call i32 @helper(i32 %v)
+  ret i32 %r
+}
+
+define internal i32 @helper(i32 %x) {
+  %t = load [1 x i32()*]* @table
+  ret i32 %x
+}
+
+define i32 @from_table() {
+  ret i32 0
+}
+
+define i32 @unused() {
+  %r = call i32 @unused_helper()
+  ret i32 %r
+}
+
+define internal i32 @unused_helper() {
+  %v = load i32* @unused_var
+  ret i32 %v
+}
+
+define i32 @aliased() {
+  ret i32 1
+}
+
+define i32 @required() {
+  ret i32 2
+}
@@ -0,0 +1,3 @@
+%T = type { i64 }
+
+@b = global %T zeroinitializer
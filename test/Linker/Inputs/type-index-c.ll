@@ -0,0 +1,3 @@
+%T = type { i64 }
+
+@c = global %T zeroinitializer
@@ -0,0 +1,3 @@
+%Obody = type { i64 }
+
+@o = global %Obody zeroinitializer
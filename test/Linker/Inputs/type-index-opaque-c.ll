@@ -0,0 +1,3 @@
+%O = type { i64 }
+
+@c = global %O zeroinitializer
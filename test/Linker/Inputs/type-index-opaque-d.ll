@@ -0,0 +1,3 @@
+%O = type { i64 }
+
+@d = global %O zeroinitializer
@@ -0,0 +1,3 @@
+%O = type { i64 }
+
+@e = global %O zeroinitializer
@@ -0,0 +1,18 @@
+; RUN: llvm-as %p/Inputs/only-needed-blockaddress.ll -o %t.bc
+; RUN: llvm-link -only-needed -S %s %t.bc | FileCheck %s
+
+; The block of a blockaddress is an operand of the constant that is not a
+; constant itself.
+
+declare void @f(i32)
+
+define void @main() {
+  call void @f(i32 0)
+  ret void
+}
+
+; CHECK: @tbl = internal constant [1 x i8*] [i8* blockaddress(@f, %l)]
+; CHECK-NOT: unused
+; CHECK: define void @f(i32 %i)
+; CHECK: indirectbr
+; CHECK-NOT: unused
@@ -0,0 +1,32 @@
+; RUN: llvm-as %p/Inputs/only-needed.ll -o %t.bc
+; RUN: llvm-link -only-needed -S %s %t.bc | FileCheck %s
+; RUN: llvm-link -only-needed -S %s %t.bc | FileCheck %s -check-prefix=NONE
+; RUN: llvm-link -only-needed -required-symbol=required -S %s %t.bc \
+; RUN:   | FileCheck %s -check-prefix=REQUIRED
+; RUN: llvm-link -S %s %t.bc | FileCheck %s -check-prefix=ALL
+
+declare i32 @foo()
+
+define i32 @main() {
+  %r = call i32 @foo()
+  ret i32 %r
+}
+
+; CHECK-DAG: @used_var = global i32 1
+; CHECK-DAG: @table = global
+; CHECK-DAG: @llvm.used = appending global
+; CHECK-DAG: @kept_var = internal global i32 3
+; CHECK-DAG: define i32 @foo()
+; CHECK-DAG: define internal i32 @helper(i32 %x)
+; CHECK-DAG: define i32 @from_table()
+
+; NONE-NOT: unused
+; NONE-NOT: alias
+; NONE-NOT: required
+
+; REQUIRED: define i32 @required()
+
+; ALL-DAG: @unused_var = global i32 2
+; ALL-DAG: @alias = alias
+; ALL-DAG: define i32 @unused()
+; ALL-DAG: define i32 @required()
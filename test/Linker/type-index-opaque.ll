@@ -0,0 +1,29 @@
+; The destination has an opaque type that the second module gives a body.
+; The modules linked after it must find that type by structure, without
+; rescanning the types of the destination.
+; RUN: llvm-link -S %s %p/Inputs/type-index-opaque-b.ll \
+; RUN:   %p/Inputs/type-index-opaque-c.ll %p/Inputs/type-index-opaque-d.ll \
+; RUN:   %p/Inputs/type-index-opaque-e.ll -stats 2> %t.stats | FileCheck %s
+; RUN: FileCheck %s -check-prefix=STATS < %t.stats
+; REQUIRES: asserts
+
+%O = type { i32 }
+%O.5 = type opaque
+%U = type opaque
+
+@a = global %O zeroinitializer
+@o = external global %O.5
+@u = external global %U
+
+; CHECK-DAG: %O = type { i32 }
+; CHECK-DAG: %O.5 = type { i64 }
+; CHECK-DAG: %U = type opaque
+; CHECK-NOT: type
+; CHECK-DAG: @a = global %O zeroinitializer
+; CHECK-DAG: @o = global %O.5 zeroinitializer
+; CHECK-DAG: @u = external global %U
+; CHECK: @c = global %O.5 zeroinitializer
+; CHECK: @d = global %O.5 zeroinitializer
+; CHECK: @e = global %O.5 zeroinitializer
+
+; STATS: 3 link-modules - Number of struct types matched by structure
@@ -0,0 +1,20 @@
+; Linking the third module must find the isomorphic type the second one left
+; under a suffixed name instead of creating another one.
+; RUN: llvm-link -S %s %p/Inputs/type-index-b.ll %p/Inputs/type-index-c.ll \
+; RUN:   -stats 2> %t.stats | FileCheck %s
+; RUN: FileCheck %s -check-prefix=STATS < %t.stats
+; REQUIRES: asserts
+
+%T = type { i32 }
+
+@a = global %T zeroinitializer
+
+; CHECK: %T = type { i32 }
+; CHECK-NEXT: %[[B:T\.[0-9]+]] = type { i64 }
+; CHECK-NOT: type
+; CHECK: @a = global %T zeroinitializer
+; CHECK: @b = global %[[B]] zeroinitializer
+; CHECK: @c = global %[[B]] zeroinitializer
+
+; STATS: 1 link-modules - Number of struct types matched by structure
+; STATS: 1 link-modules - Number of struct types with no isomorphic type by structure
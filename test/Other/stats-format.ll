@@ -0,0 +1,38 @@
+; RUN: opt -instcombine -stats -stats-format=json %s -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=JSON
+; RUN: opt -instcombine -stats -stats-format=csv -stats-thread-local %s \
+; RUN:   -o /dev/null 2>&1 | FileCheck %s -check-prefix=CSV
+; RUN: opt -instcombine -time-passes -timer-format=csv %s -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=TIMER-CSV
+; RUN: opt -instcombine -time-passes -timer-format=json %s -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=TIMER-JSON
+; REQUIRES: asserts
+
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 0
+  %b = add i32 %a, 0
+  ret i32 %b
+}
+
+; JSON:      {
+; JSON-NEXT:   "statistics": [
+; JSON-NEXT:     { "name": "instcombine", "description": "Number of insts combined", "value": 2 }
+; JSON-NEXT:   ]
+; JSON-NEXT: }
+
+; CSV:      name,description,value
+; CSV-NEXT: instcombine,Number of insts combined,2
+
+; TIMER-CSV: group,name,user,system,wall,mem
+; TIMER-CSV: ... Pass execution timing report ...,Combine redundant instructions,{{[0-9.]+}},{{[0-9.]+}},{{[0-9.]+}},0
+
+; TIMER-JSON:      {
+; TIMER-JSON-NEXT:   "timer_groups": [
+; TIMER-JSON-NEXT:     {
+; TIMER-JSON-NEXT:       "group": "... Pass execution timing report ...",
+; TIMER-JSON-NEXT: "total": { "user": {{[0-9.]+}}, "system": {{[0-9.]+}}, "wall": {{[0-9.]+}}, "mem": 0 },
+; TIMER-JSON-NEXT: "timers": [
+; TIMER-JSON:      { "name": "Combine redundant instructions", "user": {{[0-9.]+}}, "system": {{[0-9.]+}}, "wall": {{[0-9.]+}}, "mem": 0 }
+; TIMER-JSON-NOT: timer_groups
+; TIMER-JSON:      "group": "LLVM IR Parsing",
+; TIMER-JSON-NOT: timer_groups
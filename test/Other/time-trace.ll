@@ -0,0 +1,19 @@
+; RUN: opt -instcombine %s -o /dev/null -time-trace-file=%t.json \
+; RUN:   -time-trace-granularity=0
+; RUN: FileCheck %s < %t.json
+
+; CHECK: {"traceEvents":[
+; CHECK-DAG: {"pid":1,"tid":0,"ph":"X","ts":{{[0-9]+}},"dur":{{[0-9]+}},"name":"Combine redundant instructions","args":{"detail":"f"}},
+; CHECK-DAG: {"pid":1,"tid":0,"ph":"X","ts":{{[0-9]+}},"dur":{{[0-9]+}},"name":"Combine redundant instructions","args":{"detail":"g"}},
+; CHECK-DAG: {"pid":1,"tid":0,"ph":"X","ts":{{[0-9]+}},"dur":{{[0-9]+}},"name":"Bitcode Writer","args":{"detail":"{{.*}}time-trace.ll"}},
+; CHECK: {"pid":1,"tid":0,"ph":"M","name":"process_name","args":{"name":"opt"}}
+; CHECK-NEXT: ]}
+
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 0
+  ret i32 %a
+}
+
+define i32 @g(i32 %x) {
+  ret i32 %x
+}
@@ -85,6 +85,9 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  // Number of partitions to split the merged module into for parallel code
+  // generation.
+  static unsigned jobs = 1;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -104,6 +107,11 @@ namespace options {
       mcpu = opt.substr(strlen("mcpu="));
     } else if (opt.startswith("extra-library-path=")) {
       extra_library_path = opt.substr(strlen("extra_library_path="));
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, jobs) || jobs == 0) {
+        (*message)(LDPL_WARNING, "Invalid number of jobs: %s", opt_);
+        jobs = 1;
+      }
     } else if (opt.startswith("mtriple=")) {
       triple = opt.substr(strlen("mtriple="));
     } else if (opt.startswith("obj-path=")) {
@@ -446,13 +454,26 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  std::string ObjPath;
-  {
-    const char *Temp;
+  std::vector<std::string> ObjPaths;
+  if (options::jobs > 1) {
+    const char *const *Temps = 0;
+    unsigned NumTemps = 0;
+    lto_codegen_set_parallelism(code_gen, options::jobs);
+    if (lto_codegen_compile_to_files(code_gen, &Temps, &NumTemps)) {
+      (*message)(LDPL_ERROR,
+                 "Could not produce the partitioned object files\n");
+      lto_codegen_dispose(code_gen);
+      return LDPS_ERR;
+    }
+    ObjPaths.assign(Temps, Temps + NumTemps);
+  } else {
+    const char *Temp = 0;
     if (lto_codegen_compile_to_file(code_gen, &Temp)) {
       (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
+      lto_codegen_dispose(code_gen);
+      return LDPS_ERR;
     }
-    ObjPath = Temp;
+    ObjPaths.push_back(Temp);
   }
 
   lto_codegen_dispose(code_gen);
@@ -464,10 +485,13 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(ObjPath.c_str()) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", ObjPath.c_str());
-    return LDPS_ERR;
+  // The partitions are added in order, so the link is deterministic.
+  for (unsigned i = 0, e = ObjPaths.size(); i != e; ++i) {
+    if ((*add_input_file)(ObjPaths[i].c_str()) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", ObjPaths[i].c_str());
+      return LDPS_ERR;
+    }
   }
 
   if (!options::extra_library_path.empty() &&
@@ -477,7 +501,7 @@ static ld_plugin_status all_symbols_read_hook(void) {
   }
 
   if (options::obj_path.empty())
-    Cleanup.push_back(ObjPath);
+    Cleanup.insert(Cleanup.end(), ObjPaths.begin(), ObjPaths.end());
 
   return LDPS_OK;
 }
@@ -14,10 +14,12 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
@@ -31,12 +33,15 @@
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
@@ -58,6 +63,12 @@ TimeCompilations("time-compilations", cl::Hidden, cl::init(1u),
                  cl::value_desc("N"),
                  cl::desc("Repeat compilation N times for timing"));
 
+static cl::opt<unsigned>
+NumPartitions("j", cl::value_desc("N"), cl::init(1u),
+              cl::desc("Split the module into N partitions and generate code "
+                       "for them in parallel, writing partition I to "
+                       "<output>.I"));
+
 static cl::opt<bool>
 NoIntegratedAssembler("no-integrated-as", cl::Hidden,
                       cl::desc("Disable integrated assembler"));
@@ -82,7 +93,21 @@ DisableSimplifyLibCalls("disable-simplify-libcalls",
                         cl::desc("Disable simplify-libcalls"),
                         cl::init(false));
 
+static cl::opt<std::string>
+TimeTraceFile("time-trace-file", cl::value_desc("filename"),
+              cl::desc("Write a Chrome trace of the time taken by each pass "
+                       "run and code generation phase to this file"));
+
+static cl::opt<unsigned>
+TimeTraceGranularity("time-trace-granularity", cl::init(500u),
+                     cl::value_desc("us"),
+                     cl::desc("Leave the events shorter than this number of "
+                              "microseconds out of the time trace"));
+
 static int compileModule(char**, LLVMContext&);
+static int compileModuleSplit(char **, Module &, const Target *,
+                              const Triple &, StringRef, const TargetOptions &,
+                              CodeGenOpt::Level);
 
 // GetFileNameRoot - Helper function to get the basename of a filename.
 static inline std::string
@@ -103,7 +128,8 @@ GetFileNameRoot(const std::string &InputFilename) {
 
 static tool_output_file *GetOutputStream(const char *TargetName,
                                          Triple::OSType OS,
-                                         const char *ProgName) {
+                                         const char *ProgName,
+                                         StringRef Suffix = "") {
   // If we don't yet have an output filename, make one.
   if (OutputFilename.empty()) {
     if (InputFilename == "-")
@@ -152,7 +178,8 @@ static tool_output_file *GetOutputStream(const char *TargetName,
   sys::fs::OpenFlags OpenFlags = sys::fs::F_None;
   if (!Binary)
     OpenFlags |= sys::fs::F_Text;
-  tool_output_file *FDOut = new tool_output_file(OutputFilename.c_str(), error,
+  std::string Filename = OutputFilename + Suffix.str();
+  tool_output_file *FDOut = new tool_output_file(Filename.c_str(), error,
                                                  OpenFlags);
   if (!error.empty()) {
     errs() << error << '\n';
@@ -195,11 +222,28 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm system compiler\n");
 
+  // The partitions are compiled on threads of their own.
+  if (NumPartitions > 1)
+    llvm_start_multithreaded();
+
+  if (!TimeTraceFile.empty())
+    timeTraceProfilerInitialize(TimeTraceGranularity);
+
   // Compile the module TimeCompilations times to give better compile time
   // metrics.
   for (unsigned I = TimeCompilations; I; --I)
     if (int RetVal = compileModule(argv, Context))
       return RetVal;
+
+  if (!TimeTraceFile.empty()) {
+    std::string ErrorInfo;
+    if (!timeTraceProfilerWrite(TimeTraceFile, sys::path::filename(argv[0]),
+                                ErrorInfo)) {
+      errs() << argv[0] << ": " << ErrorInfo << '\n';
+      return 1;
+    }
+    timeTraceProfilerCleanup();
+  }
   return 0;
 }
 
@@ -266,6 +310,12 @@ static int compileModule(char **argv, LLVMContext &Context) {
   TargetOptions Options = InitTargetOptionsFromCodeGenFlags();
   Options.DisableIntegratedAS = NoIntegratedAssembler;
 
+  if (NumPartitions > 1) {
+    assert(mod && "Should have exited after outputting help!");
+    return compileModuleSplit(argv, *mod, TheTarget, TheTriple, FeaturesStr,
+                              Options, OLvl);
+  }
+
   std::unique_ptr<TargetMachine> target(
       TheTarget->createTargetMachine(TheTriple.getTriple(), MCPU, FeaturesStr,
                                      Options, RelocModel, CMModel, OLvl));
@@ -354,3 +404,51 @@ static int compileModule(char **argv, LLVMContext &Context) {
 
   return 0;
 }
+
+// compileModuleSplit - Generate code for mod in NumPartitions partitions, in
+// parallel, writing partition I to <output>.I.
+static int compileModuleSplit(char **argv, Module &mod,
+                              const Target *TheTarget, const Triple &TheTriple,
+                              StringRef FeaturesStr,
+                              const TargetOptions &Options,
+                              CodeGenOpt::Level OLvl) {
+  if (!StartAfter.empty() || !StopAfter.empty() || DisableCFI ||
+      EnableDwarfDirectory || RelaxAll) {
+    errs() << argv[0] << ": -j cannot be combined with options that "
+           << "configure a single target machine\n";
+    return 1;
+  }
+  if (OutputFilename == "-" ||
+      (OutputFilename.empty() && InputFilename == "-")) {
+    errs() << argv[0] << ": -j cannot write to standard output\n";
+    return 1;
+  }
+
+  // Split partitions are compiled in their own contexts, so the module's
+  // triple has to name the target.
+  mod.setTargetTriple(TheTriple.getTriple());
+  TargetMachine::setAsmVerbosityDefault(true);
+
+  std::vector<std::unique_ptr<tool_output_file>> Outs;
+  std::vector<raw_ostream *> OSs;
+  for (unsigned I = 0; I != NumPartitions; ++I) {
+    Outs.emplace_back(GetOutputStream(TheTarget->getName(), TheTriple.getOS(),
+                                      argv[0], "." + utostr(I)));
+    if (!Outs.back())
+      return 1;
+    OSs.push_back(&Outs.back()->os());
+  }
+
+  cl::PrintOptionValues();
+
+  std::string ErrMsg;
+  if (splitCodeGen(mod, OSs, MCPU, FeaturesStr, Options, RelocModel, CMModel,
+                   OLvl, FileType, ErrMsg)) {
+    errs() << argv[0] << ": " << ErrMsg << "\n";
+    return 1;
+  }
+
+  for (unsigned I = 0; I != NumPartitions; ++I)
+    Outs[I]->keep();
+  return 0;
+}
@@ -21,6 +21,8 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/ExecutionEngine/BackgroundCompiler.h"
+#include "llvm/ExecutionEngine/DiskObjectCache.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/JIT.h"
@@ -29,6 +31,7 @@
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/ExecutionEngine/TierListener.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
@@ -51,6 +54,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Instrumentation.h"
 #include <cerrno>
@@ -162,6 +166,37 @@ namespace {
                            "(must be user writable)"),
                   cl::init(""));
 
+  cl::opt<std::string>
+  DiskObjectCacheDir("disk-object-cache",
+        cl::desc("Directory of a cache of objects, found by the contents of "
+                 "their modules (MCJIT only)"),
+        cl::value_desc("directory"), cl::init(""));
+
+  cl::opt<unsigned>
+  DiskObjectCacheSize("disk-object-cache-size",
+        cl::desc("Maximum size of the disk object cache in kilobytes, or 0 "
+                 "for no limit"),
+        cl::init(0));
+
+  cl::opt<bool>
+  BackgroundCompile("background-compile",
+        cl::desc("Run code generated without optimization while it is "
+                 "recompiled at the -O level on another thread (MCJIT only)"),
+        cl::init(false));
+
+  cl::opt<unsigned>
+  TierUpThreshold("tier-up-threshold",
+        cl::desc("Interpret functions until they were called or looped this "
+                 "many times, then run them compiled by MCJIT (0 disables "
+                 "tiered execution)"),
+        cl::init(0));
+
+  cl::opt<bool>
+  PrintTierTransitions("print-tier-transitions",
+        cl::desc("Print the functions -tier-up-threshold compiles, or keeps "
+                 "interpreted"),
+        cl::init(false));
+
   cl::opt<std::string>
   FakeArgv0("fake-argv0",
             cl::desc("Override the 'argv[0]' value passed into the executing"
@@ -319,12 +354,31 @@ private:
   }
 };
 
+namespace {
+/// LLITierListener - Print the tier transitions of the functions of the
+/// program.
+class LLITierListener : public TierListener {
+  void notifyFunctionPromoted(const Function &F, uint64_t Calls,
+                              uint64_t BackEdges) override {
+    errs() << "lli: compiled '" << F.getName() << "' after " << Calls
+           << " calls and " << BackEdges << " back edges\n";
+  }
+
+  void notifyPromotionFailed(const Function &F, StringRef Reason) override {
+    errs() << "lli: kept '" << F.getName() << "' interpreted: it " << Reason
+           << "\n";
+  }
+};
+}
+
 static ExecutionEngine *EE = 0;
-static LLIObjectCache *CacheManager = 0;
+static ObjectCache *CacheManager = 0;
+static BackgroundCompiler *BgCompiler = 0;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
 #ifndef DO_NOTHING_ATEXIT
+  delete BgCompiler;
   delete EE;
   if (CacheManager)
     delete CacheManager;
@@ -448,9 +502,22 @@ int main(int argc, char **argv, char * const *envp) {
   if (!TargetTriple.empty())
     Mod->setTargetTriple(Triple::normalize(TargetTriple));
 
+  if (TierUpThreshold && (ForceInterpreter || RemoteMCJIT ||
+                          BackgroundCompile)) {
+    errs() << "warning: -tier-up-threshold cannot be used with "
+              "-force-interpreter, -remote-mcjit or -background-compile.\n";
+    TierUpThreshold = 0;
+  }
+
   // Enable MCJIT if desired.
   RTDyldMemoryManager *RTDyldMM = 0;
-  if (UseMCJIT && !ForceInterpreter) {
+  if (TierUpThreshold) {
+    // The interpreter runs the program, and an MCJIT with its default memory
+    // manager compiles the hot functions.
+    builder.setEngineKind(EngineKind::Either);
+    builder.setUseMCJIT(true);
+    builder.setTierUpThreshold(TierUpThreshold);
+  } else if (UseMCJIT && !ForceInterpreter) {
     builder.setUseMCJIT(true);
     if (RemoteMCJIT)
       RTDyldMM = new RemoteMemoryManager();
@@ -477,7 +544,18 @@ int main(int argc, char **argv, char * const *envp) {
   case '2': OLvl = CodeGenOpt::Default; break;
   case '3': OLvl = CodeGenOpt::Aggressive; break;
   }
-  builder.setOptLevel(OLvl);
+  if (BackgroundCompile && UseMCJIT && !RemoteMCJIT && !ForceInterpreter) {
+    // Start with unoptimized code, the optimized code comes later, from
+    // another thread.
+    llvm_start_multithreaded();
+    builder.setOptLevel(CodeGenOpt::None);
+  } else {
+    if (BackgroundCompile)
+      errs() << "warning: -background-compile can only be used with MCJIT "
+                "in process.\n";
+    BackgroundCompile = false;
+    builder.setOptLevel(OLvl);
+  }
 
   TargetOptions Options;
   Options.UseSoftFloat = GenerateSoftFloatCalls;
@@ -503,9 +581,28 @@ int main(int argc, char **argv, char * const *envp) {
     exit(1);
   }
 
+  static LLITierListener TierPrinter;
+  if (PrintTierTransitions)
+    EE->setTierListener(&TierPrinter);
+
   if (EnableCacheManager) {
     CacheManager = new LLIObjectCache(ObjectCacheDir);
     EE->setObjectCache(CacheManager);
+  } else if (!DiskObjectCacheDir.empty()) {
+    if (UseMCJIT) {
+      CacheManager = new DiskObjectCache(DiskObjectCacheDir,
+                                         *EE->getTargetMachine(),
+                                         uint64_t(DiskObjectCacheSize) * 1024);
+      EE->setObjectCache(CacheManager);
+    } else
+      errs() << "warning: -disk-object-cache can only be used with MCJIT.";
+  }
+
+  std::vector<Module *> BackgroundModules;
+  if (BackgroundCompile) {
+    BgCompiler = new BackgroundCompiler(*EE, OLvl);
+    BgCompiler->addModule(Mod);
+    BackgroundModules.push_back(Mod);
   }
 
   // Load any additional modules specified on the command line.
@@ -523,7 +620,11 @@ int main(int argc, char **argv, char * const *envp) {
       }
       // else, we already printed a warning above.
     }
-    EE->addModule(XMod);
+    if (BgCompiler) {
+      BgCompiler->addModule(XMod);
+      BackgroundModules.push_back(XMod);
+    } else
+      EE->addModule(XMod);
   }
 
   for (unsigned i = 0, e = ExtraObjects.size(); i != e; ++i) {
@@ -613,6 +714,8 @@ int main(int argc, char **argv, char * const *envp) {
       // Give MCJIT a chance to apply relocations and set page permissions.
       EE->finalizeObject();
     }
+    for (unsigned i = 0, e = BackgroundModules.size(); i != e; ++i)
+      BgCompiler->optimizeModule(BackgroundModules[i]);
     EE->runStaticConstructorsDestructors(false);
 
     if (!UseMCJIT && NoLazyCompilation) {
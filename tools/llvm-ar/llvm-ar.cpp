@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Object/Archive.h"
@@ -21,8 +22,11 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -68,6 +72,17 @@ static cl::list<std::string>
 RestOfArgs(cl::Positional, cl::OneOrMore,
     cl::desc("[relpos] [count] <archive-file> [members]..."));
 
+static cl::opt<unsigned>
+NumThreads("num-threads", cl::init(0),
+           cl::desc("Number of threads reading the symbols of the members "
+                    "(0 = one per core)"));
+
+static cl::opt<bool>
+ReuseSymbolTable("reuse-symbol-table",
+                 cl::desc("Take the symbols of the members kept from an "
+                          "existing archive from its symbol table instead of "
+                          "reading them"));
+
 std::string Options;
 
 // MoreHelp - Provide additional help output explaining the operations and
@@ -90,6 +105,7 @@ static cl::extrahelp MoreHelp(
   "  [o] - preserve original dates\n"
   "  [s] - create an archive index (cf. ranlib)\n"
   "  [S] - do not build a symbol table\n"
+  "  [T] - create a thin archive\n"
   "  [u] - update only files newer than archive contents\n"
   "\nMODIFIERS (generic):\n"
   "  [c] - do not warn if the library had to be created\n"
@@ -117,6 +133,7 @@ static bool OriginalDates = false; ///< 'o' modifier
 static bool OnlyUpdate = false;    ///< 'u' modifier
 static bool Verbose = false;       ///< 'v' modifier
 static bool Symtab = true;         ///< 's' modifier
+static bool Thin = false;          ///< 'T' modifier
 
 // Relative Positional Argument (for insert/move). This variable holds
 // the name of the archive member to which the 'a', 'b' or 'i' modifier
@@ -209,6 +226,7 @@ static ArchiveOperation parseCommandLine() {
     case 'S':
       Symtab = false;
       break;
+    case 'T': Thin = true; break;
     case 'u': OnlyUpdate = true; break;
     case 'v': Verbose = true; break;
     case 'a':
@@ -262,6 +280,9 @@ static ArchiveOperation parseCommandLine() {
     show_help("The 'o' modifier is only applicable to the 'x' operation");
   if (OnlyUpdate && Operation != ReplaceOrInsert)
     show_help("The 'u' modifier is only applicable to the 'r' operation");
+  if (Thin && Operation != QuickAppend && Operation != ReplaceOrInsert)
+    show_help("The 'T' modifier is only applicable to the 'q' and 'r' "
+              "operations");
 
   // Return the parsed operation to the caller
   return Operation;
@@ -273,7 +294,9 @@ static void doPrint(StringRef Name, object::Archive::child_iterator I) {
   if (Verbose)
     outs() << "Printing " << Name << "\n";
 
-  StringRef Data = I->getBuffer();
+  std::unique_ptr<MemoryBuffer> Buf;
+  failIfError(I->getMemoryBuffer(Buf), Name);
+  StringRef Data = Buf->getBuffer();
   outs().write(Data.data(), Data.size());
 }
 
@@ -363,8 +386,71 @@ static bool shouldCreateArchive(ArchiveOperation Op) {
   llvm_unreachable("Missing entry in covered switch.");
 }
 
+// getMemberName - The name of the member added for the file at Path. This is
+// the file name, or for thin archives the path of the file relative to the
+// directory of the archive.
+static std::string getMemberName(StringRef Path) {
+  if (!Thin)
+    return sys::path::filename(Path);
+  if (Path.empty())
+    return Path;
+
+  SmallString<128> FilePath(Path);
+  SmallString<128> ArchiveDir(sys::path::parent_path(ArchiveName));
+  if (sys::path::is_absolute(FilePath.str()) !=
+      sys::path::is_absolute(ArchiveDir.str())) {
+    failIfError(sys::fs::make_absolute(FilePath), Path);
+    failIfError(sys::fs::make_absolute(ArchiveDir), ArchiveName);
+  }
+
+  // Strip the directories the paths have in common, and climb out of the
+  // rest of the archive directory.
+  SmallVector<StringRef, 8> ArchiveComps, PathComps;
+  for (sys::path::const_iterator I = sys::path::begin(ArchiveDir),
+                                 E = sys::path::end(ArchiveDir);
+       I != E; ++I)
+    if (*I != ".")
+      ArchiveComps.push_back(*I);
+  StringRef PathDir = sys::path::parent_path(FilePath);
+  for (sys::path::const_iterator I = sys::path::begin(PathDir),
+                                 E = sys::path::end(PathDir);
+       I != E; ++I)
+    if (*I != ".")
+      PathComps.push_back(*I);
+
+  unsigned Common = 0;
+  while (Common < ArchiveComps.size() && Common < PathComps.size() &&
+         ArchiveComps[Common] == PathComps[Common])
+    ++Common;
+  SmallString<128> Result;
+  for (unsigned I = Common, E = ArchiveComps.size(); I != E; ++I) {
+    // We can't climb out of a parent directory, use an absolute path then.
+    if (ArchiveComps[I] == "..") {
+      failIfError(sys::fs::make_absolute(FilePath), Path);
+      return FilePath.str();
+    }
+    sys::path::append(Result, "..");
+  }
+  for (unsigned I = Common, E = PathComps.size(); I != E; ++I)
+    sys::path::append(Result, PathComps[I]);
+  sys::path::append(Result, sys::path::filename(FilePath));
+  return Result.str();
+}
+
 static void performReadOperation(ArchiveOperation Operation,
                                  object::Archive *OldArchive) {
+  if (OldArchive->isThin()) {
+    // The members of a thin archive are the files that would be extracted.
+    if (Operation == Extract)
+      fail("extracting from a thin archive is not supported");
+    // Members are named by their path relative to the archive.
+    Thin = true;
+    for (std::vector<std::string>::iterator I = Members.begin(),
+                                            E = Members.end();
+         I != E; ++I)
+      *I = getMemberName(*I);
+  }
+
   for (object::Archive::child_iterator I = OldArchive->child_begin(),
                                        E = OldArchive->child_end();
        I != E; ++I) {
@@ -394,7 +480,7 @@ static void performReadOperation(ArchiveOperation Operation,
 namespace {
 class NewArchiveIterator {
   bool IsNewMember;
-  StringRef Name;
+  std::string Name;
 
   object::Archive::child_iterator OldI;
 
@@ -492,7 +578,7 @@ computeInsertAction(ArchiveOperation Operation,
 
   std::vector<std::string>::iterator MI = std::find_if(
       Members.begin(), Members.end(),
-      [Name](StringRef Path) { return Name == sys::path::filename(Path); });
+      [Name](StringRef Path) { return Name == getMemberName(Path); });
 
   if (MI == Members.end())
     return IA_AddOldMember;
@@ -506,7 +592,7 @@ computeInsertAction(ArchiveOperation Operation,
     return IA_MoveOldMember;
 
   if (Operation == ReplaceOrInsert) {
-    StringRef PosName = sys::path::filename(RelPos);
+    std::string PosName = getMemberName(RelPos);
     if (!OnlyUpdate) {
       if (PosName.empty())
         return IA_AddNewMeber;
@@ -538,7 +624,7 @@ computeNewArchiveMembers(ArchiveOperation Operation,
   std::vector<NewArchiveIterator> Ret;
   std::vector<NewArchiveIterator> Moved;
   int InsertPos = -1;
-  StringRef PosName = sys::path::filename(RelPos);
+  std::string PosName = getMemberName(RelPos);
   if (OldArchive) {
     for (object::Archive::child_iterator I = OldArchive->child_begin(),
                                          E = OldArchive->child_end();
@@ -594,8 +680,7 @@ computeNewArchiveMembers(ArchiveOperation Operation,
   for (std::vector<std::string>::iterator I = Members.begin(),
          E = Members.end();
        I != E; ++I, ++Pos) {
-    StringRef Name = sys::path::filename(*I);
-    addMember(Ret, &*I, Name, Pos);
+    addMember(Ret, &*I, getMemberName(*I), Pos);
   }
 
   return Ret;
@@ -660,8 +745,9 @@ static void writeStringTable(raw_fd_ostream &Out,
   for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
                                               E = Members.end();
        I != E; ++I) {
+    // Thin archives keep all the names here, as they are paths.
     StringRef Name = I->getName();
-    if (Name.size() < 16)
+    if (!Thin && Name.size() < 16)
       continue;
     if (StartOffset == 0) {
       printWithSpacePadding(Out, "//", 58);
@@ -681,60 +767,128 @@ static void writeStringTable(raw_fd_ostream &Out,
   Out.seek(Pos);
 }
 
+namespace {
+// The global symbols defined by an archive member.
+struct MemberSymbols {
+  MemberSymbols() : IsSymbolic(false), IsReused(false), NumSyms(0) {}
+
+  bool IsSymbolic;
+  // True if the symbols were taken from the symbol table of the old archive.
+  bool IsReused;
+  error_code EC;
+  // The null terminated names of the symbols.
+  std::string Names;
+  unsigned NumSyms;
+};
+}
+
+static void readMemberSymbols(MemoryBuffer *MemberBuffer,
+                              MemberSymbols &Symbols) {
+  // Each member gets its own context, as they are read concurrently.
+  LLVMContext Context;
+  ErrorOr<object::SymbolicFile *> ObjOrErr =
+      object::SymbolicFile::createSymbolicFile(
+          MemberBuffer, false, sys::fs::file_magic::unknown, &Context);
+  if (!ObjOrErr)
+    return;  // FIXME: check only for "not an object file" errors.
+  std::unique_ptr<object::SymbolicFile> Obj(ObjOrErr.get());
+  Symbols.IsSymbolic = true;
+
+  raw_string_ostream NameOS(Symbols.Names);
+  for (object::basic_symbol_iterator I = Obj->symbol_begin(),
+                                     E = Obj->symbol_end();
+       I != E; ++I) {
+    uint32_t Symflags = I->getFlags();
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
+      continue;
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+    if ((Symbols.EC = I->printName(NameOS)))
+      return;
+    NameOS << '\0';
+    ++Symbols.NumSyms;
+  }
+}
+
+// reuseOldSymbols - Fill in the symbols of the members kept from the old
+// archive from its symbol table. Members that are not in the table, like the
+// ones without global symbols, are left to be read.
+static void reuseOldSymbols(object::Archive *OldArchive,
+                            ArrayRef<NewArchiveIterator> Members,
+                            std::vector<MemberSymbols> &Symbols) {
+  if (!OldArchive->hasSymbolTable() ||
+      OldArchive->kind() == object::Archive::K_BSD)
+    return;
+
+  // Old members are identified by the address of their header.
+  DenseMap<const char *, unsigned> OldMembers;
+  for (unsigned I = 0, E = Members.size(); I != E; ++I)
+    if (!Members[I].isNewMember())
+      OldMembers[Members[I].getOld()->getRawName().data()] = I;
+
+  std::vector<MemberSymbols> Reused(Members.size());
+  for (object::Archive::symbol_iterator I = OldArchive->symbol_begin(),
+                                        E = OldArchive->symbol_end();
+       I != E; ++I) {
+    StringRef Name;
+    object::Archive::child_iterator Member;
+    // Don't trust a broken symbol table, read all the members instead.
+    if (I->getName(Name) || I->getMember(Member))
+      return;
+    DenseMap<const char *, unsigned>::iterator MI =
+        OldMembers.find(Member->getRawName().data());
+    if (MI == OldMembers.end())
+      continue;
+    MemberSymbols &S = Reused[MI->second];
+    S.IsSymbolic = S.IsReused = true;
+    S.Names += Name;
+    S.Names += '\0';
+    ++S.NumSyms;
+  }
+  Symbols.swap(Reused);
+}
+
 static void writeSymbolTable(
     raw_fd_ostream &Out, ArrayRef<NewArchiveIterator> Members,
-    ArrayRef<MemoryBuffer *> Buffers,
+    ArrayRef<MemoryBuffer *> Buffers, std::vector<MemberSymbols> &Symbols,
     std::vector<std::pair<unsigned, unsigned> > &MemberOffsetRefs) {
+  // Reading the symbols of the members is the costly part, and they are
+  // independent of each other.
+  {
+    ThreadPool Pool(NumThreads);
+    parallel_for_each(Pool, Symbols.begin(), Symbols.end(),
+                      [&](MemberSymbols &S) {
+      if (!S.IsReused)
+        readMemberSymbols(Buffers[&S - &Symbols[0]], S);
+    });
+  }
+
   unsigned StartOffset = 0;
-  unsigned MemberNum = 0;
-  std::string NameBuf;
-  raw_string_ostream NameOS(NameBuf);
   unsigned NumSyms = 0;
-  std::vector<object::SymbolicFile *> DeleteIt;
-  LLVMContext &Context = getGlobalContext();
-  for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
-                                              E = Members.end();
-       I != E; ++I, ++MemberNum) {
-    MemoryBuffer *MemberBuffer = Buffers[MemberNum];
-    ErrorOr<object::SymbolicFile *> ObjOrErr =
-        object::SymbolicFile::createSymbolicFile(
-            MemberBuffer, false, sys::fs::file_magic::unknown, &Context);
-    if (!ObjOrErr)
-      continue;  // FIXME: check only for "not an object file" errors.
-    object::SymbolicFile *Obj = ObjOrErr.get();
-
-    DeleteIt.push_back(Obj);
+  for (unsigned MemberNum = 0, E = Members.size(); MemberNum != E;
+       ++MemberNum) {
+    const MemberSymbols &S = Symbols[MemberNum];
+    if (!S.IsSymbolic)
+      continue;
+    failIfError(S.EC, Members[MemberNum].getName());
+
     if (!StartOffset) {
       printMemberHeader(Out, "", sys::TimeValue::now(), 0, 0, 0, 0);
       StartOffset = Out.tell();
       print32BE(Out, 0);
     }
 
-    for (object::basic_symbol_iterator I = Obj->symbol_begin(),
-                                       E = Obj->symbol_end();
-         I != E; ++I) {
-      uint32_t Symflags = I->getFlags();
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
-      failIfError(I->printName(NameOS));
-      NameOS << '\0';
-      ++NumSyms;
+    for (unsigned I = 0; I != S.NumSyms; ++I) {
       MemberOffsetRefs.push_back(std::make_pair(Out.tell(), MemberNum));
       print32BE(Out, 0);
     }
+    NumSyms += S.NumSyms;
   }
-  Out << NameOS.str();
-
-  for (std::vector<object::SymbolicFile *>::iterator I = DeleteIt.begin(),
-                                                     E = DeleteIt.end();
-       I != E; ++I) {
-    object::SymbolicFile *O = *I;
-    delete O;
-  }
+  for (unsigned MemberNum = 0, E = Members.size(); MemberNum != E;
+       ++MemberNum)
+    Out << Symbols[MemberNum].Names;
 
   if (StartOffset == 0)
     return;
@@ -752,6 +906,15 @@ static void writeSymbolTable(
 
 static void performWriteOperation(ArchiveOperation Operation,
                                   object::Archive *OldArchive) {
+  // An existing thin archive stays thin, but the members of a regular one
+  // can't be turned into references.
+  if (OldArchive) {
+    if (Thin && !OldArchive->isThin())
+      fail("cannot convert existing archive '" + ArchiveName +
+           "' to a thin archive");
+    Thin = OldArchive->isThin();
+  }
+
   SmallString<128> TmpArchive;
   failIfError(sys::fs::createUniqueFile(ArchiveName + ".temp-archive-%%%%%%%.a",
                                         TmpArchiveFD, TmpArchive));
@@ -759,7 +922,7 @@ static void performWriteOperation(ArchiveOperation Operation,
   TemporaryOutput = TmpArchive.c_str();
   tool_output_file Output(TemporaryOutput, TmpArchiveFD);
   raw_fd_ostream &Out = Output.os();
-  Out << "!<arch>\n";
+  Out << (Thin ? "!<thin>\n" : "!<arch>\n");
 
   std::vector<NewArchiveIterator> NewMembers =
       computeNewArchiveMembers(Operation, OldArchive);
@@ -769,27 +932,36 @@ static void performWriteOperation(ArchiveOperation Operation,
   std::vector<MemoryBuffer *> MemberBuffers;
   MemberBuffers.resize(NewMembers.size());
 
+  std::vector<MemberSymbols> Symbols(NewMembers.size());
+  if (Symtab && ReuseSymbolTable && OldArchive)
+    reuseOldSymbols(OldArchive, NewMembers, Symbols);
+
   for (unsigned I = 0, N = NewMembers.size(); I < N; ++I) {
     std::unique_ptr<MemoryBuffer> MemberBuffer;
     NewArchiveIterator &Member = NewMembers[I];
+    // The contents of the members are only needed for the symbol table when
+    // writing a thin archive, so skip reading them if it doesn't need them.
+    bool NeedContents = !Thin || (Symtab && !Symbols[I].IsReused);
 
     if (Member.isNewMember()) {
       const char *Filename = Member.getNew();
       int FD = Member.getFD();
       const sys::fs::file_status &Status = Member.getStatus();
-      failIfError(MemoryBuffer::getOpenFile(FD, Filename, MemberBuffer,
-                                            Status.getSize(), false),
-                  Filename);
+      if (NeedContents)
+        failIfError(MemoryBuffer::getOpenFile(FD, Filename, MemberBuffer,
+                                              Status.getSize(), false),
+                    Filename);
 
-    } else {
+    } else if (NeedContents) {
       object::Archive::child_iterator OldMember = Member.getOld();
-      failIfError(OldMember->getMemoryBuffer(MemberBuffer));
+      failIfError(OldMember->getMemoryBuffer(MemberBuffer), Member.getName());
     }
     MemberBuffers[I] = MemberBuffer.release();
   }
 
   if (Symtab) {
-    writeSymbolTable(Out, NewMembers, MemberBuffers, MemberOffsetRefs);
+    writeSymbolTable(Out, NewMembers, MemberBuffers, Symbols,
+                     MemberOffsetRefs);
   }
 
   std::vector<unsigned> StringMapIndexes;
@@ -815,11 +987,10 @@ static void performWriteOperation(ArchiveOperation Operation,
 
     const MemoryBuffer *File = MemberBuffers[MemberNum];
     if (I->isNewMember()) {
-      const char *FileName = I->getNew();
       const sys::fs::file_status &Status = I->getStatus();
 
-      StringRef Name = sys::path::filename(FileName);
-      if (Name.size() < 16)
+      StringRef Name = I->getName();
+      if (!Thin && Name.size() < 16)
         printMemberHeader(Out, Name, Status.getLastModificationTime(),
                           Status.getUser(), Status.getGroup(),
                           Status.permissions(), Status.getSize());
@@ -832,7 +1003,7 @@ static void performWriteOperation(ArchiveOperation Operation,
       object::Archive::child_iterator OldMember = I->getOld();
       StringRef Name = I->getName();
 
-      if (Name.size() < 16)
+      if (!Thin && Name.size() < 16)
         printMemberHeader(Out, Name, OldMember->getLastModified(),
                           OldMember->getUID(), OldMember->getGID(),
                           OldMember->getAccessMode(), OldMember->getSize());
@@ -843,7 +1014,8 @@ static void performWriteOperation(ArchiveOperation Operation,
                           OldMember->getSize());
     }
 
-    Out << File->getBuffer();
+    if (!Thin)
+      Out << File->getBuffer();
 
     if (Out.tell() % 2)
       Out << '\n';
@@ -912,6 +1084,10 @@ int main(int argc, char **argv) {
     "  This program archives bitcode files into single libraries\n"
   );
 
+  // The symbols of the members are read on several threads.
+  if (NumThreads != 1)
+    llvm_start_multithreaded();
+
   StringRef Stem = sys::path::stem(ToolName);
   if (Stem.find("ar") != StringRef::npos)
     return ar_main(argv);
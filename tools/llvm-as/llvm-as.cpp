@@ -21,12 +21,16 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/SystemUtils.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/system_error.h"
 #include <memory>
 using namespace llvm;
 
@@ -50,6 +54,10 @@ static cl::opt<bool>
 DisableVerify("disable-verify", cl::Hidden,
               cl::desc("Do not run verifier on input LLVM (dangerous!)"));
 
+static cl::opt<bool>
+PrintParseRate("print-parse-rate", cl::Hidden,
+               cl::desc("Print the rate at which the input is parsed in MB/s"));
+
 static void WriteOutputFile(const Module *M) {
   // Infer the output filename if needed.
   if (OutputFilename.empty()) {
@@ -93,12 +101,30 @@ int main(int argc, char **argv) {
 
   // Parse the file now...
   SMDiagnostic Err;
-  std::unique_ptr<Module> M(ParseAssemblyFile(InputFilename, Err, Context));
+  std::unique_ptr<MemoryBuffer> File;
+  if (error_code ec = MemoryBuffer::getFileOrSTDIN(InputFilename, File)) {
+    Err = SMDiagnostic(InputFilename, SourceMgr::DK_Error,
+                       "Could not open input file: " + ec.message());
+    Err.print(argv[0], errs());
+    return 1;
+  }
+  size_t InputSize = File->getBufferSize();
+  TimeRecord ParseStart = TimeRecord::getCurrentTime(true);
+  std::unique_ptr<Module> M(ParseAssembly(File.release(), 0, Err, Context));
   if (M.get() == 0) {
     Err.print(argv[0], errs());
     return 1;
   }
 
+  if (PrintParseRate) {
+    double Seconds = TimeRecord::getCurrentTime(false).getWallTime() -
+                     ParseStart.getWallTime();
+    double MB = InputSize / (1024.0 * 1024.0);
+    errs() << argv[0] << ": parsed " << InputSize << " bytes in "
+           << format("%.3f", Seconds) << " s ("
+           << format("%.1f", Seconds > 0 ? MB / Seconds : 0.0) << " MB/s)\n";
+  }
+
   if (!DisableVerify) {
     std::string ErrorStr;
     raw_string_ostream OS(ErrorStr);
@@ -24,6 +24,7 @@
 #include "llvm/Support/MemoryObject.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
 #include <algorithm>
@@ -51,6 +52,11 @@ static cl::opt<bool>
 PrintInlining("inlining", cl::init(false),
               cl::desc("Print all inlined frames for a given address"));
 
+static cl::opt<unsigned>
+NumThreads("num-threads", cl::init(1),
+           cl::desc("Number of threads parsing the debug information up "
+                    "front (0 = one per core)"));
+
 static cl::opt<DIDumpType>
 DumpType("debug-dump", cl::init(DIDT_All),
   cl::desc("Dump of debug sections:"),
@@ -102,6 +108,8 @@ static void DumpInput(const StringRef &Filename) {
   std::unique_ptr<ObjectFile> Obj(ObjOrErr.get());
 
   std::unique_ptr<DIContext> DICtx(DIContext::getDWARFContext(Obj.get()));
+  if (NumThreads != 1)
+    DICtx->preload(NumThreads);
 
   if (Address == -1ULL) {
     outs() << Filename
@@ -142,6 +150,10 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm dwarf dumper\n");
 
+  // The debug info is preloaded on several threads.
+  if (NumThreads != 1)
+    llvm_start_multithreaded();
+
   // Defaults to a.out if no filenames specified.
   if (InputFilenames.size() == 0)
     InputFilenames.push_back("a.out");
@@ -54,16 +54,29 @@ static cl::opt<bool>
 SuppressWarnings("suppress-warnings", cl::desc("Suppress all linking warnings"),
                  cl::init(false));
 
+static cl::opt<bool>
+OnlyNeeded("only-needed",
+           cl::desc("Only link in the needed globals of the files after the "
+                    "first one"));
+
+static cl::list<std::string>
+RequiredSymbols("required-symbol",
+                cl::desc("Link in this global even if it is not needed"),
+                cl::value_desc("symbol"));
+
 // LoadFile - Read the specified bitcode file in and return it.  This routine
 // searches the link path for the specified file to try to find it...
 //
+// If Lazy is set, function bodies of bitcode files are only read when the
+// linker needs them.
 static inline Module *LoadFile(const char *argv0, const std::string &FN,
-                               LLVMContext& Context) {
+                               LLVMContext& Context, bool Lazy = false) {
   SMDiagnostic Err;
   if (Verbose) errs() << "Loading '" << FN << "'\n";
   Module* Result = 0;
 
-  Result = ParseIRFile(FN, Err, Context);
+  Result = Lazy ? getLazyIRFileModule(FN, Err, Context)
+                : ParseIRFile(FN, Err, Context);
   if (Result) return Result;   // Load successful!
 
   Err.print(argv0, errs());
@@ -91,8 +104,13 @@ int main(int argc, char **argv) {
   }
 
   Linker L(Composite.get(), SuppressWarnings);
+  L.setLinkOnlyNeeded(OnlyNeeded);
+  for (unsigned i = 0, e = RequiredSymbols.size(); i != e; ++i)
+    L.addRequiredSymbol(RequiredSymbols[i]);
+
   for (unsigned i = BaseArg+1; i < InputFilenames.size(); ++i) {
-    std::unique_ptr<Module> M(LoadFile(argv[0], InputFilenames[i], Context));
+    std::unique_ptr<Module> M(LoadFile(argv[0], InputFilenames[i], Context,
+                                       OnlyNeeded));
     if (M.get() == 0) {
       errs() << argv[0] << ": error loading file '" <<InputFilenames[i]<< "'\n";
       return 1;
@@ -12,15 +12,19 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -37,6 +41,11 @@ static cl::opt<bool>
 DisableGVNLoadPRE("disable-gvn-loadpre", cl::init(false),
   cl::desc("Do not run the GVN load PRE pass"));
 
+static cl::opt<unsigned>
+Parallelism("j", cl::init(1), cl::value_desc("N"),
+  cl::desc("Split the merged module into N partitions and generate code for "
+           "them in parallel, writing partition I to <output>.I"));
+
 static cl::list<std::string>
 InputFilenames(cl::Positional, cl::OneOrMore,
   cl::desc("<input bitcode files>"));
@@ -70,6 +79,10 @@ int main(int argc, char **argv) {
   llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
   cl::ParseCommandLineOptions(argc, argv, "llvm LTO linker\n");
 
+  // The partitions are compiled on threads of their own.
+  if (Parallelism > 1)
+    llvm_start_multithreaded();
+
   // Initialize the configured targets.
   InitializeAllTargets();
   InitializeAllTargetMCs();
@@ -130,7 +143,43 @@ int main(int argc, char **argv) {
   for (unsigned i = 0; i < KeptDSOSyms.size(); ++i)
     CodeGen.addMustPreserveSymbol(KeptDSOSyms[i].c_str());
 
-  if (!OutputFilename.empty()) {
+  if (Parallelism > 1) {
+    CodeGen.setParallelism(Parallelism);
+    std::string ErrorInfo;
+    const char *const *OutputNames;
+    unsigned NumOutputs;
+    if (!CodeGen.compile_to_files(&OutputNames, &NumOutputs, DisableOpt,
+                                  DisableInline, DisableGVNLoadPRE,
+                                  ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo << "\n";
+      return 1;
+    }
+
+    for (unsigned I = 0; I != NumOutputs; ++I) {
+      if (OutputFilename.empty()) {
+        outs() << "Wrote native object file '" << OutputNames[I] << "'\n";
+        continue;
+      }
+      // Copy the object file into place, since the temporary file may be on
+      // another file system.
+      std::string Name = OutputFilename + "." + utostr(I);
+      std::unique_ptr<MemoryBuffer> Buffer;
+      if (error_code EC = MemoryBuffer::getFile(OutputNames[I], Buffer)) {
+        errs() << argv[0] << ": error reading the file '" << OutputNames[I]
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+      raw_fd_ostream FileStream(Name.c_str(), ErrorInfo, sys::fs::F_None);
+      if (!ErrorInfo.empty()) {
+        errs() << argv[0] << ": error opening the file '" << Name
+               << "': " << ErrorInfo << "\n";
+        return 1;
+      }
+      FileStream << Buffer->getBuffer();
+      sys::fs::remove(OutputNames[I]);
+    }
+  } else if (!OutputFilename.empty()) {
     size_t len = 0;
     std::string ErrorInfo;
     const void *Code = CodeGen.compile(&len, DisableOpt, DisableInline,
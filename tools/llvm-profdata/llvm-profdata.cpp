@@ -16,11 +16,16 @@
 #include "llvm/ProfileData/InstrProfWriter.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/LineIterator.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <deque>
 
 using namespace llvm;
 
@@ -32,9 +37,189 @@ static void exitWithError(const Twine &Message, StringRef Whence = "") {
   ::exit(1);
 }
 
+namespace {
+/// The names of the inputs, those named on the command line first, followed
+/// by those listed in the -input-files file. The list is read as the merge
+/// goes, so that it is never held in memory as a whole.
+class InputList {
+  ArrayRef<std::string> Inputs;
+  std::unique_ptr<MemoryBuffer> ListBuffer;
+  line_iterator ListLine;
+
+public:
+  InputList(ArrayRef<std::string> Inputs,
+            std::unique_ptr<MemoryBuffer> ListBuffer)
+      : Inputs(Inputs), ListBuffer(std::move(ListBuffer)) {
+    if (this->ListBuffer)
+      ListLine = line_iterator(*this->ListBuffer, '#');
+  }
+
+  /// Fetch the name of the next input. Returns false once there is none.
+  bool next(std::string &Filename) {
+    if (!Inputs.empty()) {
+      Filename = Inputs.front();
+      Inputs = Inputs.slice(1);
+      return true;
+    }
+    for (; !ListLine.is_at_end(); ++ListLine) {
+      StringRef Name = ListLine->trim();
+      if (Name.empty())
+        continue;
+      Filename = Name;
+      ++ListLine;
+      return true;
+    }
+    return false;
+  }
+};
+
+/// A record of a function which could not be merged, identified by the
+/// index of its input and its position in that input.
+struct MergeWarning {
+  unsigned Input;
+  unsigned Record;
+  std::string Function;
+  error_code Error;
+
+  MergeWarning(unsigned Input, unsigned Record, StringRef Function,
+               error_code Error)
+      : Input(Input), Record(Record), Function(Function), Error(Error) {}
+
+  bool operator<(const MergeWarning &RHS) const {
+    return Input < RHS.Input || (Input == RHS.Input && Record < RHS.Record);
+  }
+};
+
+/// The records of a function with the same hash and number of counters,
+/// summed, along with the inputs and positions they come from.
+struct RecordGroup {
+  uint64_t Hash;
+  std::vector<uint64_t> Counts;
+  std::vector<std::pair<unsigned, unsigned> > Records;
+};
+
+/// A run of consecutive inputs, merged by a single task. A chunk keeps apart
+/// the records of a function which do not match each other, since which of
+/// them are kept depends on the inputs before the chunk.
+struct MergeChunk {
+  unsigned FirstInput;
+  std::vector<std::string> Filenames;
+  /// The record groups of each function, in the order they were first seen.
+  StringMap<std::vector<RecordGroup> > Functions;
+  std::vector<MergeWarning> Warnings;
+  std::string Error;
+  unsigned ErrorInput;
+
+  explicit MergeChunk(unsigned FirstInput) : FirstInput(FirstInput) {}
+
+  const std::string &getFilename(unsigned Input) const {
+    return Filenames[Input - FirstInput];
+  }
+};
+}
+
+/// The number of inputs merged by a task. Whether a record overflows a
+/// counter depends on how the inputs are chunked, so this does not depend on
+/// the number of threads, which keeps the output of every -j the same.
+static const unsigned InputsPerChunk = 8;
+
+/// Add \p Counts to \p Sum, unless that overflows one of the counters.
+static bool addCounts(std::vector<uint64_t> &Sum, ArrayRef<uint64_t> Counts) {
+  for (size_t I = 0, E = Counts.size(); I != E; ++I)
+    if (Sum[I] + Counts[I] < Sum[I])
+      return false;
+  for (size_t I = 0, E = Counts.size(); I != E; ++I)
+    Sum[I] += Counts[I];
+  return true;
+}
+
+static void mergeChunk(MergeChunk &Chunk) {
+  for (unsigned I = 0, E = Chunk.Filenames.size(); I != E; ++I) {
+    unsigned Input = Chunk.FirstInput + I;
+    std::unique_ptr<InstrProfReader> Reader;
+    if (error_code EC = InstrProfReader::create(Chunk.Filenames[I], Reader)) {
+      Chunk.Error = EC.message();
+      Chunk.ErrorInput = Input;
+      return;
+    }
+
+    unsigned Record = 0;
+    for (const auto &R : *Reader) {
+      std::vector<RecordGroup> &Groups = Chunk.Functions[R.Name];
+      std::vector<RecordGroup>::iterator G = Groups.begin(), GE = Groups.end();
+      while (G != GE &&
+             (G->Hash != R.Hash || G->Counts.size() != R.Counts.size()))
+        ++G;
+      if (G == GE) {
+        Groups.push_back(RecordGroup());
+        Groups.back().Hash = R.Hash;
+        Groups.back().Counts = R.Counts;
+        Groups.back().Records.push_back(std::make_pair(Input, Record));
+      } else if (addCounts(G->Counts, R.Counts)) {
+        G->Records.push_back(std::make_pair(Input, Record));
+      } else {
+        Chunk.Warnings.push_back(MergeWarning(
+            Input, Record, R.Name, instrprof_error::counter_overflow));
+      }
+      ++Record;
+    }
+    if (Reader->hasError()) {
+      Chunk.Error = Reader->getError().message();
+      Chunk.ErrorInput = Input;
+      return;
+    }
+  }
+}
+
+/// Fold a merged chunk into \p Writer, which holds the inputs before it, and
+/// report its warnings in input order. Returns false if the chunk hit an error.
+static bool foldChunk(InstrProfWriter &Writer, MergeChunk &Chunk) {
+  for (const auto &F : Chunk.Functions) {
+    for (const RecordGroup &G : F.getValue()) {
+      error_code EC = Writer.addFunctionCounts(F.getKey(), G.Hash, G.Counts);
+      if (!EC)
+        continue;
+      if (EC == instrprof_error::counter_overflow) {
+        // The group overflows once its last record is added.
+        Chunk.Warnings.push_back(MergeWarning(G.Records.back().first,
+                                              G.Records.back().second,
+                                              F.getKey(), EC));
+        continue;
+      }
+      // None of the records match the function as first seen.
+      for (const auto &R : G.Records)
+        Chunk.Warnings.push_back(
+            MergeWarning(R.first, R.second, F.getKey(), EC));
+    }
+  }
+
+  std::sort(Chunk.Warnings.begin(), Chunk.Warnings.end());
+  for (const MergeWarning &W : Chunk.Warnings)
+    errs() << Chunk.getFilename(W.Input) << ": " << W.Function << ": "
+           << W.Error.message() << "\n";
+  return Chunk.Error.empty();
+}
+
+/// Start a chunk with the next inputs of \p Inputs, or return null if there
+/// are none left.
+static MergeChunk *takeChunk(InputList &Inputs, unsigned &NextInput) {
+  std::unique_ptr<MergeChunk> Chunk(new MergeChunk(NextInput));
+  std::string Filename;
+  while (Chunk->Filenames.size() != InputsPerChunk && Inputs.next(Filename))
+    Chunk->Filenames.push_back(Filename);
+  if (Chunk->Filenames.empty())
+    return 0;
+  NextInput += Chunk->Filenames.size();
+  return Chunk.release();
+}
+
 int merge_main(int argc, const char *argv[]) {
-  cl::list<std::string> Inputs(cl::Positional, cl::Required, cl::OneOrMore,
+  cl::list<std::string> Inputs(cl::Positional, cl::ZeroOrMore,
                                cl::desc("<filenames...>"));
+  cl::opt<std::string> InputFilenamesFile(
+      "input-files", cl::value_desc("path"),
+      cl::desc("Path to a file containing the names of further profiles to "
+               "merge, one per line"));
 
   cl::opt<std::string> OutputFilename("output", cl::value_desc("output"),
                                       cl::init("-"),
@@ -42,31 +227,81 @@ int merge_main(int argc, const char *argv[]) {
   cl::alias OutputFilenameA("o", cl::desc("Alias for --output"),
                                  cl::aliasopt(OutputFilename));
 
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(1), cl::value_desc("N"),
+      cl::desc("Number of threads to use for merging (0 = one per core)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
+
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
-  if (OutputFilename.empty())
-    OutputFilename = "-";
+  if (Inputs.empty() && InputFilenamesFile.empty())
+    exitWithError("No input files specified.");
+
+  if (OutputFilename.compare("-") == 0)
+    exitWithError("Cannot write indexed profdata format to stdout.");
+
+  std::unique_ptr<MemoryBuffer> ListBuffer;
+  if (!InputFilenamesFile.empty())
+    if (error_code EC =
+            MemoryBuffer::getFileOrSTDIN(InputFilenamesFile, ListBuffer))
+      exitWithError(EC.message(), InputFilenamesFile);
 
   std::string ErrorInfo;
-  // FIXME: F_Text would be available if line_iterator could accept CRLF.
   raw_fd_ostream Output(OutputFilename.data(), ErrorInfo, sys::fs::F_None);
   if (!ErrorInfo.empty())
     exitWithError(ErrorInfo, OutputFilename);
 
+  // The inputs are merged in chunks, which are folded into the writer in
+  // input order, whatever order the threads finish them in. At most a few
+  // chunks per thread are held at once, however many inputs there are.
+  InputList List(Inputs, std::move(ListBuffer));
   InstrProfWriter Writer;
-  for (const auto &Filename : Inputs) {
-    std::unique_ptr<InstrProfReader> Reader;
-    if (error_code ec = InstrProfReader::create(Filename, Reader))
-      exitWithError(ec.message(), Filename);
-
-    for (const auto &I : *Reader)
-      if (error_code EC = Writer.addFunctionCounts(I.Name, I.Hash, I.Counts))
-        errs() << Filename << ": " << I.Name << ": " << EC.message() << "\n";
-    if (Reader->hasError())
-      exitWithError(Reader->getError().message(), Filename);
+  unsigned NextInput = 0;
+  std::unique_ptr<MergeChunk> Failed;
+  if (NumThreads == 1) {
+    while (MergeChunk *C = takeChunk(List, NextInput)) {
+      std::unique_ptr<MergeChunk> Chunk(C);
+      mergeChunk(*Chunk);
+      if (!foldChunk(Writer, *Chunk)) {
+        Failed = std::move(Chunk);
+        break;
+      }
+    }
+  } else {
+    llvm_start_multithreaded();
+    ThreadPool Pool(NumThreads);
+    const unsigned MaxPending = 2 * Pool.getThreadCount();
+    std::deque<std::unique_ptr<MergeChunk> > Pending;
+    std::deque<std::shared_future<void> > PendingDone;
+    bool MoreInputs = true;
+    while (true) {
+      while (MoreInputs && Pending.size() < MaxPending) {
+        MergeChunk *Chunk = takeChunk(List, NextInput);
+        if (!Chunk) {
+          MoreInputs = false;
+          break;
+        }
+        Pending.emplace_back(Chunk);
+        PendingDone.push_back(Pool.async([Chunk] { mergeChunk(*Chunk); }));
+      }
+      if (Pending.empty())
+        break;
+      PendingDone.front().wait();
+      PendingDone.pop_front();
+      std::unique_ptr<MergeChunk> Chunk = std::move(Pending.front());
+      Pending.pop_front();
+      if (!foldChunk(Writer, *Chunk)) {
+        Failed = std::move(Chunk);
+        break;
+      }
+    }
+    // The pool waits for the chunks still being merged.
   }
-  Writer.write(Output);
+  if (Failed)
+    exitWithError(Failed->Error, Failed->getFilename(Failed->ErrorInput));
 
+  Writer.write(Output);
   return 0;
 }
 
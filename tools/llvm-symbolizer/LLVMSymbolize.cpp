@@ -22,6 +22,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <sstream>
 #include <stdlib.h>
 
@@ -65,6 +66,33 @@ ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
       addSymbol(*si);
     }
   }
+  sortSymbols(Functions);
+  sortSymbols(Objects);
+}
+
+namespace {
+struct CompareSymbolAddr {
+  template <typename EntryT>
+  bool operator()(const EntryT &LHS, const EntryT &RHS) const {
+    return LHS.first < RHS.first;
+  }
+  template <typename EntryT>
+  bool operator()(uint64_t Addr, const EntryT &RHS) const {
+    return Addr < RHS.first.Addr;
+  }
+};
+}
+
+void ModuleInfo::sortSymbols(SymbolMapTy &M) {
+  // Keep the first symbol seen at each address, as the symbol table order
+  // decides which of several aliases is reported.
+  std::stable_sort(M.begin(), M.end(), CompareSymbolAddr());
+  M.erase(std::unique(M.begin(), M.end(),
+                      [](const SymbolMapTy::value_type &LHS,
+                         const SymbolMapTy::value_type &RHS) {
+                        return LHS.first.Addr == RHS.first.Addr;
+                      }),
+          M.end());
 }
 
 void ModuleInfo::addSymbol(const SymbolRef &Symbol) {
@@ -95,7 +123,7 @@ void ModuleInfo::addSymbol(const SymbolRef &Symbol) {
   // with same address size. Make sure we choose the correct one.
   SymbolMapTy &M = SymbolType == SymbolRef::ST_Function ? Functions : Objects;
   SymbolDesc SD = { SymbolAddress, SymbolSize };
-  M.insert(std::make_pair(SD, SymbolName));
+  M.push_back(std::make_pair(SD, SymbolName));
 }
 
 bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
@@ -104,8 +132,8 @@ bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
   const SymbolMapTy &M = Type == SymbolRef::ST_Function ? Functions : Objects;
   if (M.empty())
     return false;
-  SymbolDesc SD = { Address, Address };
-  SymbolMapTy::const_iterator it = M.upper_bound(SD);
+  SymbolMapTy::const_iterator it =
+      std::upper_bound(M.begin(), M.end(), Address, CompareSymbolAddr());
   if (it == M.begin())
     return false;
   --it;
@@ -212,7 +240,12 @@ std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
   return ss.str();
 }
 
+LLVMSymbolizer::ModuleEntry::~ModuleEntry() {
+  delete Info;
+}
+
 void LLVMSymbolizer::flush() {
+  sys::ScopedLock Guard(Lock);
   DeleteContainerSeconds(Modules);
   DeleteContainerPointers(ParsedBinariesAndObjects);
   BinaryForPath.clear();
@@ -303,9 +336,15 @@ static bool getGNUDebuglinkContents(const Binary *Bin, std::string &DebugName,
 
 LLVMSymbolizer::BinaryPair
 LLVMSymbolizer::getOrCreateBinary(const std::string &Path) {
-  BinaryMapTy::iterator I = BinaryForPath.find(Path);
-  if (I != BinaryForPath.end())
-    return I->second;
+  {
+    sys::ScopedLock Guard(Lock);
+    BinaryMapTy::iterator I = BinaryForPath.find(Path);
+    if (I != BinaryForPath.end())
+      return I->second;
+  }
+  // Parse the binaries without holding the lock, and only keep them if no
+  // other thread got there first.
+  SmallVector<Binary*, 2> Parsed;
   Binary *Bin = 0;
   Binary *DbgBin = 0;
   ErrorOr<Binary *> BinaryOrErr = createBinary(Path);
@@ -313,7 +352,7 @@ LLVMSymbolizer::getOrCreateBinary(const std::string &Path) {
     std::unique_ptr<Binary> ParsedBinary(BinaryOrErr.get());
     // Check if it's a universal binary.
     Bin = ParsedBinary.release();
-    ParsedBinariesAndObjects.push_back(Bin);
+    Parsed.push_back(Bin);
     if (Bin->isMachO() || Bin->isMachOUniversalBinary()) {
       // On Darwin we may find DWARF in separate object file in
       // resource directory.
@@ -323,7 +362,7 @@ LLVMSymbolizer::getOrCreateBinary(const std::string &Path) {
       error_code EC = BinaryOrErr.getError();
       if (EC != errc::no_such_file_or_directory && !error(EC)) {
         DbgBin = BinaryOrErr.get();
-        ParsedBinariesAndObjects.push_back(DbgBin);
+        Parsed.push_back(DbgBin);
       }
     }
     // Try to locate the debug binary using .gnu_debuglink section.
@@ -336,7 +375,7 @@ LLVMSymbolizer::getOrCreateBinary(const std::string &Path) {
         BinaryOrErr = createBinary(DebugBinaryPath);
         if (!error(BinaryOrErr.getError())) {
           DbgBin = BinaryOrErr.get();
-          ParsedBinariesAndObjects.push_back(DbgBin);
+          Parsed.push_back(DbgBin);
         }
       }
     }
@@ -344,7 +383,14 @@ LLVMSymbolizer::getOrCreateBinary(const std::string &Path) {
   if (DbgBin == 0)
     DbgBin = Bin;
   BinaryPair Res = std::make_pair(Bin, DbgBin);
-  BinaryForPath[Path] = Res;
+  sys::ScopedLock Guard(Lock);
+  std::pair<BinaryMapTy::iterator, bool> I =
+      BinaryForPath.insert(std::make_pair(Path, Res));
+  if (!I.second) {
+    DeleteContainerPointers(Parsed);
+    return I.first->second;
+  }
+  ParsedBinariesAndObjects.append(Parsed.begin(), Parsed.end());
   return Res;
 }
 
@@ -354,16 +400,24 @@ LLVMSymbolizer::getObjectFileFromBinary(Binary *Bin, const std::string &ArchName
     return 0;
   ObjectFile *Res = 0;
   if (MachOUniversalBinary *UB = dyn_cast<MachOUniversalBinary>(Bin)) {
-    ObjectFileForArchMapTy::iterator I = ObjectFileForArch.find(
-        std::make_pair(UB, ArchName));
-    if (I != ObjectFileForArch.end())
-      return I->second;
-    std::unique_ptr<ObjectFile> ParsedObj;
-    if (!UB->getObjectForArch(Triple(ArchName).getArch(), ParsedObj)) {
-      Res = ParsedObj.release();
-      ParsedBinariesAndObjects.push_back(Res);
+    {
+      sys::ScopedLock Guard(Lock);
+      ObjectFileForArchMapTy::iterator I = ObjectFileForArch.find(
+          std::make_pair(UB, ArchName));
+      if (I != ObjectFileForArch.end())
+        return I->second;
     }
-    ObjectFileForArch[std::make_pair(UB, ArchName)] = Res;
+    std::unique_ptr<ObjectFile> ParsedObj;
+    if (!UB->getObjectForArch(Triple(ArchName).getArch(), ParsedObj))
+      Res = ParsedObj.get();
+    sys::ScopedLock Guard(Lock);
+    std::pair<ObjectFileForArchMapTy::iterator, bool> I =
+        ObjectFileForArch.insert(
+            std::make_pair(std::make_pair(UB, ArchName), Res));
+    if (!I.second)
+      return I.first->second;
+    if (Res)
+      ParsedBinariesAndObjects.push_back(ParsedObj.release());
   } else if (Bin->isObject()) {
     Res = cast<ObjectFile>(Bin);
   }
@@ -372,9 +426,28 @@ LLVMSymbolizer::getObjectFileFromBinary(Binary *Bin, const std::string &ArchName
 
 ModuleInfo *
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  ModuleMapTy::iterator I = Modules.find(ModuleName);
-  if (I != Modules.end())
-    return I->second;
+  ModuleEntry *Entry;
+  {
+    sys::ScopedLock Guard(Lock);
+    ModuleEntry *&E = Modules[ModuleName];
+    if (!E)
+      E = new ModuleEntry();
+    Entry = E;
+  }
+  if (Entry->Loaded.load(std::memory_order_acquire))
+    return Entry->Info;
+
+  // Only the first thread to get here loads the module, the others wait for
+  // it, while the queries on other modules go on.
+  sys::ScopedLock Guard(Entry->LoadLock);
+  if (!Entry->Loaded.load(std::memory_order_relaxed)) {
+    Entry->Info = loadModuleInfo(ModuleName);
+    Entry->Loaded.store(true, std::memory_order_release);
+  }
+  return Entry->Info;
+}
+
+ModuleInfo *LLVMSymbolizer::loadModuleInfo(const std::string &ModuleName) {
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
   size_t ColonPos = ModuleName.find_last_of(':');
@@ -392,14 +465,14 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
 
   if (Obj == 0) {
     // Failed to find valid object file.
-    Modules.insert(make_pair(ModuleName, (ModuleInfo *)0));
     return 0;
   }
   DIContext *Context = DIContext::getDWARFContext(DbgObj);
   assert(Context);
-  ModuleInfo *Info = new ModuleInfo(Obj, Context);
-  Modules.insert(make_pair(ModuleName, Info));
-  return Info;
+  // The context parses lazily, which concurrent queries cannot do.
+  if (Opts.Concurrent)
+    Context->preload(1);
+  return new ModuleInfo(Obj, Context);
 }
 
 std::string LLVMSymbolizer::printDILineInfo(DILineInfo LineInfo) const {
@@ -18,8 +18,11 @@
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include <atomic>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -36,13 +39,16 @@ public:
     bool PrintFunctions : 1;
     bool PrintInlining : 1;
     bool Demangle : 1;
+    // Parse the debug info of a module as it is loaded, so that it can be
+    // queried from several threads without locking.
+    bool Concurrent : 1;
     std::string DefaultArch;
     Options(bool UseSymbolTable = true, bool PrintFunctions = true,
             bool PrintInlining = true, bool Demangle = true,
-            std::string DefaultArch = "")
+            std::string DefaultArch = "", bool Concurrent = false)
         : UseSymbolTable(UseSymbolTable), PrintFunctions(PrintFunctions),
           PrintInlining(PrintInlining), Demangle(Demangle),
-          DefaultArch(DefaultArch) {
+          Concurrent(Concurrent), DefaultArch(DefaultArch) {
     }
   };
 
@@ -52,7 +58,9 @@ public:
   }
 
   // Returns the result of symbolization for module name/offset as
-  // a string (possibly containing newlines).
+  // a string (possibly containing newlines). These may be called from several
+  // threads at once if Options::Concurrent is set; modules are loaded once
+  // and stay cached until flush(), which must not run concurrently with them.
   std::string
   symbolizeCode(const std::string &ModuleName, uint64_t ModuleOffset);
   std::string
@@ -73,8 +81,20 @@ private:
 
   // Owns all the parsed binaries and object files.
   SmallVector<Binary*, 4> ParsedBinariesAndObjects;
-  // Owns module info objects.
-  typedef std::map<std::string, ModuleInfo *> ModuleMapTy;
+  // A module as it is loaded. Modules are loaded outside of Lock, so that
+  // loading one does not hold up the queries on the others, and loaded once,
+  // under LoadLock. Info is only read once Loaded is set.
+  struct ModuleEntry {
+    sys::Mutex LoadLock;
+    std::atomic<bool> Loaded;
+    ModuleInfo *Info;
+    ModuleEntry() : Loaded(false), Info(0) {}
+    ~ModuleEntry();
+  };
+  ModuleInfo *loadModuleInfo(const std::string &ModuleName);
+
+  // Owns module entries.
+  typedef std::map<std::string, ModuleEntry *> ModuleMapTy;
   ModuleMapTy Modules;
   typedef std::map<std::string, BinaryPair> BinaryMapTy;
   BinaryMapTy BinaryForPath;
@@ -82,6 +102,10 @@ private:
       ObjectFileForArchMapTy;
   ObjectFileForArchMapTy ObjectFileForArch;
 
+  // Guards the maps above. Binaries and object files are parsed outside of
+  // it, and only published under it.
+  sys::Mutex Lock;
+
   Options Opts;
   static const char kBadString[];
 };
@@ -103,6 +127,8 @@ private:
                               uint64_t &Size) const;
   void addSymbol(const SymbolRef &Symbol);
   ObjectFile *Module;
+  // Preloaded by the symbolizer when queries may be concurrent, after which
+  // they only read it.
   std::unique_ptr<DIContext> DebugInfoContext;
 
   struct SymbolDesc {
@@ -114,7 +140,10 @@ private:
       return s1.Addr < s2.Addr;
     }
   };
-  typedef std::map<SymbolDesc, StringRef> SymbolMapTy;
+  // Symbols sorted by address, with one entry per address, searched with a
+  // binary search.
+  typedef std::vector<std::pair<SymbolDesc, StringRef> > SymbolMapTy;
+  static void sortSymbols(SymbolMapTy &M);
   SymbolMapTy Functions;
   SymbolMapTy Objects;
 };
@@ -20,8 +20,10 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
 #include <cstring>
@@ -56,15 +58,27 @@ ClBinaryName("obj", cl::init(""),
              cl::desc("Path to object file to be symbolized (if not provided, "
                       "object file should be specified for each input line)"));
 
-static bool parseCommand(bool &IsData, std::string &ModuleName,
-                         uint64_t &ModuleOffset) {
+static cl::opt<bool>
+ClBatch("batch", cl::init(false),
+        cl::desc("Read requests up to an empty line or the end of input, "
+                 "symbolize them in parallel and print the results in order"));
+
+static cl::opt<unsigned>
+ClNumThreads("num-threads", cl::init(0),
+             cl::desc("Number of threads to use in batch mode "
+                      "(0 = one per core)"));
+
+static const int kMaxInputStringLength = 1024;
+
+static bool readLine(char *InputString) {
+  return fgets(InputString, kMaxInputStringLength, stdin) != 0;
+}
+
+static bool parseCommand(char *InputString, bool &IsData,
+                         std::string &ModuleName, uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
   const char *kCodeCmd = "CODE ";
-  const int kMaxInputStringLength = 1024;
   const char kDelimiters[] = " \n";
-  char InputString[kMaxInputStringLength];
-  if (!fgets(InputString, sizeof(InputString), stdin))
-    return false;
   IsData = false;
   ModuleName = "";
   char *pos = InputString;
@@ -113,13 +127,60 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm-symbolizer\n");
   LLVMSymbolizer::Options Opts(ClUseSymbolTable, ClPrintFunctions,
-                               ClPrintInlining, ClDemangle, ClDefaultArch);
+                               ClPrintInlining, ClDemangle, ClDefaultArch,
+                               ClBatch);
   LLVMSymbolizer Symbolizer(Opts);
 
+  if (ClBatch) {
+    llvm_start_multithreaded();
+    ThreadPool Pool(ClNumThreads);
+    char InputString[kMaxInputStringLength];
+    bool AtEnd = false;
+    while (!AtEnd) {
+      // Collect one request, that is the lines up to an empty line.
+      std::vector<std::string> Lines;
+      while (true) {
+        if (!readLine(InputString)) {
+          AtEnd = true;
+          break;
+        }
+        if (StringRef(InputString).trim().empty())
+          break;
+        Lines.push_back(InputString);
+      }
+      if (Lines.empty())
+        continue;
+
+      std::vector<std::string> Results(Lines.size());
+      std::vector<unsigned> Indices(Lines.size());
+      for (unsigned I = 0, E = Lines.size(); I != E; ++I)
+        Indices[I] = I;
+      parallel_for_each(Pool, Indices.begin(), Indices.end(), [&](unsigned I) {
+        bool IsData = false;
+        std::string ModuleName;
+        uint64_t ModuleOffset;
+        if (!parseCommand(&Lines[I][0], IsData, ModuleName, ModuleOffset))
+          return;
+        Results[I] = IsData
+                         ? Symbolizer.symbolizeData(ModuleName, ModuleOffset)
+                         : Symbolizer.symbolizeCode(ModuleName, ModuleOffset);
+      });
+
+      // Lines that could not be parsed get an empty answer, so that the
+      // answers still line up with the requests.
+      for (const std::string &Result : Results)
+        outs() << Result << "\n";
+      outs().flush();
+    }
+    return 0;
+  }
+
   bool IsData = false;
   std::string ModuleName;
   uint64_t ModuleOffset;
-  while (parseCommand(IsData, ModuleName, ModuleOffset)) {
+  char InputString[kMaxInputStringLength];
+  while (readLine(InputString) &&
+         parseCommand(InputString, IsData, ModuleName, ModuleOffset)) {
     std::string Result =
         IsData ? Symbolizer.symbolizeData(ModuleName, ModuleOffset)
                : Symbolizer.symbolizeCode(ModuleName, ModuleOffset);
@@ -18,6 +18,7 @@
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
+#include "llvm/Support/Threading.h"
 
 // extra command-line flags needed for LTOCodeGenerator
 static cl::opt<bool>
@@ -317,6 +318,27 @@ bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
                               sLastErrorString);
 }
 
+/// lto_codegen_set_parallelism - Sets the number of partitions that
+/// lto_codegen_compile_to_files() compiles in parallel.
+void lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned parallelism) {
+  if (parallelism > 1 && !llvm_is_multithreaded())
+    llvm_start_multithreaded();
+  cg->setParallelism(parallelism);
+}
+
+/// lto_codegen_compile_to_files - Generates code for all added modules into
+/// one native object file per partition. The names of the files are written to
+/// names. Returns true on error.
+bool lto_codegen_compile_to_files(lto_code_gen_t cg, const char *const **names,
+                                  unsigned *num_names) {
+  if (!parsedOptions) {
+    cg->parseCodeGenDebugOptions();
+    parsedOptions = true;
+  }
+  return !cg->compile_to_files(names, num_names, DisableOpt, DisableInline,
+                               DisableGVNLoadPRE, sLastErrorString);
+}
+
 /// lto_codegen_debug_options - Used to pass extra options to the code
 /// generator.
 void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {
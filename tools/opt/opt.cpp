@@ -36,6 +36,7 @@
 #include "llvm/PassManager.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
@@ -43,6 +44,7 @@
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
@@ -184,6 +186,17 @@ DefaultDataLayout("default-data-layout",
           cl::desc("data layout string to use if not specified by module"),
           cl::value_desc("layout-string"), cl::init(""));
 
+static cl::opt<std::string>
+TimeTraceFile("time-trace-file", cl::value_desc("filename"),
+              cl::desc("Write a Chrome trace of the time taken by each pass "
+                       "run and code generation phase to this file"));
+
+static cl::opt<unsigned>
+TimeTraceGranularity("time-trace-granularity", cl::init(500u),
+                     cl::value_desc("us"),
+                     cl::desc("Leave the events shorter than this number of "
+                              "microseconds out of the time trace"));
+
 
 
 static inline void addPass(PassManagerBase &PM, Pass *P) {
@@ -356,6 +369,9 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (!TimeTraceFile.empty())
+    timeTraceProfilerInitialize(TimeTraceGranularity);
+
   SMDiagnostic Err;
 
   // Load the input module...
@@ -617,6 +633,16 @@ int main(int argc, char **argv) {
   // Now that we have all of the passes ready, run them.
   Passes.run(*M.get());
 
+  if (!TimeTraceFile.empty()) {
+    std::string ErrorInfo;
+    if (!timeTraceProfilerWrite(TimeTraceFile, sys::path::filename(argv[0]),
+                                ErrorInfo)) {
+      errs() << argv[0] << ": " << ErrorInfo << '\n';
+      return 1;
+    }
+    timeTraceProfilerCleanup();
+  }
+
   // Declare success.
   if (!NoOutput || PrintBreakpoints)
     Out->keep();
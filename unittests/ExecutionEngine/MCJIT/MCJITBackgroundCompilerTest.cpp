@@ -0,0 +1,136 @@
+//===- MCJITBackgroundCompilerTest.cpp - Unit tests for BackgroundCompiler ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "MCJITTestBase.h"
+#include "llvm/ExecutionEngine/BackgroundCompiler.h"
+#include "llvm/Support/Threading.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class MCJITBackgroundCompilerTest : public testing::Test, public MCJITTestBase {
+protected:
+  virtual void SetUp() {
+    // The compiler generates code on a thread of its own.
+    if (!llvm_is_multithreaded())
+      llvm_start_multithreaded();
+    M.reset(createEmptyModule("<main>"));
+  }
+
+  /// Create the engine for M and a compiler adding M to it.
+  void createJITAndCompiler() {
+    Module *Mod = M.release();
+    createJIT(Mod);
+    Compiler.reset(new BackgroundCompiler(*TheJIT, CodeGenOpt::Default));
+    Compiler->addModule(Mod);
+  }
+
+  /// Return the address the slot of \p Name points to.
+  uint64_t readSlot(StringRef Name) {
+    uint64_t Slot = TheJIT->getGlobalValueAddress(Name.str() + ".slot");
+    EXPECT_TRUE(0 != Slot);
+    return *reinterpret_cast<uintptr_t *>(Slot);
+  }
+
+  void TearDown() override {
+    // The compiler must go before the engine.
+    Compiler.reset();
+  }
+
+  std::unique_ptr<BackgroundCompiler> Compiler;
+};
+
+TEST_F(MCJITBackgroundCompilerTest, StubsCallTheFirstCode) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *Add = insertAddFunction(M.get());
+  Function *Caller =
+      insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), Add);
+  createJITAndCompiler();
+  EXPECT_TRUE(Compiler->hasStub(Add));
+  EXPECT_TRUE(Compiler->hasStub(Caller));
+
+  int (*CallerPtr)(int, int) =
+      (int (*)(int, int))TheJIT->getFunctionAddress("caller");
+  ASSERT_TRUE(0 != CallerPtr);
+  EXPECT_EQ(5, CallerPtr(2, 3));
+  EXPECT_EQ(TheJIT->getFunctionAddress("add.tier0"), readSlot("add"));
+  EXPECT_FALSE(Compiler->isOptimized(Add));
+}
+
+TEST_F(MCJITBackgroundCompilerTest, OptimizedCodeReplacesStubs) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *Accumulate = insertAccumulateFunction(M.get());
+  createJITAndCompiler();
+
+  int (*AccumulatePtr)(int) =
+      (int (*)(int))TheJIT->getFunctionAddress("accumulate");
+  ASSERT_TRUE(0 != AccumulatePtr);
+  EXPECT_EQ(55, AccumulatePtr(10));
+
+  Compiler->optimizeModule(Accumulate->getParent());
+  Compiler->wait();
+  EXPECT_TRUE(Compiler->isOptimized(Accumulate));
+  EXPECT_EQ(TheJIT->getFunctionAddress("accumulate.tier1"),
+            readSlot("accumulate"));
+  EXPECT_EQ(55, AccumulatePtr(10));
+  EXPECT_EQ(5050, AccumulatePtr(100));
+}
+
+TEST_F(MCJITBackgroundCompilerTest, OptimizeModuleBatchesCallers) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // The accumulator comes between the two functions calling each other.
+  Function *Add = insertAddFunction(M.get());
+  Function *Accumulate = insertAccumulateFunction(M.get());
+  Function *Caller =
+      insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), Add);
+  createJITAndCompiler();
+
+  int (*CallerPtr)(int, int) =
+      (int (*)(int, int))TheJIT->getFunctionAddress("caller");
+  ASSERT_TRUE(0 != CallerPtr);
+  Compiler->optimizeModule(Caller->getParent());
+  Compiler->wait();
+  EXPECT_TRUE(Compiler->isOptimized(Add));
+  EXPECT_TRUE(Compiler->isOptimized(Accumulate));
+  EXPECT_TRUE(Compiler->isOptimized(Caller));
+  EXPECT_EQ(TheJIT->getFunctionAddress("caller.tier1"), readSlot("caller"));
+  EXPECT_EQ(5, CallerPtr(2, 3));
+}
+
+TEST_F(MCJITBackgroundCompilerTest, OptimizedCodeSharesGlobals) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // int32_t count() { return ++Counter; } with an internal Counter.
+  GlobalVariable *Counter = insertGlobalInt32(M.get(), "counter", 0);
+  Counter->setLinkage(GlobalValue::InternalLinkage);
+  Function *Count = startFunction<int32_t(void)>(M.get(), "count");
+  Value *Next = Builder.CreateAdd(Builder.CreateLoad(Counter),
+                                  ConstantInt::get(Context, APInt(32, 1)));
+  Builder.CreateStore(Next, Counter);
+  endFunctionWithRet(Count, Next);
+  createJITAndCompiler();
+
+  int (*CountPtr)() = (int (*)())TheJIT->getFunctionAddress("count");
+  ASSERT_TRUE(0 != CountPtr);
+  EXPECT_EQ(1, CountPtr());
+  EXPECT_EQ(2, CountPtr());
+
+  EXPECT_TRUE(Compiler->optimizeFunction(Count));
+  Compiler->wait();
+  EXPECT_TRUE(Compiler->isOptimized(Count));
+  EXPECT_EQ(3, CountPtr());
+  EXPECT_EQ(4, CountPtr());
+}
+
+}
@@ -9,7 +9,11 @@
 
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/ExecutionEngine/SectionMemoryPool.h"
+#include "llvm/Support/Process.h"
 #include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
 
 using namespace llvm;
 
@@ -167,5 +171,122 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, PooledMemoryIsReused) {
+  SectionMemoryPool Pool;
+  std::unique_ptr<SectionMemoryManager> MemMgr(new SectionMemoryManager(Pool));
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 2, "", true);
+  EXPECT_NE((uint8_t*)0, code1);
+  EXPECT_NE((uint8_t*)0, data1);
+  code1[0] = 1;
+  data1[0] = 2;
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  // Code and data come from slabs of their own.
+  size_t CodeSize = Pool.getMappedSize(SectionMemoryPool::Code);
+  size_t DataSize = Pool.getMappedSize(SectionMemoryPool::Data);
+  EXPECT_NE(0u, CodeSize);
+  EXPECT_NE(0u, DataSize);
+  EXPECT_GT(CodeSize, Pool.getFreeSize(SectionMemoryPool::Code));
+
+  // Once the manager is gone, the next one gets the same memory back, and can
+  // write to it again.
+  MemMgr.reset(new SectionMemoryManager(Pool));
+  EXPECT_EQ(CodeSize, Pool.getFreeSize(SectionMemoryPool::Code));
+  EXPECT_EQ(DataSize, Pool.getFreeSize(SectionMemoryPool::Data));
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data2 = MemMgr->allocateDataSection(256, 0, 2, "", true);
+  EXPECT_EQ(code1, code2);
+  EXPECT_EQ(data1, data2);
+  code2[0] = 3;
+  data2[0] = 4;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  EXPECT_EQ(CodeSize, Pool.getMappedSize(SectionMemoryPool::Code));
+  EXPECT_EQ(DataSize, Pool.getMappedSize(SectionMemoryPool::Data));
+}
+
+TEST(MCJITMemoryManagerTest, PooledCodeIsContiguous) {
+  size_t PageSize = sys::process::get_self()->page_size();
+  SectionMemoryPool Pool(64 * PageSize);
+  std::unique_ptr<SectionMemoryManager> MemMgrs[3];
+  uint8_t *Code[3];
+  for (unsigned i = 0; i != 3; ++i) {
+    MemMgrs[i].reset(new SectionMemoryManager(Pool));
+    Code[i] = MemMgrs[i]->allocateCodeSection(PageSize / 2, 0, 1, "");
+    MemMgrs[i]->allocateDataSection(PageSize / 2, 0, 2, "", false);
+  }
+
+  // The code of the modules is packed page after page, without data between.
+  EXPECT_EQ(Code[0] + PageSize, Code[1]);
+  EXPECT_EQ(Code[1] + PageSize, Code[2]);
+
+  // Freed blocks merge, and are reused from the lowest address.
+  MemMgrs[1].reset();
+  MemMgrs[0].reset();
+  MemMgrs[0].reset(new SectionMemoryManager(Pool));
+  EXPECT_EQ(Code[0], MemMgrs[0]->allocateCodeSection(PageSize + 1, 0, 1, ""));
+  EXPECT_EQ(64 * PageSize, Pool.getMappedSize(SectionMemoryPool::Code));
+}
+
+TEST(MCJITMemoryManagerTest, PooledLargeAllocations) {
+  SectionMemoryPool Pool(2 * 1024 * 1024, /*UseHugePages=*/true);
+  std::unique_ptr<SectionMemoryManager> MemMgr(new SectionMemoryManager(Pool));
+
+  // Sections larger than a slab get slabs of their own.
+  uint8_t *code1 = MemMgr->allocateCodeSection(0x300000, 0, 1, "");
+  uint8_t *code2 = MemMgr->allocateCodeSection(0x100, 0, 2, "");
+  EXPECT_NE((uint8_t*)0, code1);
+  EXPECT_NE((uint8_t*)0, code2);
+  code1[0x2fffff] = 1;
+  code2[0xff] = 2;
+  EXPECT_EQ(1, code1[0x2fffff]);
+  EXPECT_EQ(2, code2[0xff]);
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+}
+
+#ifdef __linux__
+// Return the permissions of the mapping of the process holding the whole of
+// [Begin, End), or an empty string if no single mapping does.
+static std::string getMappingPermissions(uintptr_t Begin, uintptr_t End) {
+  std::ifstream Maps("/proc/self/maps");
+  std::string Line;
+  while (std::getline(Maps, Line)) {
+    unsigned long long Start, Stop;
+    char Perms[5];
+    if (sscanf(Line.c_str(), "%llx-%llx %4s", &Start, &Stop, Perms) != 3)
+      continue;
+    if (Start <= Begin && End <= Stop)
+      return Perms;
+  }
+  return "";
+}
+
+TEST(MCJITMemoryManagerTest, PooledHugePageCodeKeepsOneMapping) {
+  const size_t SlabSize = 2 * 1024 * 1024;
+  SectionMemoryPool Pool(SlabSize, /*UseHugePages=*/true);
+  std::unique_ptr<SectionMemoryManager> MemMgr(new SectionMemoryManager(Pool));
+  EXPECT_TRUE(Pool.keepsCodeWritable());
+
+  // The first block of a slab starts it, and the slab is a single mapping,
+  // whose protection finalizing and releasing code leave alone, lest the huge
+  // page backing it be split.
+  uint8_t *Code = MemMgr->allocateCodeSection(0x100, 0, 1, "");
+  ASSERT_NE((uint8_t*)0, Code);
+  uintptr_t Slab = (uintptr_t)Code;
+  EXPECT_EQ("rwxp", getMappingPermissions(Slab, Slab + SlabSize));
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  EXPECT_EQ("rwxp", getMappingPermissions(Slab, Slab + SlabSize));
+
+  MemMgr.reset();
+  EXPECT_EQ("rwxp", getMappingPermissions(Slab, Slab + SlabSize));
+}
+#endif
+
 } // Namespace
 
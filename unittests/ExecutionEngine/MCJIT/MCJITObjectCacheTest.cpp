@@ -11,10 +11,13 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/ExecutionEngine/DiskObjectCache.h"
 #include "llvm/ExecutionEngine/JIT.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -85,6 +88,21 @@ private:
   bool                            DuplicateInserted;
 };
 
+/// A DiskObjectCache counting the objects compiled by MCJIT.
+class CountingDiskObjectCache : public DiskObjectCache {
+public:
+  CountingDiskObjectCache(StringRef Dir, const TargetMachine &TM,
+                          uint64_t MaxSize = 0)
+    : DiskObjectCache(Dir, TM, MaxSize), NumCompiled(0) { }
+
+  void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj) override {
+    ++NumCompiled;
+    DiskObjectCache::notifyObjectCompiled(M, Obj);
+  }
+
+  unsigned NumCompiled;
+};
+
 class MCJITObjectCacheTest : public testing::Test, public MCJITTestBase {
 protected:
 
@@ -118,6 +136,51 @@ protected:
   Function *Main;
 };
 
+class MCJITDiskObjectCacheTest : public MCJITObjectCacheTest {
+protected:
+  virtual void SetUp() {
+    MCJITObjectCacheTest::SetUp();
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("disk-object-cache", Dir));
+  }
+
+  virtual void TearDown() {
+    error_code EC;
+    for (sys::fs::directory_iterator I(Dir.str(), EC), E; I != E && !EC;
+         I.increment(EC))
+      sys::fs::remove(I->path());
+    sys::fs::remove(Dir.str());
+  }
+
+  /// Create an engine for a new module returning \p RC from main, and a
+  /// cache for it of at most \p MaxSize bytes.
+  void createJITAndCache(int RC, uint64_t MaxSize = 0) {
+    if (TheJIT) {
+      TheJIT.reset();
+      MM = new SectionMemoryManager;
+      M.reset(createEmptyModule("<main>"));
+      Main = insertMainFunction(M.get(), RC);
+    }
+    createJIT(M.release());
+    Cache.reset(new CountingDiskObjectCache(Dir.str(),
+                                            *TheJIT->getTargetMachine(),
+                                            MaxSize));
+    TheJIT->setObjectCache(Cache.get());
+  }
+
+  unsigned countObjects() {
+    unsigned Count = 0;
+    error_code EC;
+    for (sys::fs::directory_iterator I(Dir.str(), EC), E; I != E && !EC;
+         I.increment(EC))
+      if (sys::path::extension(I->path()) == ".o")
+        ++Count;
+    return Count;
+  }
+
+  SmallString<128> Dir;
+  std::unique_ptr<CountingDiskObjectCache> Cache;
+};
+
 TEST_F(MCJITObjectCacheTest, SetNullObjectCache) {
   SKIP_UNSUPPORTED_PLATFORM;
 
@@ -237,5 +300,60 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
+TEST_F(MCJITDiskObjectCacheTest, LoadFromDisk) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  createJITAndCache(OriginalRC);
+  std::string Path = Cache->getObjectPath(Main->getParent());
+  compileAndRun();
+  EXPECT_EQ(1u, Cache->NumCompiled);
+  EXPECT_TRUE(sys::fs::exists(Path));
+
+  // An identical module in another engine, with a new cache on the same
+  // directory, is loaded instead of compiled.
+  createJITAndCache(OriginalRC);
+  EXPECT_EQ(Path, Cache->getObjectPath(Main->getParent()));
+  compileAndRun();
+  EXPECT_EQ(0u, Cache->NumCompiled);
+  EXPECT_EQ(1u, countObjects());
+}
+
+TEST_F(MCJITDiskObjectCacheTest, ChangedModuleIsCompiled) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  createJITAndCache(OriginalRC);
+  compileAndRun();
+
+  // A module with the same name but another body gets its own object.
+  createJITAndCache(ReplacementRC);
+  compileAndRun(ReplacementRC);
+  EXPECT_EQ(1u, Cache->NumCompiled);
+  EXPECT_EQ(2u, countObjects());
+}
+
+TEST_F(MCJITDiskObjectCacheTest, EvictLeastRecentlyUsed) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  createJITAndCache(OriginalRC);
+  std::string OldPath = Cache->getObjectPath(Main->getParent());
+  compileAndRun();
+  uint64_t Size;
+  ASSERT_FALSE(sys::fs::file_size(OldPath, Size));
+
+  // Make the first object older than any other.
+  int FD;
+  ASSERT_FALSE(sys::fs::openFileForWrite(OldPath, FD, sys::fs::F_Append));
+  sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue(1000, 0));
+  raw_fd_ostream(FD, true);
+
+  // The cache has room for one object of that size only.
+  createJITAndCache(ReplacementRC, Size + Size / 2);
+  std::string NewPath = Cache->getObjectPath(Main->getParent());
+  compileAndRun(ReplacementRC);
+  EXPECT_FALSE(sys::fs::exists(OldPath));
+  EXPECT_TRUE(sys::fs::exists(NewPath));
+  EXPECT_EQ(1u, countObjects());
+}
+
 } // Namespace
 
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/SectionMemoryPool.h"
 #include "MCJITTestBase.h"
 #include "gtest/gtest.h"
 
@@ -187,4 +188,29 @@ TEST_F(MCJITTest, multiple_functions) {
 
 #endif /*!defined(__arm__)*/
 
+TEST_F(MCJITTest, engines_share_memory_pool) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // Compile and discard modules, each with an engine of its own.
+  SectionMemoryPool Pool;
+  delete MM;
+  size_t CodeSize = 0;
+  for (int i = 0; i != 10; ++i) {
+    Function *F = insertAddFunction(M.get());
+    MM = new SectionMemoryManager(Pool);
+    createJIT(M.release());
+    int (*AddPtr)(int, int) =
+      (int (*)(int, int))TheJIT->getFunctionAddress(F->getName().str());
+    ASSERT_TRUE(AddPtr != 0);
+    EXPECT_EQ(i + 1, AddPtr(i, 1));
+    TheJIT.reset();
+
+    if (i == 0)
+      CodeSize = Pool.getMappedSize(SectionMemoryPool::Code);
+    EXPECT_EQ(CodeSize, Pool.getMappedSize(SectionMemoryPool::Code));
+    EXPECT_EQ(CodeSize, Pool.getFreeSize(SectionMemoryPool::Code));
+    M.reset(createEmptyModule("<main>"));
+  }
+}
+
 }
@@ -0,0 +1,138 @@
+//===- MCJITTieredTest.cpp - Unit tests for tiered execution --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "MCJITTestBase.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/Interpreter.h"
+#include "llvm/ExecutionEngine/TierListener.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+/// RecordingListener - Remember the tier transitions of the engine.
+class RecordingListener : public TierListener {
+public:
+  std::vector<std::string> Promoted;
+  std::vector<uint64_t> Calls;
+  std::vector<std::string> Failed;
+
+  void notifyFunctionPromoted(const Function &F, uint64_t NumCalls,
+                              uint64_t BackEdges) override {
+    Promoted.push_back(F.getName());
+    Calls.push_back(NumCalls);
+  }
+
+  void notifyPromotionFailed(const Function &F, StringRef Reason) override {
+    Failed.push_back(F.getName());
+  }
+};
+
+class MCJITTieredTest : public testing::Test, public MCJITTestBase {
+protected:
+  virtual void SetUp() {
+    M.reset(createEmptyModule("<main>"));
+  }
+
+  /// Create a tiered engine for M, compiling functions called \p Threshold
+  /// times.
+  void createTieredEngine(unsigned Threshold) {
+    // The compiling engine has a memory manager of its own.
+    delete MM;
+    MM = 0;
+
+    std::string Error;
+    TheJIT.reset(EngineBuilder(M.release())
+                 .setEngineKind(EngineKind::Either)
+                 .setUseMCJIT(true)
+                 .setTierUpThreshold(Threshold)
+                 .setErrorStr(&Error)
+                 .setMCPU(sys::getHostCPUName())
+                 .create());
+    ASSERT_TRUE(TheJIT.get() != 0) << Error;
+    TheJIT->setTierListener(&Listener);
+  }
+
+  int32_t run(Function *F, int32_t Arg) {
+    std::vector<GenericValue> Args(1);
+    Args[0].IntVal = APInt(32, Arg);
+    return TheJIT->runFunction(F, Args).IntVal.getSExtValue();
+  }
+
+  RecordingListener Listener;
+};
+
+TEST_F(MCJITTieredTest, HotFunctionsRunCompiledCode) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *Accumulate = insertAccumulateFunction(M.get());
+  createTieredEngine(20);
+
+  // accumulate(5) calls accumulate 6 times, so that it gets hot during the
+  // fourth run.
+  EXPECT_EQ(15, run(Accumulate, 5));
+  EXPECT_EQ(15, run(Accumulate, 5));
+  EXPECT_EQ(15, run(Accumulate, 5));
+  EXPECT_TRUE(Listener.Promoted.empty());
+  EXPECT_EQ(5050, run(Accumulate, 100));
+  ASSERT_EQ(1u, Listener.Promoted.size());
+  EXPECT_EQ("accumulate", Listener.Promoted[0]);
+  EXPECT_EQ(20u, Listener.Calls[0]);
+  EXPECT_EQ(5050, run(Accumulate, 100));
+  EXPECT_TRUE(Listener.Failed.empty());
+}
+
+TEST_F(MCJITTieredTest, CompiledCodeSharesGlobals) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // int32_t count(int32_t N) { return Counter += N; } with an internal
+  // Counter.
+  GlobalVariable *Counter = insertGlobalInt32(M.get(), "counter", 0);
+  Counter->setLinkage(GlobalValue::InternalLinkage);
+  Function *Count = startFunction<int32_t(int32_t)>(M.get(), "count");
+  Value *Next = Builder.CreateAdd(Builder.CreateLoad(Counter),
+                                  Count->arg_begin());
+  Builder.CreateStore(Next, Counter);
+  endFunctionWithRet(Count, Next);
+  createTieredEngine(2);
+
+  EXPECT_EQ(1, run(Count, 1));
+  EXPECT_EQ(3, run(Count, 2));
+  EXPECT_EQ(1u, Listener.Promoted.size());
+  EXPECT_EQ(6, run(Count, 3));
+  int32_t *CounterPtr = (int32_t *)TheJIT->getPointerToGlobal(Counter);
+  EXPECT_EQ(6, *CounterPtr);
+}
+
+TEST_F(MCJITTieredTest, CallersOfFunctionAddressesStayInterpreted) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // int32_t caller(int32_t N) { Fn = accumulate; return accumulate(N); }
+  Function *Accumulate = insertAccumulateFunction(M.get());
+  GlobalVariable *Fn = new GlobalVariable(
+      *M, Accumulate->getType(), false, GlobalValue::InternalLinkage,
+      Constant::getNullValue(Accumulate->getType()), "fn");
+  Function *Caller = startFunction<int32_t(int32_t)>(M.get(), "caller");
+  Builder.CreateStore(Accumulate, Fn);
+  endFunctionWithRet(Caller,
+                     Builder.CreateCall(Accumulate, Caller->arg_begin()));
+  createTieredEngine(2);
+
+  EXPECT_EQ(3, run(Caller, 2));
+  EXPECT_EQ(6, run(Caller, 3));
+  EXPECT_EQ(10, run(Caller, 4));
+  ASSERT_EQ(1u, Listener.Failed.size());
+  EXPECT_EQ("caller", Listener.Failed[0]);
+  // Accumulate got hot on its own.
+  ASSERT_EQ(1u, Listener.Promoted.size());
+  EXPECT_EQ("accumulate", Listener.Promoted[0]);
+}
+
+}
@@ -0,0 +1,341 @@
+//===- llvm/unittest/IR/ConcurrentUniquingTest.cpp - Concurrent uniquing --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/PassManager.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "gtest/gtest.h"
+#include <memory>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+const unsigned NumTasks = 8;
+const unsigned NumValues = 256;
+
+/// The tests use a context from the threads of a pool, which requires LLVM to
+/// be in multithreaded mode. It is entered once for all the tests.
+void startMultithreaded() {
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+}
+
+/// The values a task created for one number, compared between tasks.
+struct CreatedValues {
+  Type *IntTy;
+  Type *ArrayTy;
+  Constant *Int;
+  Constant *FP;
+  Constant *Array;
+  Constant *Expr;
+  MDString *Str;
+  MDNode *Node;
+  void *Attrs;
+
+  bool operator==(const CreatedValues &RHS) const {
+    return IntTy == RHS.IntTy && ArrayTy == RHS.ArrayTy && Int == RHS.Int &&
+           FP == RHS.FP && Array == RHS.Array && Expr == RHS.Expr &&
+           Str == RHS.Str && Node == RHS.Node && Attrs == RHS.Attrs;
+  }
+};
+
+/// Create the values of every number, starting from a different number in
+/// each task so that the tasks race to create each value first.
+void createValues(LLVMContext &C, unsigned Task,
+                  std::vector<CreatedValues> &Out) {
+  IntegerType *Int32Ty = Type::getInt32Ty(C);
+  for (unsigned I = 0; I != NumValues; ++I) {
+    unsigned N = (I + Task * 37) % NumValues;
+    CreatedValues &V = Out[N];
+    V.IntTy = IntegerType::get(C, 1 + N % 100);
+    V.ArrayTy = ArrayType::get(Int32Ty, N);
+    V.Int = ConstantInt::get(Int32Ty, N);
+    V.FP = ConstantFP::get(Type::getDoubleTy(C), N);
+    Constant *Elts[] = { V.Int, ConstantInt::get(Int32Ty, N + 1) };
+    V.Array = ConstantArray::get(ArrayType::get(Int32Ty, 2), Elts);
+    V.Expr = ConstantExpr::getAdd(V.Int, Elts[1]);
+    V.Str = MDString::get(C, Twine(N).str());
+    Value *Ops[] = { V.Str, V.Int };
+    V.Node = MDNode::get(C, Ops);
+    AttrBuilder B;
+    B.addAlignmentAttr(1ULL << (N % 16));
+    V.Attrs = AttributeSet::get(C, 1 + N % 4, B).getRawPointer();
+  }
+}
+
+/// Return how many times a thread had to wait for a use list lock.  This is
+/// only counted if the statistics were enabled before the first wait.
+unsigned getUseListLockWaits() {
+  std::string CSV;
+  raw_string_ostream OS(CSV);
+  PrintStatisticsCSV(OS);
+  StringRef Row = "uniquing,Number of use list locks waited for,";
+  StringRef Stats = OS.str();
+  size_t Pos = Stats.find(Row);
+  unsigned Waits = 0;
+  if (Pos != StringRef::npos)
+    Stats.substr(Pos + Row.size()).split('\n').first.getAsInteger(10, Waits);
+  return Waits;
+}
+
+/// Add uses of the same global and constants to a function, and erase half
+/// of them again.
+void useSharedValues(Function *F, GlobalVariable *G) {
+  Type *Int32Ty = Type::getInt32Ty(F->getContext());
+  Instruction *Ret = F->getEntryBlock().getTerminator();
+  std::vector<Instruction *> Stores;
+  for (unsigned I = 0; I != NumValues; ++I)
+    Stores.push_back(new StoreInst(ConstantInt::get(Int32Ty, I % 4), G, Ret));
+  for (unsigned I = 0; I < NumValues; I += 2)
+    Stores[I]->eraseFromParent();
+}
+
+/// Run useSharedValues on a new function of the module in each task, and
+/// return the wall time it took.
+double runSharedUseTasks(Module &M, GlobalVariable *G, unsigned ThreadCount) {
+  LLVMContext &C = M.getContext();
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(C), false);
+  std::vector<Function *> Functions;
+  for (unsigned T = 0; T != NumTasks; ++T) {
+    Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage, "f", &M);
+    ReturnInst::Create(C, BasicBlock::Create(C, "entry", F));
+    Functions.push_back(F);
+  }
+
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  {
+    ThreadPool Pool(ThreadCount);
+    for (unsigned T = 0; T != NumTasks; ++T) {
+      Function *F = Functions[T];
+      Pool.async([F, G] {
+        for (unsigned Round = 0; Round != 16; ++Round)
+          useSharedValues(F, G);
+      });
+    }
+    Pool.wait();
+  }
+  return TimeRecord::getCurrentTime(false).getWallTime() - Start.getWallTime();
+}
+
+// This test comes first so that it enables the statistics before any thread
+// waits for a use list lock.
+TEST(ConcurrentUniquingTest, SharedUsesFromManyThreads) {
+  startMultithreaded();
+  EnableStatistics();
+  LLVMContext C;
+  C.enableConcurrentUniquing();
+  Module M("shared-uses", C);
+  Type *Int32Ty = Type::getInt32Ty(C);
+  GlobalVariable *G = new GlobalVariable(M, Int32Ty, false,
+                                         GlobalValue::ExternalLinkage, 0, "g");
+
+  // A single thread never waits.
+  unsigned WaitsBefore = getUseListLockWaits();
+  double SequentialTime = runSharedUseTasks(M, G, 1);
+  EXPECT_EQ(WaitsBefore, getUseListLockWaits());
+  EXPECT_EQ(NumTasks * 16 * NumValues / 2, G->getNumUses());
+
+  double ParallelTime = runSharedUseTasks(M, G, 4);
+  unsigned Waits = getUseListLockWaits() - WaitsBefore;
+
+  // Every task kept the stores of the odd numbers, half of which store 1.
+  EXPECT_EQ(2 * NumTasks * 16 * NumValues / 2, G->getNumUses());
+  EXPECT_EQ(2 * NumTasks * 16 * NumValues / 4,
+            ConstantInt::get(Int32Ty, 1)->getNumUses());
+  EXPECT_TRUE(ConstantInt::get(Int32Ty, 0)->use_empty());
+  EXPECT_FALSE(verifyModule(M, &errs()));
+
+  RecordProperty("UseListLockWaits", Waits);
+  RecordProperty("SequentialMicroseconds", int(SequentialTime * 1e6));
+  RecordProperty("ParallelMicroseconds", int(ParallelTime * 1e6));
+}
+
+TEST(ConcurrentUniquingTest, SameValuesFromManyThreads) {
+  startMultithreaded();
+  LLVMContext C;
+  EXPECT_FALSE(C.hasConcurrentUniquing());
+  C.enableConcurrentUniquing();
+  EXPECT_TRUE(C.hasConcurrentUniquing());
+
+  std::vector<std::vector<CreatedValues> > Values(
+      NumTasks, std::vector<CreatedValues>(NumValues));
+  {
+    ThreadPool Pool(4);
+    for (unsigned T = 0; T != NumTasks; ++T)
+      Pool.async([&C, &Values, T] { createValues(C, T, Values[T]); });
+    Pool.wait();
+  }
+
+  for (unsigned T = 1; T != NumTasks; ++T)
+    for (unsigned N = 0; N != NumValues; ++N)
+      ASSERT_TRUE(Values[0][N] == Values[T][N]) << "number " << N << " task "
+                                                << T;
+
+  // Values created afterwards are the ones the tasks created.
+  EXPECT_EQ(Values[0][42].Int, ConstantInt::get(Type::getInt32Ty(C), 42));
+  EXPECT_EQ(Values[0][42].FP, ConstantFP::get(Type::getDoubleTy(C), 42));
+  EXPECT_EQ(Values[0][42].Str, MDString::get(C, "42"));
+}
+
+const unsigned NumFunctions = 64;
+
+/// Build a module whose functions only share values through the context:
+/// the debug scope, a metadata node attached to instructions EarlyCSE erases,
+/// and the intrinsic every function calls.
+std::string getFunctionsModule() {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "declare i32 @llvm.ctpop.i32(i32)\n";
+  for (unsigned I = 0; I != NumFunctions; ++I)
+    OS << "define i32 @f" << I << "(i32 %a, i32 %b) {\n"
+       << "entry:\n"
+       << "  %x = add i32 %a, %b, !dbg !" << I + 3 << ", !test.shared !2\n"
+       << "  %y = add i32 %a, %b, !dbg !" << I + 3 << ", !test.shared !2\n"
+       << "  %c = call i32 @llvm.ctpop.i32(i32 %x), !dbg !" << I + 3 << "\n"
+       << "  br label %next, !dbg !" << I + 3 << "\n"
+       << "next:\n"
+       << "  %z = mul i32 %c, %y, !dbg !" << I + 3 << "\n"
+       << "  ret i32 %z, !dbg !" << I + 3 << "\n"
+       << "}\n";
+  OS << "!0 = metadata !{metadata !\"t.c\", metadata !\".\"}\n"
+     << "!1 = metadata !{i32 786443, metadata !0, null, i32 1, i32 0, i32 0, "
+        "i32 0}\n"
+     << "!2 = metadata !{metadata !\"shared\"}\n"
+     << "!llvm.module.flags = !{!" << NumFunctions + 3 << "}\n"
+     << "!" << NumFunctions + 3
+     << " = metadata !{i32 1, metadata !\"Debug Info Version\", i32 1}\n";
+  // Each function has its own line, so that its discriminators do not depend
+  // on the order the functions are run in.
+  for (unsigned I = 0; I != NumFunctions; ++I)
+    OS << "!" << I + 3 << " = metadata !{i32 " << I + 1
+       << ", i32 0, metadata !1, null}\n";
+  return OS.str();
+}
+
+/// A function pass that reads and writes the other context tables passes
+/// use: metadata kinds, discriminators, intrinsic IDs and value handles.
+struct AnnotatePass : public FunctionPass {
+  static char ID;
+  AnnotatePass() : FunctionPass(ID) {}
+
+  bool runOnFunction(Function &F) override {
+    LLVMContext &C = F.getContext();
+    unsigned Kind = C.getMDKindID("test.annotation");
+    std::vector<WeakVH> Handles;
+    for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+        DILocation Loc(I->getDebugLoc().getAsMDNode(C));
+        unsigned IID = 0;
+        if (CallInst *CI = dyn_cast<CallInst>(I))
+          IID = CI->getCalledFunction()->getIntrinsicID();
+        Value *Ops[] = {
+          ConstantInt::get(Type::getInt32Ty(C),
+                           Loc.computeNewDiscriminator(C)),
+          ConstantInt::get(Type::getInt32Ty(C), IID)
+        };
+        I->setMetadata(Kind, MDNode::get(C, Ops));
+        Handles.push_back(WeakVH(I));
+      }
+    for (unsigned I = 0, E = Handles.size(); I != E; ++I)
+      EXPECT_TRUE(Handles[I] != 0);
+    return true;
+  }
+};
+char AnnotatePass::ID = 0;
+
+FunctionPassManager *createFunctionPasses(Module *M) {
+  FunctionPassManager *FPM = new FunctionPassManager(M);
+  FPM->add(createEarlyCSEPass());
+  FPM->add(createCFGSimplificationPass());
+  FPM->add(new AnnotatePass());
+  FPM->doInitialization();
+  return FPM;
+}
+
+std::string printModule(const Module &M) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  M.print(OS, 0);
+  return OS.str();
+}
+
+TEST(ConcurrentUniquingTest, FunctionPassesOnManyThreads) {
+  startMultithreaded();
+  std::string IR = getFunctionsModule();
+  SMDiagnostic Err;
+
+  LLVMContext SequentialC;
+  std::unique_ptr<Module> SequentialM(
+      ParseAssemblyString(IR.c_str(), 0, Err, SequentialC));
+  ASSERT_TRUE(SequentialM.get() != 0) << Err.getMessage().str();
+  {
+    std::unique_ptr<FunctionPassManager> FPM(
+        createFunctionPasses(SequentialM.get()));
+    for (Module::iterator F = SequentialM->begin(), E = SequentialM->end();
+         F != E; ++F)
+      if (!F->isDeclaration())
+        FPM->run(*F);
+    FPM->doFinalization();
+  }
+
+  LLVMContext C;
+  C.enableConcurrentUniquing();
+  std::unique_ptr<Module> M(ParseAssemblyString(IR.c_str(), 0, Err, C));
+  ASSERT_TRUE(M.get() != 0) << Err.getMessage().str();
+  std::vector<Function *> Functions;
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration())
+      Functions.push_back(F);
+
+  // Pass managers are not thread-safe, so each task gets its own, and works
+  // on its own functions.
+  std::vector<FunctionPassManager *> FPMs;
+  for (unsigned T = 0; T != NumTasks; ++T)
+    FPMs.push_back(createFunctionPasses(M.get()));
+  {
+    ThreadPool Pool(4);
+    for (unsigned T = 0; T != NumTasks; ++T) {
+      FunctionPassManager *FPM = FPMs[T];
+      Pool.async([FPM, &Functions, T] {
+        for (unsigned I = T, E = Functions.size(); I < E; I += NumTasks)
+          FPM->run(*Functions[I]);
+      });
+    }
+    Pool.wait();
+  }
+  for (unsigned T = 0; T != NumTasks; ++T) {
+    FPMs[T]->doFinalization();
+    delete FPMs[T];
+  }
+
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  EXPECT_EQ(printModule(*SequentialM), printModule(*M));
+}
+
+} // end anonymous namespace
@@ -13,7 +13,9 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
 #include "gtest/gtest.h"
+#include <atomic>
 
 using namespace llvm;
 
@@ -165,30 +167,77 @@ struct TestInvalidationFunctionPass {
   StringRef Name;
 };
 
-Module *parseIR(const char *IR) {
-  LLVMContext &C = getGlobalContext();
+// A function analysis and pass that count their runs atomically, for use with
+// the parallel adaptor.
+class TestAtomicFunctionAnalysis {
+public:
+  struct Result {
+    Result(int Count) : InstructionCount(Count) {}
+    int InstructionCount;
+  };
+
+  static void *ID() { return (void *)&PassID; }
+
+  TestAtomicFunctionAnalysis(std::atomic<int> &Runs) : Runs(&Runs) {}
+
+  Result run(Function *F, FunctionAnalysisManager *AM) {
+    ++*Runs;
+    int Count = 0;
+    for (Function::iterator BBI = F->begin(), BBE = F->end(); BBI != BBE; ++BBI)
+      Count += BBI->size();
+    return Result(Count);
+  }
+
+private:
+  static char PassID;
+
+  std::atomic<int> *Runs;
+};
+
+char TestAtomicFunctionAnalysis::PassID;
+
+struct TestAtomicFunctionPass {
+  TestAtomicFunctionPass(std::atomic<int> &RunCount,
+                         std::atomic<int> &AnalyzedInstrCount)
+      : RunCount(&RunCount), AnalyzedInstrCount(&AnalyzedInstrCount) {}
+
+  PreservedAnalyses run(Function *F, FunctionAnalysisManager *AM) {
+    ++*RunCount;
+    *AnalyzedInstrCount +=
+        AM->getResult<TestAtomicFunctionAnalysis>(F).InstructionCount;
+    return PreservedAnalyses::all();
+  }
+
+  static StringRef name() { return "TestAtomicFunctionPass"; }
+
+  std::atomic<int> *RunCount;
+  std::atomic<int> *AnalyzedInstrCount;
+};
+
+Module *parseIR(LLVMContext &C, const char *IR) {
   SMDiagnostic Err;
   return ParseAssemblyString(IR, 0, Err, C);
 }
 
 class PassManagerTest : public ::testing::Test {
 protected:
+  LLVMContext Context;
   std::unique_ptr<Module> M;
 
 public:
   PassManagerTest()
-      : M(parseIR("define void @f() {\n"
-                  "entry:\n"
-                  "  call void @g()\n"
-                  "  call void @h()\n"
-                  "  ret void\n"
-                  "}\n"
-                  "define void @g() {\n"
-                  "  ret void\n"
-                  "}\n"
-                  "define void @h() {\n"
-                  "  ret void\n"
-                  "}\n")) {}
+      : M(parseIR(Context, "define void @f() {\n"
+                           "entry:\n"
+                           "  call void @g()\n"
+                           "  call void @h()\n"
+                           "  ret void\n"
+                           "}\n"
+                           "define void @g() {\n"
+                           "  ret void\n"
+                           "}\n"
+                           "define void @h() {\n"
+                           "  ret void\n"
+                           "}\n")) {}
 };
 
 TEST_F(PassManagerTest, BasicPreservedAnalyses) {
@@ -341,4 +390,52 @@ TEST_F(PassManagerTest, Basic) {
 
   EXPECT_EQ(1, ModuleAnalysisRuns);
 }
+
+TEST_F(PassManagerTest, ParallelFunctionAdaptor) {
+  // The adaptor runs the functions on threads sharing the context.
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+  Context.enableConcurrentUniquing();
+
+  FunctionAnalysisManager FAM;
+  std::atomic<int> FunctionAnalysisRuns(0);
+  FAM.registerPass(TestAtomicFunctionAnalysis(FunctionAnalysisRuns));
+
+  ModuleAnalysisManager MAM;
+  MAM.registerPass(FunctionAnalysisManagerModuleProxy(FAM));
+  FAM.registerPass(ModuleAnalysisManagerFunctionProxy(MAM));
+
+  ModulePassManager MPM;
+
+  std::atomic<int> FunctionPassRunCount1(0);
+  std::atomic<int> AnalyzedInstrCount1(0);
+  {
+    FunctionPassManager FPM;
+    FPM.addPass(TestAtomicFunctionPass(FunctionPassRunCount1,
+                                       AnalyzedInstrCount1));
+    MPM.addPass(createParallelModuleToFunctionPassAdaptor(std::move(FPM), 4));
+  }
+
+  // A second run in which 'f' is invalidated before the analysis is queried.
+  std::atomic<int> FunctionPassRunCount2(0);
+  std::atomic<int> AnalyzedInstrCount2(0);
+  {
+    FunctionPassManager FPM;
+    FPM.addPass(TestInvalidationFunctionPass("f"));
+    FPM.addPass(TestAtomicFunctionPass(FunctionPassRunCount2,
+                                       AnalyzedInstrCount2));
+    MPM.addPass(createParallelModuleToFunctionPassAdaptor(std::move(FPM), 4));
+  }
+
+  MPM.run(M.get(), &MAM);
+
+  EXPECT_EQ(3, FunctionPassRunCount1);
+  EXPECT_EQ(5, AnalyzedInstrCount1);
+  EXPECT_EQ(3, FunctionPassRunCount2);
+  EXPECT_EQ(5, AnalyzedInstrCount2);
+
+  // Three runs for the first adaptor, and one for 'f' after it was
+  // invalidated in the second.
+  EXPECT_EQ(4, FunctionAnalysisRuns);
+}
 }
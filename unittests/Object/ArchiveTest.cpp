@@ -0,0 +1,133 @@
+//===- llvm/unittest/Object/ArchiveTest.cpp - Tests for Archive -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/Archive.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+using namespace object;
+
+namespace {
+
+void writeMember(raw_ostream &OS, StringRef Name, StringRef Data) {
+  // Name, then the modification time, UID, GID and mode, then the size.
+  OS << format("%-16s", Name.str().c_str())
+     << "0           0     0     644     "
+     << format("%-10u`\n", unsigned(Data.size())) << Data;
+  if (Data.size() % 2)
+    OS << '\n';
+}
+
+void writeBE32(raw_ostream &OS, uint32_t V) {
+  OS << char(V >> 24) << char(V >> 16) << char(V >> 8) << char(V);
+}
+
+// A GNU archive with members a.o and b.o, both defining "dup".
+std::string makeGNUArchive() {
+  const char *const Names[] = { "foo", "dup", "bar", "dup" };
+  const unsigned Members[] = { 0, 0, 1, 1 };
+  const unsigned NumSymbols = 4;
+
+  std::string NameData;
+  for (unsigned I = 0; I != NumSymbols; ++I)
+    NameData += std::string(Names[I]) + '\0';
+  uint32_t SymTabSize = 4 + 4 * NumSymbols + NameData.size();
+  uint32_t MemberOffsets[2];
+  MemberOffsets[0] = 8 + 60 + SymTabSize + SymTabSize % 2;
+  MemberOffsets[1] = MemberOffsets[0] + 60 + 2;
+
+  std::string SymTab;
+  {
+    raw_string_ostream OS(SymTab);
+    writeBE32(OS, NumSymbols);
+    for (unsigned I = 0; I != NumSymbols; ++I)
+      writeBE32(OS, MemberOffsets[Members[I]]);
+    OS << NameData;
+  }
+
+  std::string Result;
+  raw_string_ostream OS(Result);
+  OS << "!<arch>\n";
+  writeMember(OS, "/", SymTab);
+  writeMember(OS, "a.o/", "aa");
+  writeMember(OS, "b.o/", "bb");
+  return OS.str();
+}
+
+TEST(ArchiveTest, FindSym) {
+  std::string Data = makeGNUArchive();
+  ErrorOr<Archive *> ArchiveOrErr =
+      Archive::create(MemoryBuffer::getMemBuffer(Data, "", false));
+  ASSERT_FALSE(ArchiveOrErr.getError());
+  std::unique_ptr<Archive> A(ArchiveOrErr.get());
+  ASSERT_TRUE(A->hasSymbolTable());
+
+  StringRef Name;
+  Archive::child_iterator I = A->findSym("foo");
+  ASSERT_TRUE(I != A->child_end());
+  ASSERT_FALSE(I->getName(Name));
+  EXPECT_EQ("a.o", Name);
+
+  I = A->findSym("bar");
+  ASSERT_TRUE(I != A->child_end());
+  ASSERT_FALSE(I->getName(Name));
+  EXPECT_EQ("b.o", Name);
+  EXPECT_EQ("bb", I->getBuffer());
+
+  // The first definition in the symbol table wins.
+  I = A->findSym("dup");
+  ASSERT_TRUE(I != A->child_end());
+  ASSERT_FALSE(I->getName(Name));
+  EXPECT_EQ("a.o", Name);
+
+  EXPECT_TRUE(A->findSym("baz") == A->child_end());
+  EXPECT_TRUE(A->findSym("") == A->child_end());
+}
+
+#if LLVM_ENABLE_THREADS
+TEST(ArchiveTest, FindSymFromManyThreads) {
+  std::string Data = makeGNUArchive();
+  ErrorOr<Archive *> ArchiveOrErr =
+      Archive::create(MemoryBuffer::getMemBuffer(Data, "", false));
+  ASSERT_FALSE(ArchiveOrErr.getError());
+  std::unique_ptr<Archive> A(ArchiveOrErr.get());
+
+  // The threads race to build the index, then read it.
+  const unsigned NumThreads = 8;
+  std::vector<std::string> Found(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Threads.push_back(std::thread([&A, &Found, T] {
+      for (unsigned I = 0; I != 1000; ++I) {
+        StringRef Name;
+        Archive::child_iterator C = A->findSym(I % 2 ? "bar" : "foo");
+        if (C == A->child_end() || C->getName(Name))
+          return;
+        Found[T] += Name.str() + ' ';
+        if (A->findSym("baz") != A->child_end())
+          return;
+      }
+    }));
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Threads[T].join();
+
+  std::string Expected;
+  for (unsigned I = 0; I != 1000; ++I)
+    Expected += I % 2 ? "b.o " : "a.o ";
+  for (unsigned T = 0; T != NumThreads; ++T)
+    EXPECT_EQ(Expected, Found[T]) << "thread " << T;
+}
+#endif
+
+}
@@ -27,7 +27,7 @@ public:
 protected:
   // Adds RW flags to permit testing of the resulting memory
   unsigned getTestableEquivalent(unsigned RequestedFlags) {
-    switch (RequestedFlags) {
+    switch (RequestedFlags & Memory::MF_RWE_MASK) {
     case Memory::MF_READ:
     case Memory::MF_WRITE:
     case Memory::MF_READ|Memory::MF_WRITE:
@@ -347,7 +347,8 @@ unsigned MemoryFlags[] = {
 			   Memory::MF_READ|Memory::MF_WRITE,
 			   Memory::MF_EXEC,
 			   Memory::MF_READ|Memory::MF_EXEC,
-			   Memory::MF_READ|Memory::MF_WRITE|Memory::MF_EXEC
+			   Memory::MF_READ|Memory::MF_WRITE|Memory::MF_EXEC,
+			   Memory::MF_READ|Memory::MF_WRITE|Memory::MF_HUGE_HINT
 			 };
 
 INSTANTIATE_TEST_CASE_P(AllocationTests,
@@ -0,0 +1,70 @@
+//===- llvm/unittest/Support/ParallelTest.cpp - Parallel algorithm tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <random>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ParallelTest, TaskGroup) {
+  std::atomic<int> Count(0);
+  ThreadPool Pool(4);
+  TaskGroup Group(Pool);
+  for (int I = 0; I != 100; ++I)
+    Group.spawn([&Count] { ++Count; });
+  Group.wait();
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ParallelTest, NestedTaskGroups) {
+  // Waiting for a group from a task of the same pool must not deadlock, even
+  // when every worker is waiting.
+  std::atomic<int> Count(0);
+  ThreadPool Pool(2);
+  TaskGroup Outer(Pool);
+  for (int I = 0; I != 8; ++I)
+    Outer.spawn([&] {
+      TaskGroup Inner(Pool);
+      for (int J = 0; J != 8; ++J)
+        Inner.spawn([&Count] { ++Count; });
+      Inner.wait();
+    });
+  Outer.wait();
+  EXPECT_EQ(64, Count);
+}
+
+TEST(ParallelTest, ForEach) {
+  std::vector<int> Values(1000, 1);
+  ThreadPool Pool(4);
+  parallel_for_each(Pool, Values.begin(), Values.end(), [](int &V) { V *= 2; });
+  for (int V : Values)
+    EXPECT_EQ(2, V);
+}
+
+TEST(ParallelTest, Sort) {
+  std::vector<unsigned> Values(100000);
+  std::mt19937 Rand(1);
+  for (unsigned &V : Values)
+    V = Rand();
+  std::vector<unsigned> Expected = Values;
+  std::sort(Expected.begin(), Expected.end());
+
+  ThreadPool Pool(4);
+  parallel_sort(Pool, Values.begin(), Values.end());
+  EXPECT_EQ(Expected, Values);
+
+  parallel_sort(Pool, Values.begin(), Values.end(), std::greater<unsigned>());
+  EXPECT_TRUE(std::is_sorted(Values.rbegin(), Values.rend()));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,50 @@
+//===- unittests/Support/StatisticTest.cpp - Statistic tests --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+#if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
+TEST(StatisticTest, ThreadLocal) {
+  // The statistic is bumped from the threads of the pool.
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+  ThreadLocalStatistics = true;
+  Statistic Counter;
+  Counter.construct("statistic-test", "Number of increments");
+
+  ThreadPool Pool(4);
+  for (int I = 0; I != 8; ++I)
+    Pool.async([&Counter] {
+      for (int J = 0; J != 1000; ++J)
+        ++Counter;
+      Counter -= 10;
+    });
+  Pool.wait();
+  EXPECT_EQ(7920u, Counter.getValue());
+
+  // Updates that can't be split among threads see the merged value.
+  Counter /= 2;
+  EXPECT_EQ(3960u, Counter.getValue());
+  Counter++;
+  EXPECT_EQ(3961u, Counter.getValue());
+  Counter = 5;
+  EXPECT_EQ(5u, Counter.getValue());
+  Counter *= 3;
+  EXPECT_EQ(15u, Counter.getValue());
+}
+#endif
+
+}
@@ -0,0 +1,59 @@
+//========- unittests/Support/ThreadPoolTest.cpp - ThreadPool.h tests -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <atomic>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadPoolTest, AsyncAndWait) {
+  std::atomic<int> Count(0);
+  ThreadPool Pool(4);
+  for (int I = 0; I != 100; ++I)
+    Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ThreadPoolTest, Future) {
+  std::atomic<int> Count(0);
+  ThreadPool Pool(2);
+  std::shared_future<void> Future = Pool.async([&Count] { ++Count; });
+  Future.wait();
+  EXPECT_EQ(1, Count);
+}
+
+TEST(ThreadPoolTest, NestedSubmission) {
+  // Tasks submitted by a task go to the queue of its worker, from which idle
+  // workers steal.
+  std::atomic<int> Count(0);
+  ThreadPool Pool(4);
+  for (int I = 0; I != 10; ++I)
+    Pool.async([&] {
+      for (int J = 0; J != 10; ++J)
+        Pool.async([&Count] { ++Count; });
+    });
+  Pool.wait();
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ThreadPoolTest, DestructorDrainsQueue) {
+  std::atomic<int> Count(0);
+  {
+    ThreadPool Pool(2);
+    for (int I = 0; I != 50; ++I)
+      Pool.async([&Count] { ++Count; });
+  }
+  EXPECT_EQ(50, Count);
+}
+
+} // end anonymous namespace
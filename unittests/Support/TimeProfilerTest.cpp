@@ -0,0 +1,60 @@
+//===- unittests/Support/TimeProfilerTest.cpp - TimeProfiler tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(TimeProfilerTest, Disabled) {
+  EXPECT_FALSE(timeTraceProfilerEnabled());
+  TimeTraceScope Scope("ignored");
+}
+
+TEST(TimeProfilerTest, Events) {
+  timeTraceProfilerInitialize(0);
+  EXPECT_TRUE(timeTraceProfilerEnabled());
+  {
+    TimeTraceScope Outer("outer", "a \"quoted\" detail");
+    TimeTraceScope Inner("inner");
+  }
+
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  timeTraceProfilerWrite(OS, "test");
+  timeTraceProfilerCleanup();
+  EXPECT_FALSE(timeTraceProfilerEnabled());
+
+  // The inner event ends first.
+  size_t InnerPos = OS.str().find("\"name\":\"inner\"}");
+  size_t OuterPos = OS.str().find(
+      "\"name\":\"outer\",\"args\":{\"detail\":\"a \\\"quoted\\\" detail\"}}");
+  EXPECT_NE(std::string::npos, InnerPos);
+  EXPECT_NE(std::string::npos, OuterPos);
+  EXPECT_LT(InnerPos, OuterPos);
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"name\":\"process_name\",\"args\":{\"name\":\"test\"}"));
+}
+
+TEST(TimeProfilerTest, Granularity) {
+  timeTraceProfilerInitialize(1000000000);
+  {
+    TimeTraceScope Scope("short");
+  }
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  timeTraceProfilerWrite(OS, "test");
+  timeTraceProfilerCleanup();
+  EXPECT_EQ(std::string::npos, OS.str().find("short"));
+}
+
+}
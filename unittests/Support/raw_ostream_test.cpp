@@ -143,4 +143,28 @@ TEST(raw_ostreamTest, WriteEscaped) {
   EXPECT_EQ("\\001\\010\\200", Str);
 }
 
+TEST(raw_ostreamTest, WriteJSONString) {
+  std::string Str;
+
+  Str = "";
+  raw_string_ostream(Str).write_json_string("hi");
+  EXPECT_EQ("\"hi\"", Str);
+
+  Str = "";
+  raw_string_ostream(Str).write_json_string("\\\"\t\37/\200");
+  EXPECT_EQ("\"\\\\\\\"\\u0009\\u001f/\200\"", Str);
+}
+
+TEST(raw_ostreamTest, WriteCSVField) {
+  std::string Str;
+
+  Str = "";
+  raw_string_ostream(Str).write_csv_field("hi there");
+  EXPECT_EQ("hi there", Str);
+
+  Str = "";
+  raw_string_ostream(Str).write_csv_field("a,\"b\"\n");
+  EXPECT_EQ("\"a,\"\"b\"\"\n\"", Str);
+}
+
 }